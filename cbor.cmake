@@ -9,5 +9,6 @@ list(APPEND CBOR_SRCS
 	${CMAKE_CURRENT_LIST_DIR}/src/stringify.c
 	${CMAKE_CURRENT_LIST_DIR}/src/ieee754.c
 	${CMAKE_CURRENT_LIST_DIR}/src/stream.c
+	${CMAKE_CURRENT_LIST_DIR}/src/utf8.c
 )
 list(APPEND CBOR_INCS ${CMAKE_CURRENT_LIST_DIR}/include)
@@ -13,5 +13,6 @@ CBOR_SRCS := \
 	$(cbor-basedir)src/stringify.c \
 	$(cbor-basedir)src/ieee754.c \
 	$(cbor-basedir)src/stream.c \
+	$(cbor-basedir)src/utf8.c \
 
 CBOR_INCS := $(cbor-basedir)include
@@ -19,6 +19,11 @@ extern "C" {
 #define CBOR_RECURSION_MAX_LEVEL		8
 #endif
 
+/* sorted maps are deferred-length maps sorted when they end */
+#if defined(CBOR_WRITER_SORTED) && !defined(CBOR_WRITER_DEFERRED)
+#define CBOR_WRITER_DEFERRED
+#endif
+
 #define CBOR_INDEFINITE_VALUE			(-1)
 #define CBOR_RESERVED_VALUE			(-2)
 
@@ -60,12 +65,44 @@ typedef enum {
  */
 typedef size_t cbor_tag_t;
 
+#if defined(CBOR_COMPACT_ITEM)
+/** The largest message size in bytes the compact item layout can address. */
+#define CBOR_ITEM_MAX_OFFSET			((1ul << 29) - 1)
+/** The largest size field the compact item layout can hold. */
+#define CBOR_ITEM_MAX_SIZE			(UINT32_MAX - 1)
+
+typedef struct {
+	uint32_t type: 3; /**< @ref cbor_item_data_t */
+	uint32_t offset: 29;
+	uint32_t size; /**< either of the length of value in bytes or the number
+			 of items in case of container type. UINT32_MAX for
+			 indefinite length */
+} cbor_item_t;
+
+typedef char cbor_compact_item_must_be_8_bytes[
+	(sizeof(cbor_item_t) == 8) ? 1 : -1];
+#else
 typedef struct {
 	cbor_item_data_t type;
 	size_t offset;
 	size_t size; /**< either of the length of value in bytes or the number
 		       of items in case of container type */
 } cbor_item_t;
+#endif
+
+/**
+ * One level of parser nesting.
+ *
+ * The parser keeps an explicit stack of frames instead of recursing, so its
+ * call stack use does not depend on how deep a message nests. The fields are
+ * internal to the parser; callers only provide storage for them.
+ */
+typedef struct {
+	size_t expected; /**< items expected at this level */
+	size_t nparsed; /**< items parsed so far at this level */
+	size_t owner; /**< index of the item owning this level */
+	uint8_t major_type; /**< major type of the item owning this level */
+} cbor_parser_frame_t;
 
 typedef struct {
 	uint8_t const *msg;
@@ -75,12 +112,155 @@ typedef struct {
 	cbor_item_t *items;
 	size_t itemidx;
 	size_t maxitems;
+
+	cbor_parser_frame_t *frames; /**< NULL to use CBOR_RECURSION_MAX_LEVEL
+				       frames on the call stack */
+	size_t maxframes;
+	size_t depth; /**< frames in use while a resumable parse waits for
+			more bytes */
+
+	size_t *siblings; /**< NULL, or the next sibling index of each item */
+	bool validate_utf8; /**< check text strings to be well-formed UTF-8 */
+
+	size_t *stringrefs; /**< NULL, or where shared strings are numbered */
+	size_t maxstringrefs;
+	size_t resolved; /**< items whose references are resolved already */
 } cbor_reader_t;
 
+#if defined(CBOR_WRITER_DEFERRED)
+/**
+ * One level of container nesting while encoding.
+ *
+ * The fields are internal to the writer; callers only provide storage for
+ * them.
+ */
+typedef struct {
+	size_t offset; /**< where the container header starts */
+	size_t expected; /**< items expected at this level, keys and values
+			   counted apart */
+	size_t count; /**< items done at this level */
+#if defined(CBOR_WRITER_SORTED)
+	size_t mark; /**< scratch in use when the container began */
+#endif
+	uint8_t major_type;
+	bool deferred; /**< length written when the container ends */
+#if defined(CBOR_WRITER_SORTED)
+	bool sorted; /**< entries sorted when the map ends */
+#endif
+} cbor_writer_frame_t;
+#endif
+
+#if defined(CBOR_WRITER_SINK)
+/**
+ * Writer sink, taking encoded bytes out of the writer.
+ *
+ * @param[in] data encoded bytes
+ * @param[in] datasize the @p data size in bytes
+ * @param[in] arg user-supplied context pointer
+ *
+ * @return true to continue encoding, false to abort (CBOR_ABORTED)
+ */
+typedef bool (*cbor_writer_sink_t)(void const *data, size_t datasize,
+		void *arg);
+#endif
+
+#if defined(CBOR_WRITER_GROW)
+/**
+ * Writer buffer allocator, growing the writer buffer.
+ *
+ * @param[in] buf the writer buffer
+ * @param[in] used the number of bytes in use at the start of @p buf
+ * @param[in] newsize the buffer size wanted in bytes
+ * @param[in] arg user-supplied context pointer
+ *
+ * @return a buffer of @p newsize bytes starting with the @p used bytes of
+ *         @p buf, which may be @p buf itself, or NULL when out of memory
+ */
+typedef void *(*cbor_writer_grow_t)(void *buf, size_t used, size_t newsize,
+		void *arg);
+#endif
+
+#if defined(CBOR_WRITER_STRINGREF)
+/**
+ * A string the writer encoded literally and may refer back to.
+ *
+ * The fields are internal to the writer; callers only provide storage for
+ * them.
+ */
+typedef struct {
+	size_t offset; /**< where the payload is in the writer buffer */
+	size_t len; /**< payload length in bytes, 0 for a free slot */
+	uint64_t index; /**< the string number in the namespace */
+	uint8_t major_type;
+} cbor_stringref_t;
+#endif
+
+#if defined(CBOR_WRITER_IOVEC)
+/**
+ * A span of the encoded message, laid out like POSIX `struct iovec` but
+ * without depending on it.
+ */
+typedef struct {
+	void const *base;
+	size_t len;
+} cbor_iovec_t;
+#endif
+
 typedef struct {
 	uint8_t *buf;
 	size_t bufsize;
 	size_t bufidx;
+
+#if defined(CBOR_WRITER_SINK)
+	cbor_writer_sink_t sink; /**< NULL, or where a full buffer goes */
+	void *sink_arg;
+	size_t flushed; /**< bytes handed to the sink so far */
+#endif
+
+#if defined(CBOR_WRITER_GROW)
+	cbor_writer_grow_t grow; /**< NULL, or what makes the buffer larger */
+	void *grow_arg;
+#endif
+
+#if defined(CBOR_WRITER_DRY_RUN)
+	bool dry_run; /**< only count the bytes that would be written */
+#endif
+
+#if defined(CBOR_WRITER_DEFERRED)
+	cbor_writer_frame_t *frames; /**< NULL, or container levels to track */
+	size_t maxframes;
+	size_t depth; /**< container levels open */
+	size_t deferred; /**< deferred-length containers open */
+#endif
+
+#if defined(CBOR_WRITER_IOVEC)
+	cbor_iovec_t *iov; /**< NULL, or where the message spans are listed */
+	size_t maxiov;
+	size_t niov; /**< spans listed so far */
+	size_t iov_threshold; /**< smallest string payload to refer to */
+	size_t iov_mark; /**< start of the buffer bytes not listed yet */
+#endif
+
+#if defined(CBOR_WRITER_SORTED)
+	void *scratch; /**< NULL, or where sorted map entries are kept */
+	size_t scratch_size;
+	size_t scratch_used; /**< entries kept so far */
+	bool scratch_exhausted;
+#endif
+
+#if defined(CBOR_WRITER_STRINGREF)
+	cbor_stringref_t *strings; /**< NULL, or strings to refer back to */
+	size_t maxstrings;
+	size_t nstrings_kept; /**< slots in use in @p strings */
+	uint64_t nstrings; /**< strings numbered in the namespace so far */
+	bool stringref; /**< in a stringref namespace */
+	bool chunked; /**< in an indefinite-length string */
+	uint64_t ns_pending; /**< items left to end the namespace, or the
+			       indefinite-length item innermost in it */
+	size_t ns_open; /**< indefinite-length items open in the namespace */
+	uint64_t ns_saved[CBOR_RECURSION_MAX_LEVEL]; /**< items left outside
+						       of each of them */
+#endif
 } cbor_writer_t;
 
 /**
@@ -89,6 +269,10 @@ typedef struct {
  * @param[in,out] reader reader context for the actual encoded message
  * @param[out] items a pointer to item buffers
  * @param[in] maxitems the maximum number of items to be stored in @p items
+ *
+ * @note This resets any frame stack given by @ref cbor_reader_set_frames and
+ *       any sibling index given by @ref cbor_reader_set_sibling_index, and
+ *       turns UTF-8 validation off.
  */
 void cbor_reader_init(cbor_reader_t *reader, cbor_item_t *items, size_t maxitems);
 
@@ -98,9 +282,29 @@ void cbor_reader_init(cbor_reader_t *reader, cbor_item_t *items, size_t maxitems
  * @param[in,out] writer writer context
  * @param[out] buf output buffer for encoded bytes
  * @param[in] bufsize size of @p buf in bytes
+ *
+ * @note This resets any sink given by @ref cbor_writer_set_sink, any
+ *       allocator given by @ref cbor_writer_set_grow, any frames given by
+ *       @ref cbor_writer_set_frames, any spans given by
+ *       @ref cbor_writer_set_iovec, any scratch given by
+ *       @ref cbor_writer_set_scratch and any strings given by
+ *       @ref cbor_writer_set_stringrefs.
  */
 void cbor_writer_init(cbor_writer_t *writer, void *buf, size_t bufsize);
 
+#if defined(CBOR_WRITER_DRY_RUN)
+/**
+ * Initialize the writer to measure the encoded size only.
+ *
+ * Encoding then writes nothing but counts the bytes it would write, making
+ * the same choices, e.g. shrinking floats, as a real one.
+ * @ref cbor_writer_len gives the exact size of the message afterwards.
+ *
+ * @param[in,out] writer writer context
+ */
+void cbor_writer_init_dry_run(cbor_writer_t *writer);
+#endif
+
 /**
  * Get the number of bytes encoded into the writer buffer.
  *
@@ -170,6 +374,25 @@ size_t cbor_get_item_size(cbor_item_t const *item);
  */
 uint8_t cbor_get_following_bytes(uint8_t additional_info);
 
+/**
+ * What an initial byte tells about the item it starts.
+ *
+ * The header of a definite-length item takes 1 + @p following_bytes bytes.
+ * Indefinite-length and reserved values are marked by the same sentinels as
+ * @ref cbor_get_following_bytes returns. The major type is the upper 3 bits
+ * of the byte itself.
+ */
+typedef struct {
+	uint8_t following_bytes; /**< as @ref cbor_get_following_bytes */
+	uint8_t kind; /**< @ref cbor_item_data_t the item gets parsed as, or
+			@ref CBOR_ITEM_UNKNOWN for reserved values */
+} cbor_initial_byte_t;
+
+/**
+ * Initial byte decode table, indexed by the initial byte.
+ */
+extern const cbor_initial_byte_t cbor_initial_bytes[256];
+
 /**
  * Copy bytes from CBOR payload into host-endian order.
  *
@@ -194,6 +417,36 @@ size_t cbor_copy(uint8_t *dst, uint8_t const *src, size_t len);
  */
 size_t cbor_copy_be(uint8_t *dst, uint8_t const *src, size_t len);
 
+/**
+ * Check if a string gets a number in a stringref namespace.
+ *
+ * A string is numbered when its reference would not be longer than the
+ * string itself, i.e. when it is at least 3, 4, 5, 7 or 11 bytes long for
+ * the strings numbered so far below 24, 256, 65536, 2^32 or above.
+ *
+ * @param[in] len string length in bytes
+ * @param[in] index the number the string would get
+ *
+ * @return true if the string is numbered, otherwise false
+ */
+bool cbor_stringref_is_numbered(size_t len, uint64_t index);
+
+/**
+ * Check if a parsed string, array or map item has indefinite length.
+ *
+ * @param[in] item parsed CBOR item
+ *
+ * @return true if @p item has indefinite length, otherwise false
+ */
+static inline bool cbor_item_is_indefinite(cbor_item_t const *item)
+{
+#if defined(CBOR_COMPACT_ITEM)
+	return item->size == UINT32_MAX;
+#else
+	return item->size == (size_t)CBOR_INDEFINITE_VALUE;
+#endif
+}
+
 /**
  * Check if a parsed item is a CBOR BREAK token.
  *
@@ -203,8 +456,14 @@ size_t cbor_copy_be(uint8_t *dst, uint8_t const *src, size_t len);
  */
 static inline bool cbor_item_is_break(cbor_item_t const *item)
 {
+#if defined(CBOR_COMPACT_ITEM)
+	/* non-short-circuit to keep it small enough to be inlined at -Os */
+	return (item->type == CBOR_ITEM_FLOAT) &
+		(item->size == (uint8_t)CBOR_INDEFINITE_VALUE);
+#else
 	return item->type == CBOR_ITEM_FLOAT &&
 		item->size == (size_t)(uint8_t)CBOR_INDEFINITE_VALUE;
+#endif
 }
 
 #if defined(__cplusplus)
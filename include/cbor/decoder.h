@@ -28,6 +28,129 @@ extern "C" {
  */
 cbor_error_t cbor_decode(cbor_reader_t const *reader, cbor_item_t const *item,
 		void *buf, size_t bufsize);
+/**
+ * Decode an unsigned integer item to a native value.
+ *
+ * Unlike @ref cbor_decode, the typed accessors read the value with a single
+ * load and write nothing but @p value, and only on success.
+ *
+ * @param[in] reader reader context for the actual encoded message
+ * @param[in] item meta data about the item to be decoded
+ * @param[out] value the decoded value
+ *
+ * @return @ref CBOR_SUCCESS, @ref CBOR_OVERRUN for a negative integer, or
+ *         @ref CBOR_INVALID when @p item is not an integer
+ */
+cbor_error_t cbor_decode_u64(cbor_reader_t const *reader,
+		cbor_item_t const *item, uint64_t *value);
+/**
+ * Decode an unsigned or negative integer item to a native value.
+ *
+ * @param[in] reader reader context for the actual encoded message
+ * @param[in] item meta data about the item to be decoded
+ * @param[out] value the decoded value
+ *
+ * @return @ref CBOR_SUCCESS, @ref CBOR_OVERRUN when the value does not fit in
+ *         int64_t, or @ref CBOR_INVALID when @p item is not an integer
+ */
+cbor_error_t cbor_decode_i64(cbor_reader_t const *reader,
+		cbor_item_t const *item, int64_t *value);
+/**
+ * Decode a half, single or double precision float item to a double.
+ *
+ * @param[in] reader reader context for the actual encoded message
+ * @param[in] item meta data about the item to be decoded
+ * @param[out] value the decoded value
+ *
+ * @return @ref CBOR_SUCCESS, or @ref CBOR_INVALID when @p item is not a float
+ */
+cbor_error_t cbor_decode_double(cbor_reader_t const *reader,
+		cbor_item_t const *item, double *value);
+/**
+ * Decode a half, single or double precision float item to a float.
+ *
+ * @param[in] reader reader context for the actual encoded message
+ * @param[in] item meta data about the item to be decoded
+ * @param[out] value the decoded value
+ *
+ * @return @ref CBOR_SUCCESS, @ref CBOR_OVERRUN when a double precision value
+ *         would lose precision as a float, or @ref CBOR_INVALID when @p item
+ *         is not a float
+ */
+cbor_error_t cbor_decode_float(cbor_reader_t const *reader,
+		cbor_item_t const *item, float *value);
+/**
+ * Decode a true or false item.
+ *
+ * @param[in] reader reader context for the actual encoded message
+ * @param[in] item meta data about the item to be decoded
+ * @param[out] value the decoded value
+ *
+ * @return @ref CBOR_SUCCESS, or @ref CBOR_INVALID when @p item is not a bool
+ */
+cbor_error_t cbor_decode_bool(cbor_reader_t const *reader,
+		cbor_item_t const *item, bool *value);
+/**
+ * Check if an item is null.
+ *
+ * @param[in] reader reader context for the actual encoded message
+ * @param[in] item meta data about the item to be checked
+ *
+ * @return true if @p item is null, otherwise false
+ */
+bool cbor_decode_is_null(cbor_reader_t const *reader,
+		cbor_item_t const *item);
+/**
+ * Decode an array of unsigned integers into a native array.
+ *
+ * The elements are the items following @p array in the item table filled by
+ * @ref cbor_parse, so @p array must point into that table. Both definite and
+ * indefinite-length arrays are taken. Runs of elements encoded with the same
+ * width are decoded in bulk wherever they are in the array, and the others
+ * one by one.
+ *
+ * @param[in] reader reader context for the actual encoded message
+ * @param[in] array the array item
+ * @param[out] out the decoded values
+ * @param[in] maxn the number of values @p out can hold
+ * @param[out] ndecoded the number of values decoded gets stored if not null.
+ *             On error it is the index of the offending element.
+ *
+ * @return @ref CBOR_SUCCESS, @ref CBOR_OVERRUN when the array has more than
+ *         @p maxn elements or an element does not fit in uint32_t, or
+ *         @ref CBOR_INVALID when @p array is not an array or an element is
+ *         not an unsigned integer
+ */
+cbor_error_t cbor_decode_array_u32(cbor_reader_t const *reader,
+		cbor_item_t const *array, uint32_t *out, size_t maxn,
+		size_t *ndecoded);
+/**
+ * Decode an array of integers into a native array.
+ *
+ * See @ref cbor_decode_array_u32 for the parameters. An element that does not
+ * fit in int64_t gives @ref CBOR_OVERRUN.
+ */
+cbor_error_t cbor_decode_array_i64(cbor_reader_t const *reader,
+		cbor_item_t const *array, int64_t *out, size_t maxn,
+		size_t *ndecoded);
+/**
+ * Decode an array of floats into a native array.
+ *
+ * See @ref cbor_decode_array_u32 for the parameters. A double precision
+ * element that would lose precision as a float gives @ref CBOR_OVERRUN.
+ */
+cbor_error_t cbor_decode_array_f32(cbor_reader_t const *reader,
+		cbor_item_t const *array, float *out, size_t maxn,
+		size_t *ndecoded);
+/**
+ * Decode an array of half, single or double precision floats into a native
+ * array of doubles.
+ *
+ * See @ref cbor_decode_array_u32 for the parameters.
+ */
+cbor_error_t cbor_decode_array_f64(cbor_reader_t const *reader,
+		cbor_item_t const *array, double *out, size_t maxn,
+		size_t *ndecoded);
 /**
  * Get the pointer to an item value
  *
@@ -14,6 +14,87 @@ extern "C" {
 #include "cbor/base.h"
 #include <stdbool.h>
 
+#if defined(CBOR_WRITER_SINK)
+/**
+ * Encode into a sink instead of a single fixed buffer.
+ *
+ * Once the writer buffer cannot take the next item, the bytes encoded so far
+ * are handed to @p sink and the buffer starts over, so encoding runs in
+ * constant memory. String payloads that do not fit in the buffer go to
+ * @p sink straight from the caller's memory without being copied. The buffer
+ * must hold at least 9 bytes, the largest item header.
+ *
+ * @param[in,out] writer writer context initialized by @ref cbor_writer_init
+ * @param[in] sink where full buffers go, or NULL to go back to
+ *            @ref CBOR_OVERRUN once the buffer is full
+ * @param[in] arg opaque pointer forwarded to every @p sink call
+ */
+void cbor_writer_set_sink(cbor_writer_t *writer, cbor_writer_sink_t sink,
+		void *arg);
+/**
+ * Hand the bytes left in the writer buffer to the sink.
+ *
+ * Call this after the last item, as the sink only gets full buffers before.
+ *
+ * @param[in,out] writer writer context
+ *
+ * @return @ref CBOR_SUCCESS, @ref CBOR_ABORTED when the sink returned false,
+ *         or @ref CBOR_INVALID without a sink
+ */
+cbor_error_t cbor_writer_flush(cbor_writer_t *writer);
+#endif
+#if defined(CBOR_WRITER_GROW)
+/**
+ * Grow the writer buffer instead of failing once it is full.
+ *
+ * The buffer at least doubles each time, so a message of n bytes takes
+ * O(log n) calls to @p grow. With @c realloc() the buffer given to
+ * @ref cbor_writer_init must come from @c malloc(), and the encoded message
+ * ends up in `writer->buf`, which the caller frees. A sink given by
+ * @ref cbor_writer_set_sink as well only gets the buffer when @p grow fails.
+ *
+ * @param[in,out] writer writer context initialized by @ref cbor_writer_init
+ * @param[in] grow the allocator, or NULL to stop growing
+ * @param[in] arg opaque pointer forwarded to every @p grow call
+ */
+void cbor_writer_set_grow(cbor_writer_t *writer, cbor_writer_grow_t grow,
+		void *arg);
+#endif
+#if defined(CBOR_WRITER_IOVEC)
+/**
+ * List the message as spans, referring to large string payloads in place.
+ *
+ * A byte or text string payload of @p threshold bytes or more is not copied
+ * into the writer buffer; only its header is, and the payload is listed as a
+ * span of the caller's memory, which must stay valid until the message is
+ * sent. Smaller payloads and everything else are copied as usual. The spans
+ * are ready for `writev()` or `sendmsg()` once
+ * @ref cbor_writer_finish_iovec lists the bytes left in the buffer.
+ *
+ * Payloads are copied as well when fewer than 3 spans are left, and while
+ * the buffer may move: with a sink, an allocator or a deferred-length
+ * container open.
+ *
+ * @param[in,out] writer writer context initialized by @ref cbor_writer_init
+ * @param[in] iov span storage, or NULL to copy every payload
+ * @param[in] maxiov the number of spans in @p iov
+ * @param[in] threshold the smallest payload size in bytes to refer to
+ */
+void cbor_writer_set_iovec(cbor_writer_t *writer, cbor_iovec_t *iov,
+		size_t maxiov, size_t threshold);
+/**
+ * List the bytes left in the writer buffer as the last span.
+ *
+ * Call this after the last item. Encoding more items afterwards and calling
+ * it again gives the longer message.
+ *
+ * @param[in,out] writer writer context
+ *
+ * @return the number of spans making up the message
+ */
+size_t cbor_writer_finish_iovec(cbor_writer_t *writer);
+#endif
+
 cbor_error_t cbor_encode_unsigned_integer(cbor_writer_t *writer, uint64_t value);
 cbor_error_t cbor_encode_negative_integer(cbor_writer_t *writer, int64_t value);
 
@@ -33,6 +114,179 @@ cbor_error_t cbor_encode_array_indefinite(cbor_writer_t *writer);
 cbor_error_t cbor_encode_map(cbor_writer_t *writer, size_t length);
 cbor_error_t cbor_encode_map_indefinite(cbor_writer_t *writer);
 
+#if defined(CBOR_WRITER_DEFERRED)
+/**
+ * Give the writer frames to track the containers being encoded.
+ *
+ * With frames, the writer counts the items done in each open container,
+ * which the deferred-length containers of @ref cbor_encode_array_begin and
+ * @ref cbor_encode_map_begin need. Each nesting level takes one frame; going
+ * deeper than @p maxframes gives @ref CBOR_EXCESSIVE. A BREAK with no
+ * indefinite-length container open gives @ref CBOR_INVALID.
+ *
+ * @param[in,out] writer writer context initialized by @ref cbor_writer_init
+ * @param[in] frames frame storage, or NULL to stop tracking
+ * @param[in] maxframes the number of frames in @p frames
+ */
+void cbor_writer_set_frames(cbor_writer_t *writer,
+		cbor_writer_frame_t *frames, size_t maxframes);
+
+/**
+ * Start an array whose length is written when it ends.
+ *
+ * The items encoded until @ref cbor_encode_array_end are counted, and the
+ * array gets the smallest definite-length header for them. One byte is
+ * reserved for the header, so arrays of up to 23 items are written in place
+ * and longer ones move their body once on close. The whole array stays in
+ * the writer buffer until then, so a sink given by @ref cbor_writer_set_sink
+ * does not get the buffer while a deferred-length container is open.
+ *
+ * @param[in,out] writer writer context with frames given by
+ *                @ref cbor_writer_set_frames
+ *
+ * @return a code of @ref cbor_error_t, @ref CBOR_INVALID without frames
+ */
+cbor_error_t cbor_encode_array_begin(cbor_writer_t *writer);
+/**
+ * End the innermost array started by @ref cbor_encode_array_begin.
+ *
+ * @param[in,out] writer writer context
+ *
+ * @return a code of @ref cbor_error_t, @ref CBOR_INVALID when the innermost
+ *         open container is not such an array
+ */
+cbor_error_t cbor_encode_array_end(cbor_writer_t *writer);
+/**
+ * Start a map whose length is written when it ends.
+ *
+ * The same as @ref cbor_encode_array_begin, counting pairs.
+ */
+cbor_error_t cbor_encode_map_begin(cbor_writer_t *writer);
+/**
+ * End the innermost map started by @ref cbor_encode_map_begin.
+ *
+ * @param[in,out] writer writer context
+ *
+ * @return a code of @ref cbor_error_t, @ref CBOR_INVALID when the innermost
+ *         open container is not such a map or a key has no value
+ */
+cbor_error_t cbor_encode_map_end(cbor_writer_t *writer);
+#endif
+
+#if defined(CBOR_WRITER_SORTED)
+/**
+ * Give the writer scratch memory for sorted maps.
+ *
+ * A sorted map keeps the spans of its entries in @p scratch while open, and
+ * needs as much again as its encoded body when it ends to put the entries
+ * in order. Nested sorted maps take their share on top of the outer ones.
+ *
+ * @param[in,out] writer writer context initialized by @ref cbor_writer_init
+ * @param[in] scratch memory aligned for `size_t`, or NULL
+ * @param[in] scratch_size the size of @p scratch in bytes
+ */
+void cbor_writer_set_scratch(cbor_writer_t *writer, void *scratch,
+		size_t scratch_size);
+/**
+ * Start a map whose entries are sorted when it ends.
+ *
+ * The same as @ref cbor_encode_map_begin, but @ref cbor_encode_map_end puts
+ * the entries in the bytewise lexicographic order of their encoded keys, as
+ * core deterministic encoding (RFC 8949 §4.2.1) wants. As the encoder always
+ * writes the shortest form of arguments and floats, a message of definite
+ * lengths with every map sorted this way is deterministically encoded.
+ *
+ * @ref cbor_encode_map_end then gives @ref CBOR_EXCESSIVE when the scratch
+ * was not enough, and @ref CBOR_INVALID for a duplicate key.
+ *
+ * @param[in,out] writer writer context with frames given by
+ *                @ref cbor_writer_set_frames and scratch given by
+ *                @ref cbor_writer_set_scratch
+ *
+ * @return a code of @ref cbor_error_t, @ref CBOR_INVALID without frames or
+ *         scratch
+ */
+cbor_error_t cbor_encode_sorted_map_begin(cbor_writer_t *writer);
+#endif
+
+#if defined(CBOR_WRITER_STRINGREF)
+/**
+ * Give the writer a table to share repeated strings in.
+ *
+ * Once @ref cbor_encode_stringref_namespace starts a namespace, a byte or
+ * text string encoded before in it is written as a reference, tag 25 with
+ * the string number, per the stringref extension (tags 25 and 256). Up to
+ * three quarters of @p maxstrings strings are kept for lookup; the rest are
+ * written as they are.
+ *
+ * @param[in,out] writer writer context initialized by @ref cbor_writer_init
+ * @param[in] strings table storage, or NULL to stop sharing strings
+ * @param[in] maxstrings the number of entries in @p strings
+ */
+void cbor_writer_set_stringrefs(cbor_writer_t *writer,
+		cbor_stringref_t *strings, size_t maxstrings);
+/**
+ * Start a stringref namespace, tag 256, wrapping the item that follows.
+ *
+ * Call it right before the top-level item; the namespace ends with that
+ * item, and the items after it are written as they are. As the strings are
+ * looked up in the writer buffer, it keeps the whole message meanwhile: a
+ * sink does not get the buffer, payloads are not referred to as spans, and
+ * deferred-length containers can not be used. In the namespace, up to
+ * @ref CBOR_RECURSION_MAX_LEVEL indefinite-length items can be open at a
+ * time; one more gives @ref CBOR_EXCESSIVE.
+ *
+ * @param[in,out] writer writer context with a table given by
+ *                @ref cbor_writer_set_stringrefs
+ *
+ * @return a code of @ref cbor_error_t, @ref CBOR_INVALID without a table,
+ *         in a dry run, in a namespace or with a deferred-length container
+ *         open
+ */
+cbor_error_t cbor_encode_stringref_namespace(cbor_writer_t *writer);
+#endif
+
+/**
+ * Encode an array of unsigned integers from a native array.
+ *
+ * Gives the same bytes as @ref cbor_encode_array followed by
+ * @ref cbor_encode_unsigned_integer for each value, in one call. On error
+ * nothing of the array is left in the writer buffer, unless part of it
+ * already went to a sink.
+ *
+ * @param[in,out] writer writer context
+ * @param[in] values the values to encode
+ * @param[in] n the number of @p values
+ *
+ * @return a code of @ref cbor_error_t
+ */
+cbor_error_t cbor_encode_array_u64(cbor_writer_t *writer,
+		uint64_t const *values, size_t n);
+/**
+ * Encode an array of integers from a native array.
+ *
+ * See @ref cbor_encode_array_u64. Each value is encoded as by
+ * @ref cbor_encode_negative_integer when negative.
+ */
+cbor_error_t cbor_encode_array_i64(cbor_writer_t *writer,
+		int64_t const *values, size_t n);
+/**
+ * Encode an array of floats from a native array.
+ *
+ * See @ref cbor_encode_array_u64. Each value is shrunk as by
+ * @ref cbor_encode_float.
+ */
+cbor_error_t cbor_encode_array_f32(cbor_writer_t *writer,
+		float const *values, size_t n);
+/**
+ * Encode an array of doubles from a native array.
+ *
+ * See @ref cbor_encode_array_u64. Each value is shrunk as by
+ * @ref cbor_encode_double.
+ */
+cbor_error_t cbor_encode_array_f64(cbor_writer_t *writer,
+		double const *values, size_t n);
+
 cbor_error_t cbor_encode_tag(cbor_writer_t *writer, uint64_t tag_number);
 
 cbor_error_t cbor_encode_break(cbor_writer_t *writer);
@@ -45,6 +299,78 @@ cbor_error_t cbor_encode_undefined(cbor_writer_t *writer);
 cbor_error_t cbor_encode_float(cbor_writer_t *writer, float value);
 cbor_error_t cbor_encode_double(cbor_writer_t *writer, double value);
 
+/* Whether the writer tracks containers, never without CBOR_WRITER_DEFERRED. */
+#if defined(CBOR_WRITER_DEFERRED)
+#define cbor_writer_is_tracking(writer)		((writer)->frames != NULL)
+#else
+#define cbor_writer_is_tracking(writer)		false
+#endif
+/* Whether the writer only measures, never without CBOR_WRITER_DRY_RUN. */
+#if defined(CBOR_WRITER_DRY_RUN)
+#define cbor_writer_is_dry_run(writer)		((writer)->dry_run)
+#else
+#define cbor_writer_is_dry_run(writer)		false
+#endif
+
+/*
+ * Inline fast paths for one-byte items, stored in place without a call when
+ * the buffer has room and the writer neither tracks containers nor only
+ * measures. Anything else goes to the function of the same name without
+ * the `_inline` suffix, which stores wider arguments in place as well.
+ * The conditions are spelled out and non-short-circuit in each to keep them
+ * small enough to be inlined at -Os.
+ */
+static inline cbor_error_t cbor_encode_unsigned_integer_inline(
+		cbor_writer_t *writer, uint64_t value)
+{
+	if ((value < 24) & (writer->bufidx < writer->bufsize) &
+			!cbor_writer_is_tracking(writer) &
+			!cbor_writer_is_dry_run(writer)) {
+		writer->buf[writer->bufidx++] = (uint8_t)value;
+		return CBOR_SUCCESS;
+	}
+
+	return cbor_encode_unsigned_integer(writer, value);
+}
+
+static inline cbor_error_t cbor_encode_negative_integer_inline(
+		cbor_writer_t *writer, int64_t value)
+{
+	if ((value < 0) & (value >= -24) & (writer->bufidx < writer->bufsize) &
+			!cbor_writer_is_tracking(writer) &
+			!cbor_writer_is_dry_run(writer)) {
+		writer->buf[writer->bufidx++] = (uint8_t)(0x20 | (-1 - value));
+		return CBOR_SUCCESS;
+	}
+
+	return cbor_encode_negative_integer(writer, value);
+}
+
+static inline cbor_error_t cbor_encode_bool_inline(cbor_writer_t *writer,
+		bool value)
+{
+	if ((writer->bufidx < writer->bufsize) &
+			!cbor_writer_is_tracking(writer) &
+			!cbor_writer_is_dry_run(writer)) {
+		writer->buf[writer->bufidx++] = (uint8_t)(0xF4u + value);
+		return CBOR_SUCCESS;
+	}
+
+	return cbor_encode_bool(writer, value);
+}
+
+static inline cbor_error_t cbor_encode_null_inline(cbor_writer_t *writer)
+{
+	if ((writer->bufidx < writer->bufsize) &
+			!cbor_writer_is_tracking(writer) &
+			!cbor_writer_is_dry_run(writer)) {
+		writer->buf[writer->bufidx++] = 0xF6;
+		return CBOR_SUCCESS;
+	}
+
+	return cbor_encode_null(writer);
+}
+
 #if defined(__cplusplus)
 }
 #endif
@@ -217,6 +217,24 @@ size_t cbor_iterate(const cbor_reader_t *reader,
 			    void *arg),
 		    void *arg);
 
+/**
+ * @brief Get the item following the subtree of a parsed item.
+ *
+ * Steps over everything nested in @p item, so for an item in a container the
+ * result is its next sibling. After the last child of an indefinite-length
+ * container, the result is the BREAK closing it; after the last child of a
+ * definite-length one, it is whatever follows the container.
+ *
+ * With a sibling index given by cbor_reader_set_sibling_index(), this takes
+ * constant time. Otherwise the subtree gets walked.
+ *
+ * @param[in] reader CBOR reader context.
+ * @param[in] item   Item from reader->items.
+ * @return The next item, or NULL if @p item is the last one.
+ */
+const cbor_item_t *cbor_next_sibling(const cbor_reader_t *reader,
+		const cbor_item_t *item);
+
 /**
  * @brief Convert CBOR error code to string.
  *
@@ -47,6 +47,22 @@ double ieee754_convert_half_to_double(uint16_t value);
 bool ieee754_is_shrinkable_to_half(float value);
 bool ieee754_is_shrinkable_to_single(double value);
 
+/**
+ * Find the shortest of half, single and double precision representing the
+ * value exactly, as preferred serialization wants.
+ *
+ * @param[in] value floating-point value to shrink
+ * @param[out] bits the bits of the value in the shortest precision
+ *
+ * @return the size in bytes of the shortest precision: 2, 4 or 8
+ */
+unsigned int ieee754_shrink_double(double value, uint64_t *bits);
+/**
+ * The same as @ref ieee754_shrink_double for a single precision value,
+ * returning 2 or 4.
+ */
+unsigned int ieee754_shrink_single(float value, uint64_t *bits);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -13,6 +13,78 @@ extern "C" {
 
 #include "cbor/base.h"
 
+/**
+ * Give the parser a frame stack of its own.
+ *
+ * The parser does not recurse. It keeps one @ref cbor_parser_frame_t per
+ * nesting level, the top level included, so @p maxframes is the nesting limit
+ * in the same sense as @ref CBOR_RECURSION_MAX_LEVEL. Messages nesting deeper
+ * make @ref cbor_parse return @ref CBOR_EXCESSIVE.
+ *
+ * Without a frame stack given, @ref cbor_parse uses
+ * @ref CBOR_RECURSION_MAX_LEVEL frames on the call stack.
+ *
+ * @param[in,out] reader reader context initialized by @ref cbor_reader_init
+ * @param[in] frames frame storage, or NULL to go back to the default
+ * @param[in] maxframes the number of frames in @p frames
+ */
+void cbor_reader_set_frames(cbor_reader_t *reader,
+		cbor_parser_frame_t *frames, size_t maxframes);
+
+/**
+ * Have the parser record where the subtree of each item ends.
+ *
+ * While parsing, @p siblings[i] gets the index of the item following the
+ * subtree of item i, i.e. of its next sibling. For a scalar it is i + 1; for a
+ * container, a tag or an indefinite-length string it is past all the nested
+ * items, including any BREAK. The helpers use it to step over subtrees without
+ * walking them. The index is complete once @ref cbor_parse returns
+ * @ref CBOR_SUCCESS or @ref CBOR_BREAK.
+ *
+ * @param[in,out] reader reader context initialized by @ref cbor_reader_init
+ * @param[out] siblings storage for as many entries as the reader has items,
+ *             or NULL to stop recording
+ */
+void cbor_reader_set_sibling_index(cbor_reader_t *reader, size_t *siblings);
+
+/**
+ * Have the parser check text strings to be well-formed UTF-8.
+ *
+ * Each definite-length text string, and each chunk of an indefinite-length
+ * one, must be well-formed on its own as RFC 8949 requires. Otherwise
+ * @ref cbor_parse returns @ref CBOR_INVALID, leaving @p reader->msgidx at the
+ * offset of the first byte that can not continue well-formed UTF-8, or just
+ * past the string when it ends in the middle of a code point.
+ *
+ * @param[in,out] reader reader context initialized by @ref cbor_reader_init
+ * @param[in] enable true to validate, false to store text strings unchecked
+ */
+void cbor_reader_set_utf8_validation(cbor_reader_t *reader, bool enable);
+
+/**
+ * Have the parser resolve shared string references.
+ *
+ * Within a stringref namespace, tag 256, strings are numbered as they
+ * appear, and a reference, tag 25 wrapping a string number, stands for the
+ * string of that number. Once the message is parsed, the item following
+ * each tag 25 is replaced with the item of the string it refers to, so
+ * @ref cbor_decode and @ref cbor_decode_pointer give the original bytes. The
+ * tag items stay in place like any other tags.
+ *
+ * @ref cbor_parse then returns @ref CBOR_INVALID for a reference to a string
+ * not numbered yet, and @ref CBOR_EXCESSIVE when it refers past the
+ * @p maxstringrefs strings @p stringrefs can number, nested namespaces
+ * included. References are resolved without recursion, within the same
+ * nesting limit as parsing, see @ref cbor_reader_set_frames.
+ *
+ * @param[in,out] reader reader context initialized by @ref cbor_reader_init
+ * @param[out] stringrefs storage numbering the strings, or NULL to leave
+ *             references as they are
+ * @param[in] maxstringrefs the number of entries in @p stringrefs
+ */
+void cbor_reader_set_stringrefs(cbor_reader_t *reader,
+		size_t *stringrefs, size_t maxstringrefs);
+
 /**
  * Parse the encoded CBOR messages into items.
  *
@@ -26,6 +98,36 @@ extern "C" {
 cbor_error_t cbor_parse(cbor_reader_t *reader, void const *msg, size_t msgsize,
 		size_t *nitems_parsed);
 
+/**
+ * Parse a CBOR message that may be only partly received yet.
+ *
+ * Items are stored into the reader's item table as far as @p msg goes. When
+ * @p msg ends in the middle of an item, the parser keeps its place in the
+ * reader and returns @ref CBOR_NEED_MORE. Call again with the same message
+ * grown by the newly received bytes, and parsing continues where it stopped
+ * without walking the bytes already parsed. @p msg may move between calls as
+ * long as its leading bytes stay the same, e.g. after realloc().
+ *
+ * The reader must have frames of its own given by @ref cbor_reader_set_frames,
+ * as the parser state outlives the call. A new message starts after
+ * @ref cbor_reader_init, @ref cbor_parse or any error other than
+ * @ref CBOR_NEED_MORE.
+ *
+ * @param[in,out] reader reader context with frames given
+ * @param[in] msg CBOR encoded message received so far
+ * @param[in] msgsize the @p msg size in bytes
+ * @param[out] nitems_parsed the number of items parsed gets stored if not null
+ *
+ * @return @ref CBOR_NEED_MORE when @p msg ends in the middle of an item or of
+ *         an open container, @ref CBOR_SUCCESS when it ends on a top-level item
+ *         boundary, or any other code of @ref cbor_error_t on error. Unlike
+ *         @ref cbor_parse(), this never returns @ref CBOR_BREAK. Without frames
+ *         given, or with @p msgsize smaller than what was parsed before,
+ *         @ref CBOR_INVALID is returned.
+ */
+cbor_error_t cbor_parse_resume(cbor_reader_t *reader, void const *msg,
+		size_t msgsize, size_t *nitems_parsed);
+
 /**
  * Count CBOR items from encoded CBOR message without storing item metadata.
  *
@@ -36,6 +138,9 @@ cbor_error_t cbor_parse(cbor_reader_t *reader, void const *msg, size_t msgsize,
  *             is an error, and then indicates the number of items counted
  *             before the parser stopped.
  *
+ * @note Counting nests up to @ref CBOR_RECURSION_MAX_LEVEL levels. Use
+ *       @ref cbor_count_items_with_frames for the limit set at runtime.
+ *
  * @return a code of @ref cbor_error_t. Unlike @ref cbor_parse(),
  *         well-formed indefinite-length items do not cause this function to
  *         return @ref CBOR_BREAK; they are reported as @ref CBOR_SUCCESS.
@@ -43,6 +148,91 @@ cbor_error_t cbor_parse(cbor_reader_t *reader, void const *msg, size_t msgsize,
 cbor_error_t cbor_count_items(void const *msg, size_t msgsize,
 		size_t *nitems_counted);
 
+/**
+ * Count CBOR items as @ref cbor_count_items does, keeping nesting levels in
+ * the given frames.
+ *
+ * Pass the same frames as given by @ref cbor_reader_set_frames so that
+ * counting accepts the messages parsing does. Messages nesting deeper than
+ * @p maxframes levels give @ref CBOR_EXCESSIVE.
+ *
+ * @param[in] msg CBOR encoded message
+ * @param[in] msgsize the @p msg size in bytes
+ * @param[in] frames frame storage
+ * @param[in] maxframes the number of frames in @p frames
+ * @param[out] nitems_counted the number of items counted gets stored
+ *             if not null, as in @ref cbor_count_items
+ *
+ * @return a code of @ref cbor_error_t as in @ref cbor_count_items
+ */
+cbor_error_t cbor_count_items_with_frames(void const *msg, size_t msgsize,
+		cbor_parser_frame_t *frames, size_t maxframes,
+		size_t *nitems_counted);
+
+/**
+ * A top-level item of a CBOR sequence (RFC 8742), as found by
+ * @ref cbor_split_sequence.
+ */
+typedef struct {
+	size_t offset; /**< where the record starts in the sequence */
+	size_t size; /**< the record size in bytes */
+	size_t nitems; /**< the number of items @ref cbor_parse will need */
+} cbor_seq_record_t;
+
+/**
+ * Find the top-level item boundaries of a CBOR sequence (RFC 8742).
+ *
+ * Records are only skipped over, not stored, so splitting is a cheap first
+ * pass. Each record can then be parsed with @ref cbor_parse on its own at
+ * @p msg + offset, into a reader of its own. Records share nothing, so they
+ * can be parsed in any order or concurrently, e.g. one reader and item table
+ * per worker thread, with results and errors kept per record index.
+ *
+ * @param[in] msg CBOR sequence
+ * @param[in] msgsize the @p msg size in bytes
+ * @param[out] records record table to be filled in sequence order
+ * @param[in] maxrecords the number of records @p records can hold
+ * @param[out] nrecords_found the number of records found gets stored if not
+ *             null. This value is written even when the return code is an
+ *             error, and then indicates the records found before the splitter
+ *             stopped. The bytes after the last record found are left for the
+ *             caller.
+ *
+ * @return @ref CBOR_SUCCESS when all of @p msg was split,
+ *         @ref CBOR_NEED_MORE when it ends in the middle of a record,
+ *         @ref CBOR_OVERRUN when @p records got full before the end, or any
+ *         other code of @ref cbor_error_t for a malformed record. A malformed
+ *         record hides where the next one starts, so splitting stops there.
+ */
+cbor_error_t cbor_split_sequence(void const *msg, size_t msgsize,
+		cbor_seq_record_t *records, size_t maxrecords,
+		size_t *nrecords_found);
+
+/**
+ * Split a CBOR sequence as @ref cbor_split_sequence does, keeping nesting
+ * levels in the given frames.
+ *
+ * @ref cbor_split_sequence nests up to @ref CBOR_RECURSION_MAX_LEVEL levels,
+ * keeping its frames on the call stack. Pass the same frames as given by @ref cbor_reader_set_frames so that the
+ * records split are the ones parsing accepts. Records nesting deeper than
+ * @p maxframes levels give @ref CBOR_EXCESSIVE.
+ *
+ * @param[in] msg CBOR sequence
+ * @param[in] msgsize the @p msg size in bytes
+ * @param[in] frames frame storage
+ * @param[in] maxframes the number of frames in @p frames
+ * @param[out] records record table to be filled in sequence order
+ * @param[in] maxrecords the number of records @p records can hold
+ * @param[out] nrecords_found the number of records found gets stored if not
+ *             null, as in @ref cbor_split_sequence
+ *
+ * @return a code of @ref cbor_error_t as in @ref cbor_split_sequence
+ */
+cbor_error_t cbor_split_sequence_with_frames(void const *msg, size_t msgsize,
+		cbor_parser_frame_t *frames, size_t maxframes,
+		cbor_seq_record_t *records, size_t maxrecords,
+		size_t *nrecords_found);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -13,6 +13,8 @@ extern "C" {
 
 #include "cbor/base.h"
 
+struct cbor_parser;
+
 typedef char cbor_stream_depth_must_fit_uint8_t[
 	(CBOR_RECURSION_MAX_LEVEL < 256) ? 1 : -1];
 
@@ -25,6 +27,9 @@ typedef char cbor_stream_depth_must_fit_uint8_t[
 #define CBOR_STREAM_MAX_PENDING_TAGS 4
 #endif
 
+/** Maximum number of paths cbor_stream_set_paths() takes. */
+#define CBOR_STREAM_MAX_PATHS 32
+
 typedef enum {
 	CBOR_STREAM_EVENT_UINT,
 	CBOR_STREAM_EVENT_INT,
@@ -60,6 +65,9 @@ typedef struct {
 	cbor_stream_event_type_t type;
 	uint8_t  depth;       /**< nesting depth: 0 = top level */
 	bool     is_map_key;  /**< true when this item is a map key */
+	/** the subscribed path the item falls under; NULL without paths set by
+	 * cbor_stream_set_paths() */
+	const struct cbor_parser *parser;
 } cbor_stream_event_t;
 
 /**
@@ -98,6 +106,24 @@ typedef union {
 	uint64_t tag;     /**< CBOR_STREAM_EVENT_TAG — tag number */
 } cbor_stream_data_t;
 
+/**
+ * What the decoder does after a callback returns.
+ *
+ * ABORT and CONTINUE have the values of false and true.
+ */
+typedef enum {
+	CBOR_STREAM_ABORT    = 0, /**< stop decoding with CBOR_ABORTED */
+	CBOR_STREAM_CONTINUE = 1, /**< go on to the next event */
+	/**
+	 * Consume the rest of the item the event is part of without events:
+	 * everything in a container after its START, including its END, the
+	 * chunks of a string after this one, or the item a TAG wraps. Skipped
+	 * strings are stepped over a chunk at a time and are not checked as
+	 * UTF-8. The same as CONTINUE for any other event.
+	 */
+	CBOR_STREAM_SKIP     = 2,
+} cbor_stream_action_t;
+
 /**
  * Streaming event callback.
  *
@@ -105,15 +131,40 @@ typedef union {
  * @param[in] data   decoded value; NULL for _END events
  * @param[in] arg    user-supplied context pointer
  *
- * @return true to continue decoding, false to abort (CBOR_ABORTED)
+ * @return CBOR_STREAM_CONTINUE to go on, CBOR_STREAM_SKIP to step over the
+ *         rest of the item, or CBOR_STREAM_ABORT to stop (CBOR_ABORTED)
  */
-typedef bool (*cbor_stream_callback_t)(const cbor_stream_event_t *event,
+typedef cbor_stream_action_t (*cbor_stream_callback_t)(
+		const cbor_stream_event_t *event,
 		const cbor_stream_data_t *data, void *arg);
 
+/** An event with its value, as a batch holds it */
+typedef struct {
+	cbor_stream_event_t event;
+	cbor_stream_data_t  data; /**< not set for _END events */
+} cbor_stream_record_t;
+
+/**
+ * Batch callback, taking the events decoded since the last call.
+ *
+ * @param[in] records events in stream order; string chunks point into the
+ *                    chunk being fed
+ * @param[in] n       number of @p records, at least 1
+ * @param[in] arg     user-supplied context pointer
+ *
+ * @return true to continue decoding, false to abort (CBOR_ABORTED)
+ */
+typedef bool (*cbor_stream_batch_callback_t)(
+		const cbor_stream_record_t *records, size_t n, void *arg);
+
 typedef struct {
 	cbor_item_data_t type;
 	int64_t          count; /**< remaining items; -1 = indefinite */
 	bool             is_key;
+	bool             deliver;   /**< events under it go to the callback */
+	uint32_t         match;     /**< paths still to be matched under it */
+	uint32_t         key_match; /**< of those, the ones the key matches */
+	size_t           index;     /**< items completed so far */
 } cbor_stream_frame_t;
 
 typedef struct {
@@ -124,6 +175,7 @@ typedef struct {
 	uint8_t following_bytes;         /**< length descriptor bytes expected */
 	uint8_t following_bytes_read;    /**< length descriptor bytes received */
 	uint8_t length_buf[8];           /**< accumulation buffer for length/value */
+	uint64_t argument;               /**< length/value decoded from them */
 
 	int64_t payload_remaining;       /**< bytes left in current string payload */
 	int64_t payload_total;           /**< declared total for current string */
@@ -139,12 +191,41 @@ typedef struct {
 	cbor_stream_frame_t stack[CBOR_RECURSION_MAX_LEVEL];
 	uint8_t             depth;
 
+	/* ---- path filter ---- */
+	const struct cbor_parser *paths;
+	uint8_t                   nr_paths;
+	const struct cbor_parser *parser; /**< path of the subtree delivered */
+	bool                      str_deliver; /**< current string delivered */
+	bool                      skip_next;   /**< item after a skipped TAG */
+	size_t                    key_offset;  /**< string key bytes matched */
+
+	/* ---- text validation ---- */
+	bool    validate_utf8;           /**< check text strings as UTF-8 */
+	uint8_t utf8_state;              /**< code point split between feeds */
+
 	/* ---- error state ---- */
 	cbor_error_t error;
+	size_t       offset;             /**< bytes consumed since init/reset */
 
 	/* ---- callback ---- */
 	cbor_stream_callback_t callback;
 	void                  *callback_arg;
+
+	/* ---- event being delivered ---- */
+	cbor_stream_record_t record;
+
+	/* ---- batch mode ---- */
+	cbor_stream_record_t        *batch;     /**< events handed over at once */
+	size_t                       batch_cap;
+	size_t                       batch_len; /**< events in it so far */
+	cbor_stream_batch_callback_t batch_callback;
+
+	/* ---- pull mode ---- */
+	bool           pull;             /**< events taken by cbor_stream_next() */
+	bool           pulled;           /**< an event is ready to be taken, or
+					      put in the batch */
+	const uint8_t *input;            /**< bytes fed but not decoded yet */
+	size_t         input_len;
 } cbor_stream_decoder_t;
 
 /**
@@ -152,8 +233,8 @@ typedef struct {
  *
  * The decoder accepts zero or more consecutive top-level CBOR items
  * (sequence semantics, per RFC 8742).  Callers that need "exactly one item"
- * semantics should return false from the callback after the first complete
- * top-level item (depth transitions back to 0).
+ * semantics should return CBOR_STREAM_ABORT from the callback after the
+ * first complete top-level item (depth transitions back to 0).
  *
  * @param[in,out] decoder  decoder context allocated by caller (zeroed on init)
  * @param[in]     callback event callback; if NULL, subsequent feed() calls
@@ -163,6 +244,90 @@ typedef struct {
 void cbor_stream_init(cbor_stream_decoder_t *decoder,
 		cbor_stream_callback_t callback, void *arg);
 
+/**
+ * Initialize a streaming CBOR decoder to be pulled with cbor_stream_next().
+ *
+ * No callback is involved. cbor_stream_feed() only hands a chunk over to the
+ * decoder, and each cbor_stream_next() decodes just enough of it to return
+ * the next event. The events and their order are the same as the callback
+ * decoder's.
+ *
+ * @param[in,out] decoder decoder context allocated by caller (zeroed on init)
+ */
+void cbor_stream_init_pull(cbor_stream_decoder_t *decoder);
+
+/**
+ * Initialize a streaming CBOR decoder to hand over events in batches.
+ *
+ * Events are decoded into @p records instead of being passed one by one, and
+ * @p callback takes them at once when @p records is full and at the end of
+ * each cbor_stream_feed(), so a string chunk never outlives the chunk fed.
+ * Events decoded before an error are handed over before it is returned. The
+ * events and their order are the same as the callback decoder's; a batch
+ * cannot skip items.
+ *
+ * @param[in,out] decoder    decoder context allocated by caller (zeroed on
+ *                           init)
+ * @param[in]     records    storage for a batch, kept by reference and across
+ *                           cbor_stream_reset()
+ * @param[in]     nr_records number of entries in @p records
+ * @param[in]     callback   batch callback; if NULL, or @p records is NULL or
+ *                           @p nr_records is 0, subsequent feed() calls return
+ *                           CBOR_INVALID
+ * @param[in]     arg        opaque pointer forwarded to every callback
+ */
+void cbor_stream_init_batch(cbor_stream_decoder_t *decoder,
+		cbor_stream_record_t *records, size_t nr_records,
+		cbor_stream_batch_callback_t callback, void *arg);
+
+/**
+ * Have the decoder check text strings to be well-formed UTF-8.
+ *
+ * Each definite-length text string, and each chunk of an indefinite-length
+ * one, must be well-formed on its own. A code point may still be split
+ * between two feed() calls. Bytes are checked before they are handed to the
+ * callback, so a TEXT event never carries ill-formed UTF-8. Text that is not
+ * handed over, as it is skipped or under no subscribed path, is not checked.
+ *
+ * On failure cbor_stream_feed() returns CBOR_INVALID and @p decoder->offset
+ * is the stream offset of the first byte that can not continue well-formed
+ * UTF-8, or just past the string when it ends in the middle of a code point.
+ *
+ * @param[in,out] decoder decoder context initialized by cbor_stream_init()
+ * @param[in]     enable  true to validate; kept across cbor_stream_reset()
+ */
+void cbor_stream_set_utf8_validation(cbor_stream_decoder_t *decoder,
+		bool enable);
+
+/**
+ * Have the decoder hand over only the items under the given paths.
+ *
+ * Paths are matched the way cbor_unmarshal() does, but against the stream:
+ * the decoder keeps the key path itself and the callback gets the events of
+ * a matching item and of everything nested in it, with @p event->parser
+ * pointing to the path. Every other item is skipped without building an
+ * event, so the memory taken stays the decoder alone, however large the
+ * message. Only the path and depth of each parser are used; @p run is not
+ * called as there is no item to call it with.
+ *
+ * A string key is compared chunk by chunk as it comes, so it may be split
+ * between feeds too. When an item matches more than one path, the first one
+ * in @p parsers is given.
+ *
+ * @param[in,out] decoder    decoder context initialized by cbor_stream_init()
+ *                           or cbor_stream_init_pull()
+ * @param[in]     parsers    paths to subscribe to; kept by reference, and
+ *                           across cbor_stream_reset(). NULL for every item
+ * @param[in]     nr_parsers number of entries in @p parsers
+ *
+ * @return CBOR_SUCCESS   — the paths are set
+ *         CBOR_INVALID   — @p decoder is NULL, or @p parsers is NULL with
+ *                          @p nr_parsers > 0
+ *         CBOR_EXCESSIVE — more than @ref CBOR_STREAM_MAX_PATHS paths
+ */
+cbor_error_t cbor_stream_set_paths(cbor_stream_decoder_t *decoder,
+		const struct cbor_parser *parsers, size_t nr_parsers);
+
 /**
  * Feed bytes into the decoder.
  *
@@ -176,6 +341,12 @@ void cbor_stream_init(cbor_stream_decoder_t *decoder,
  * argument validation failures (for example NULL decoder/callback, or NULL
  * data with len > 0) return CBOR_INVALID but do not modify decoder state.
  * Call cbor_stream_reset() to clear a sticky error and reuse the decoder.
+ * @p decoder->offset counts the bytes consumed, up to where an error stopped
+ * decoding.
+ *
+ * A decoder initialized by cbor_stream_init_pull() decodes nothing here; it
+ * keeps @p data to be decoded by cbor_stream_next(). Feeding it again before
+ * cbor_stream_next() returned CBOR_NEED_MORE returns CBOR_INVALID.
  *
  * @param[in,out] decoder decoder context initialized by cbor_stream_init()
  * @param[in]     data    pointer to bytes to consume (may be NULL if len == 0)
@@ -186,11 +357,52 @@ void cbor_stream_init(cbor_stream_decoder_t *decoder,
  *         CBOR_INVALID   — semantically invalid item, or invalid API arguments;
  *                          sticky only for the former
  *         CBOR_EXCESSIVE — nesting depth or tag nesting exceeded limit; sticky
- *         CBOR_ABORTED   — callback returned false; sticky
+ *         CBOR_ABORTED   — callback returned CBOR_STREAM_ABORT, or a batch
+ *                          callback false; sticky
  */
 cbor_error_t cbor_stream_feed(cbor_stream_decoder_t *decoder,
 		const void *data, size_t len);
 
+/**
+ * Take the next event from the bytes fed so far.
+ *
+ * Only for a decoder initialized by cbor_stream_init_pull(). When the chunk
+ * given to cbor_stream_feed() runs out before the next event is complete,
+ * CBOR_NEED_MORE is returned and the next chunk can be fed. A string chunk
+ * points into the chunk it came from, so a chunk has to stay valid until
+ * CBOR_NEED_MORE is returned for it.
+ *
+ * The event is handed out the way a callback gets it, without a copy: both
+ * pointers are into @p decoder and stay valid until it is called again.
+ * Errors are sticky, the same as for cbor_stream_feed().
+ *
+ * @param[in,out] decoder decoder context initialized by cbor_stream_init_pull()
+ * @param[out]    event   structural context of the event
+ * @param[out]    data    decoded value; NULL for _END events
+ *
+ * @return CBOR_SUCCESS   — @p event and @p data point to the next event
+ *         CBOR_NEED_MORE — every byte fed is decoded; feed the next chunk
+ *         CBOR_INVALID   — not a pull decoder or NULL arguments, not sticky;
+ *                          or a semantically invalid item, sticky
+ *         CBOR_ILLEGAL / CBOR_EXCESSIVE — as for cbor_stream_feed(); sticky
+ */
+cbor_error_t cbor_stream_next(cbor_stream_decoder_t *decoder,
+		const cbor_stream_event_t **event, const cbor_stream_data_t **data);
+
+/**
+ * Step over the rest of the item the event last taken is part of.
+ *
+ * The pull counterpart of a callback returning CBOR_STREAM_SKIP: the next
+ * cbor_stream_next() returns the first event after the item.
+ *
+ * @param[in,out] decoder decoder context initialized by cbor_stream_init_pull()
+ *
+ * @return CBOR_SUCCESS — the item is to be skipped, or there is nothing left
+ *                        of it to skip
+ *         CBOR_INVALID — not a pull decoder
+ */
+cbor_error_t cbor_stream_skip(cbor_stream_decoder_t *decoder);
+
 /**
  * Signal end of input and verify the decoder is in a clean idle state.
  *
@@ -207,13 +419,16 @@ cbor_error_t cbor_stream_feed(cbor_stream_decoder_t *decoder,
  *                          containers closed (zero or more top-level items
  *                          received)
  *         CBOR_NEED_MORE — stream ended mid-item or with unclosed containers
- *                          or pending tag prefix; more bytes needed
+ *                          or pending tag prefix; more bytes needed. Also
+ *                          when a pull decoder has events left to take
  *         <sticky error> — the last non-success error from feed()
  */
 cbor_error_t cbor_stream_finish(cbor_stream_decoder_t *decoder);
 
 /**
- * Reset decoder to initial state, preserving the callback.
+ * Reset decoder to initial state, preserving the callback and options.
+ * A pull decoder stays a pull decoder and drops the chunk fed to it, and a
+ * batch decoder keeps its records.
  *
  * @param[in,out] decoder decoder context
  */
@@ -0,0 +1,40 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Kyunghwan Kwon <k@mononn.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CBOR_UTF8_H
+#define CBOR_UTF8_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Validator state at a code point boundary, where a text string may end. */
+#define CBOR_UTF8_ACCEPT			0u
+
+/**
+ * Check bytes for well-formed UTF-8 (RFC 3629), possibly in pieces.
+ *
+ * A code point split between two calls is carried over in @p state. A text
+ * string is well-formed when every piece passes and @p state is back to
+ * @ref CBOR_UTF8_ACCEPT after the last one.
+ *
+ * @param[in,out] state @ref CBOR_UTF8_ACCEPT at the start of a string
+ * @param[in] s bytes to check
+ * @param[in] len the number of bytes in @p s
+ *
+ * @return the offset of the first byte that can not continue well-formed
+ *         UTF-8, or @p len if there is none
+ */
+size_t cbor_utf8_validate(uint8_t *state, uint8_t const *s, size_t len);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* CBOR_UTF8_H */
@@ -42,26 +42,65 @@ size_t cbor_copy_be(uint8_t *dst, uint8_t const *src, size_t len)
 	return copy_be(dst, src, len);
 }
 
+bool cbor_stringref_is_numbered(size_t len, uint64_t index)
+{
+	if (index < 24) {
+		return len >= 3;
+	} else if (index < 256) {
+		return len >= 4;
+	} else if (index < 65536) {
+		return len >= 5;
+	} else if (index < 0x100000000ull) {
+		return len >= 7;
+	}
+
+	return len >= 11;
+}
+
+#define I(kind)		{ 0, (uint8_t)(kind) }
+#define I8(kind)	I(kind), I(kind), I(kind), I(kind), \
+			I(kind), I(kind), I(kind), I(kind)
+#define RESERVED	{ (uint8_t)CBOR_RESERVED_VALUE, CBOR_ITEM_UNKNOWN }
+#define TAIL(k1, k2)	{ 1, (uint8_t)(k1) }, { 2, (uint8_t)(k2) }, \
+			{ 4, (uint8_t)(k2) }, { 8, (uint8_t)(k2) }, \
+			RESERVED, RESERVED, RESERVED, \
+			{ (uint8_t)CBOR_INDEFINITE_VALUE, (uint8_t)(k2) }
+#define ROW(kind)	I8(kind), I8(kind), I8(kind), TAIL(kind, kind)
+
+const cbor_initial_byte_t cbor_initial_bytes[256] = {
+	ROW(CBOR_ITEM_INTEGER),		/* 0: unsigned integer */
+	ROW(CBOR_ITEM_INTEGER),		/* 1: negative integer */
+	ROW(CBOR_ITEM_STRING),		/* 2: byte string */
+	ROW(CBOR_ITEM_STRING),		/* 3: text string */
+	ROW(CBOR_ITEM_ARRAY),		/* 4: array */
+	ROW(CBOR_ITEM_MAP),		/* 5: map */
+	ROW(CBOR_ITEM_TAG),		/* 6: tag */
+	/* 7: simple values up to 24, floats, and BREAK parsed as a float */
+	I8(CBOR_ITEM_SIMPLE_VALUE), I8(CBOR_ITEM_SIMPLE_VALUE),
+	I8(CBOR_ITEM_SIMPLE_VALUE),
+	TAIL(CBOR_ITEM_SIMPLE_VALUE, CBOR_ITEM_FLOAT),
+};
+
 uint8_t cbor_get_following_bytes(uint8_t additional_info)
 {
-	if (additional_info < 24) {
-		return 0;
-	} else if (additional_info == 31) {
-		return (uint8_t)CBOR_INDEFINITE_VALUE;
-	} else if (additional_info >= 28) {
+	if (additional_info > CBOR_ADDITIONAL_INFO_MASK) {
 		return (uint8_t)CBOR_RESERVED_VALUE;
 	}
 
-	return (uint8_t)(1u << (additional_info - 24));
+	return cbor_initial_bytes[additional_info].following_bytes;
 }
 
 cbor_item_data_t cbor_get_item_type(cbor_item_t const *item)
 {
-	return item->type;
+	return (cbor_item_data_t)item->type;
 }
 
 size_t cbor_get_item_size(cbor_item_t const *item)
 {
+	if (cbor_item_is_indefinite(item)) {
+		return (size_t)CBOR_INDEFINITE_VALUE;
+	}
+
 	return item->size;
 }
 
@@ -77,6 +116,14 @@ void cbor_reader_init(cbor_reader_t *reader, cbor_item_t *items, size_t maxitems
 	reader->items = items;
 	reader->maxitems = maxitems;
 	reader->itemidx = 0;
+	reader->frames = NULL;
+	reader->maxframes = 0;
+	reader->depth = 0;
+	reader->siblings = NULL;
+	reader->validate_utf8 = false;
+	reader->stringrefs = NULL;
+	reader->maxstringrefs = 0;
+	reader->resolved = 0;
 }
 
 void cbor_writer_init(cbor_writer_t *writer, void *buf, size_t bufsize)
@@ -87,8 +134,59 @@ void cbor_writer_init(cbor_writer_t *writer, void *buf, size_t bufsize)
 	writer->buf = (uint8_t *)buf;
 	writer->bufsize = bufsize;
 	writer->bufidx = 0;
+#if defined(CBOR_WRITER_SINK)
+	writer->sink = NULL;
+	writer->sink_arg = NULL;
+	writer->flushed = 0;
+#endif
+#if defined(CBOR_WRITER_GROW)
+	writer->grow = NULL;
+	writer->grow_arg = NULL;
+#endif
+#if defined(CBOR_WRITER_DRY_RUN)
+	writer->dry_run = false;
+#endif
+#if defined(CBOR_WRITER_DEFERRED)
+	writer->frames = NULL;
+	writer->maxframes = 0;
+	writer->depth = 0;
+	writer->deferred = 0;
+#endif
+#if defined(CBOR_WRITER_IOVEC)
+	writer->iov = NULL;
+	writer->maxiov = 0;
+	writer->niov = 0;
+	writer->iov_threshold = 0;
+	writer->iov_mark = 0;
+#endif
+#if defined(CBOR_WRITER_SORTED)
+	writer->scratch = NULL;
+	writer->scratch_size = 0;
+	writer->scratch_used = 0;
+	writer->scratch_exhausted = false;
+#endif
+#if defined(CBOR_WRITER_STRINGREF)
+	writer->strings = NULL;
+	writer->maxstrings = 0;
+	writer->nstrings_kept = 0;
+	writer->nstrings = 0;
+	writer->stringref = false;
+	writer->chunked = false;
+	writer->ns_pending = 0;
+	writer->ns_open = 0;
+#endif
 }
 
+#if defined(CBOR_WRITER_DRY_RUN)
+void cbor_writer_init_dry_run(cbor_writer_t *writer)
+{
+	static uint8_t nowhere; /* never written to */
+
+	cbor_writer_init(writer, &nowhere, (size_t)-1);
+	writer->dry_run = true;
+}
+#endif
+
 size_t cbor_writer_len(cbor_writer_t const *writer)
 {
 	return writer->bufidx;
@@ -5,6 +5,7 @@
  */
 
 #include "cbor/decoder.h"
+#include "cbor/ieee754.h"
 #include <string.h>
 
 #if !defined(MIN)
@@ -25,6 +26,33 @@ static cbor_error_t decode_float(cbor_item_t const *item, uint8_t const *msg,
 static cbor_error_t decode_simple(cbor_item_t const *item, uint8_t const *msg,
 		uint8_t *buf, size_t bufsize);
 
+#if defined(CBOR_BIG_ENDIAN)
+#define from_be16(x)				(x)
+#define from_be32(x)				(x)
+#define from_be64(x)				(x)
+#elif defined(__GNUC__)
+#define from_be16(x)				__builtin_bswap16(x)
+#define from_be32(x)				__builtin_bswap32(x)
+#define from_be64(x)				__builtin_bswap64(x)
+#else
+static uint16_t from_be16(uint16_t x)
+{
+	return (uint16_t)((x << 8) | (x >> 8));
+}
+
+static uint32_t from_be32(uint32_t x)
+{
+	return ((uint32_t)from_be16((uint16_t)x) << 16) |
+		from_be16((uint16_t)(x >> 16));
+}
+
+static uint64_t from_be64(uint64_t x)
+{
+	return ((uint64_t)from_be32((uint32_t)x) << 32) |
+		from_be32((uint32_t)(x >> 32));
+}
+#endif
+
 static const item_decoder_t decoders[] = {
 	decode_pass,		/* 0: CBOR_ITEM_UNKNOWN */
 	decode_integer,		/* 1: CBOR_ITEM_INTEGER */
@@ -144,6 +172,468 @@ static cbor_error_t decode_pass(cbor_item_t const *item, uint8_t const *msg,
 	return CBOR_SUCCESS;
 }
 
+/* The argument following the initial byte at p, read with a single load. The
+ * message is not aligned, so the load goes through memcpy(). */
+static uint64_t get_argument(uint8_t const *p)
+{
+	uint16_t u16;
+	uint32_t u32;
+	uint64_t u64;
+
+	switch (cbor_initial_bytes[p[0]].following_bytes) {
+	case 1:
+		return p[1];
+	case 2:
+		memcpy(&u16, &p[1], sizeof(u16));
+		return from_be16(u16);
+	case 4:
+		memcpy(&u32, &p[1], sizeof(u32));
+		return from_be32(u32);
+	case 8:
+		memcpy(&u64, &p[1], sizeof(u64));
+		return from_be64(u64);
+	default:
+		return get_cbor_additional_info(p[0]);
+	}
+}
+
+cbor_error_t cbor_decode_u64(cbor_reader_t const *reader,
+		cbor_item_t const *item, uint64_t *value)
+{
+	uint8_t const *p = &reader->msg[item->offset];
+
+	if (item->type != CBOR_ITEM_INTEGER) {
+		return CBOR_INVALID;
+	}
+
+	if (get_cbor_major_type(p[0]) != 0) { /* negative integer */
+		return CBOR_OVERRUN;
+	}
+
+	*value = get_argument(p);
+
+	return CBOR_SUCCESS;
+}
+
+cbor_error_t cbor_decode_i64(cbor_reader_t const *reader,
+		cbor_item_t const *item, int64_t *value)
+{
+	uint8_t const *p = &reader->msg[item->offset];
+	uint8_t major_type = get_cbor_major_type(p[0]);
+
+	if (item->type != CBOR_ITEM_INTEGER) {
+		return CBOR_INVALID;
+	}
+
+	uint64_t arg = get_argument(p);
+
+	if (arg > (uint64_t)INT64_MAX) {
+		return CBOR_OVERRUN;
+	}
+
+	/* a negative integer is encoded as -1 - n */
+	*value = major_type? -1 - (int64_t)arg : (int64_t)arg;
+
+	return CBOR_SUCCESS;
+}
+
+cbor_error_t cbor_decode_double(cbor_reader_t const *reader,
+		cbor_item_t const *item, double *value)
+{
+	uint8_t const *p = &reader->msg[item->offset];
+	uint64_t u64;
+	uint32_t u32;
+	float f;
+
+	if (item->type != CBOR_ITEM_FLOAT) {
+		return CBOR_INVALID;
+	}
+
+	switch (cbor_initial_bytes[p[0]].following_bytes) {
+	case 2:
+		*value = ieee754_convert_half_to_double(
+				(uint16_t)get_argument(p));
+		return CBOR_SUCCESS;
+	case 4:
+		u32 = (uint32_t)get_argument(p);
+		memcpy(&f, &u32, sizeof(f));
+		*value = (double)f;
+		return CBOR_SUCCESS;
+	case 8:
+		u64 = get_argument(p);
+		memcpy(value, &u64, sizeof(*value));
+		return CBOR_SUCCESS;
+	default:
+		return CBOR_INVALID;
+	}
+}
+
+cbor_error_t cbor_decode_float(cbor_reader_t const *reader,
+		cbor_item_t const *item, float *value)
+{
+	double d;
+	cbor_error_t err = cbor_decode_double(reader, item, &d);
+
+	if (err != CBOR_SUCCESS) {
+		return err;
+	}
+	if (!ieee754_is_shrinkable_to_single(d)) {
+		return CBOR_OVERRUN;
+	}
+
+	*value = (float)d;
+
+	return CBOR_SUCCESS;
+}
+
+cbor_error_t cbor_decode_bool(cbor_reader_t const *reader,
+		cbor_item_t const *item, bool *value)
+{
+	if (item->type != CBOR_ITEM_SIMPLE_VALUE) {
+		return CBOR_INVALID;
+	}
+
+	switch (reader->msg[item->offset]) {
+	case 0xf4: /* false */
+		*value = false;
+		return CBOR_SUCCESS;
+	case 0xf5: /* true */
+		*value = true;
+		return CBOR_SUCCESS;
+	default:
+		return CBOR_INVALID;
+	}
+}
+
+bool cbor_decode_is_null(cbor_reader_t const *reader,
+		cbor_item_t const *item)
+{
+	return item->type == CBOR_ITEM_SIMPLE_VALUE &&
+		reader->msg[item->offset] == 0xf6;
+}
+
+/* Decoding arrays element by element is the fallback. Runs of elements of
+ * the same width and kind go through plain strided loads in chunks of
+ * RUN_CHUNK. */
+#define RUN_CHUNK				32
+
+typedef size_t (*run_decoder_t)(uint8_t const *p, size_t stride, size_t n,
+		void *out);
+typedef cbor_error_t (*element_decoder_t)(cbor_reader_t const *reader,
+		cbor_item_t const *item, void *out);
+
+/* The elements of an array are the items right after it in the table. An
+ * indefinite-length array ends at the BREAK item. */
+static cbor_error_t get_elements(cbor_reader_t const *reader,
+		cbor_item_t const *array, size_t maxn, size_t *n)
+{
+	cbor_item_t const *end = &reader->items[reader->itemidx];
+	cbor_item_t const *item = array + 1;
+
+	if (array->type != CBOR_ITEM_ARRAY) {
+		return CBOR_INVALID;
+	}
+
+	if (cbor_item_is_indefinite(array)) {
+		while (item < end && !cbor_item_is_break(item)) {
+			item++;
+		}
+		*n = (size_t)(item - (array + 1));
+	} else if ((size_t)array->size > (size_t)(end - item)) {
+		/* the item table got full before the array ended */
+		return CBOR_OVERRUN;
+	} else {
+		*n = array->size;
+	}
+
+	return *n > maxn? CBOR_OVERRUN : CBOR_SUCCESS;
+}
+
+/* The number of leading elements of the same width as the first one, whose
+ * initial bytes agree in the bits of @p kind_mask as well. A number is
+ * followed right by the next element, so when the next initial byte tells
+ * a number of the same width, that element is one as well, and so on. */
+static size_t get_uniform_run(cbor_reader_t const *reader,
+		cbor_item_t const *elements, size_t n, uint8_t kind_mask,
+		size_t *stride)
+{
+	if (n == 0 || (elements->type != CBOR_ITEM_INTEGER &&
+				elements->type != CBOR_ITEM_FLOAT)) {
+		return 0;
+	}
+
+	uint8_t const *p = &reader->msg[elements->offset];
+	uint8_t const following_bytes = cbor_initial_bytes[p[0]].following_bytes;
+	uint8_t const kind = p[0] & kind_mask;
+	size_t w = 1u + following_bytes;
+	size_t m = MIN(n, (reader->msgsize - elements->offset) / w);
+	size_t i = 1;
+
+	while (i < m && (p[i * w] & kind_mask) == kind &&
+			cbor_initial_bytes[p[i * w]].following_bytes ==
+			following_bytes) {
+		i++;
+	}
+
+	*stride = w;
+	return i;
+}
+
+static void load_arguments(uint8_t const *p, size_t stride, size_t n,
+		uint64_t *args)
+{
+	uint16_t u16;
+	uint32_t u32;
+	uint64_t u64;
+
+	switch (stride) {
+	case 1:
+		for (size_t i = 0; i < n; i++) {
+			args[i] = get_cbor_additional_info(p[i]);
+		}
+		break;
+	case 2:
+		for (size_t i = 0; i < n; i++) {
+			args[i] = p[i * 2 + 1];
+		}
+		break;
+	case 3:
+		for (size_t i = 0; i < n; i++) {
+			memcpy(&u16, &p[i * 3 + 1], sizeof(u16));
+			args[i] = from_be16(u16);
+		}
+		break;
+	case 5:
+		for (size_t i = 0; i < n; i++) {
+			memcpy(&u32, &p[i * 5 + 1], sizeof(u32));
+			args[i] = from_be32(u32);
+		}
+		break;
+	case 9:
+		for (size_t i = 0; i < n; i++) {
+			memcpy(&u64, &p[i * 9 + 1], sizeof(u64));
+			args[i] = from_be64(u64);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static size_t decode_run_u32(uint8_t const *p, size_t stride, size_t n,
+		void *out)
+{
+	uint32_t *dst = (uint32_t *)out;
+	uint64_t args[RUN_CHUNK];
+
+	if (get_cbor_major_type(p[0]) != 0 || stride > 5) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < n; i += RUN_CHUNK) {
+		size_t chunk = MIN(n - i, RUN_CHUNK);
+		load_arguments(&p[i * stride], stride, chunk, args);
+		for (size_t j = 0; j < chunk; j++) {
+			dst[i + j] = (uint32_t)args[j];
+		}
+	}
+
+	return n;
+}
+
+static size_t decode_run_i64(uint8_t const *p, size_t stride, size_t n,
+		void *out)
+{
+	int64_t *dst = (int64_t *)out;
+	uint64_t args[RUN_CHUNK];
+
+	if (get_cbor_major_type(p[0]) > 1 || stride > 5) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < n; i += RUN_CHUNK) {
+		size_t chunk = MIN(n - i, RUN_CHUNK);
+		load_arguments(&p[i * stride], stride, chunk, args);
+		for (size_t j = 0; j < chunk; j++) {
+			/* a negative integer is encoded as -1 - n, which is
+			 * ~n */
+			const int64_t mask = -(int64_t)
+				get_cbor_major_type(p[(i + j) * stride]);
+			dst[i + j] = (int64_t)args[j] ^ mask;
+		}
+	}
+
+	return n;
+}
+
+static size_t decode_run_f32(uint8_t const *p, size_t stride, size_t n,
+		void *out)
+{
+	float *dst = (float *)out;
+	uint64_t args[RUN_CHUNK];
+
+	if (p[0] != 0xf9 && p[0] != 0xfa) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < n; i += RUN_CHUNK) {
+		size_t chunk = MIN(n - i, RUN_CHUNK);
+		load_arguments(&p[i * stride], stride, chunk, args);
+		for (size_t j = 0; j < chunk; j++) {
+			uint32_t u32 = (uint32_t)args[j];
+			if (stride == 3) {
+				dst[i + j] = (float)ieee754_convert_half_to_double(
+						(uint16_t)u32);
+			} else {
+				memcpy(&dst[i + j], &u32, sizeof(u32));
+			}
+		}
+	}
+
+	return n;
+}
+
+static size_t decode_run_f64(uint8_t const *p, size_t stride, size_t n,
+		void *out)
+{
+	double *dst = (double *)out;
+	uint64_t args[RUN_CHUNK];
+
+	if (p[0] != 0xf9 && p[0] != 0xfa && p[0] != 0xfb) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < n; i += RUN_CHUNK) {
+		size_t chunk = MIN(n - i, RUN_CHUNK);
+		load_arguments(&p[i * stride], stride, chunk, args);
+		for (size_t j = 0; j < chunk; j++) {
+			uint32_t u32 = (uint32_t)args[j];
+			float f;
+			if (stride == 3) {
+				dst[i + j] = ieee754_convert_half_to_double(
+						(uint16_t)u32);
+			} else if (stride == 5) {
+				memcpy(&f, &u32, sizeof(f));
+				dst[i + j] = (double)f;
+			} else {
+				memcpy(&dst[i + j], &args[j], sizeof(args[j]));
+			}
+		}
+	}
+
+	return n;
+}
+
+static cbor_error_t decode_element_u32(cbor_reader_t const *reader,
+		cbor_item_t const *item, void *out)
+{
+	uint64_t v;
+	cbor_error_t err = cbor_decode_u64(reader, item, &v);
+
+	if (err == CBOR_SUCCESS) {
+		if (v > UINT32_MAX) {
+			return CBOR_OVERRUN;
+		}
+		*(uint32_t *)out = (uint32_t)v;
+	}
+
+	return err;
+}
+
+static cbor_error_t decode_element_i64(cbor_reader_t const *reader,
+		cbor_item_t const *item, void *out)
+{
+	return cbor_decode_i64(reader, item, (int64_t *)out);
+}
+
+static cbor_error_t decode_element_f32(cbor_reader_t const *reader,
+		cbor_item_t const *item, void *out)
+{
+	return cbor_decode_float(reader, item, (float *)out);
+}
+
+static cbor_error_t decode_element_f64(cbor_reader_t const *reader,
+		cbor_item_t const *item, void *out)
+{
+	return cbor_decode_double(reader, item, (double *)out);
+}
+
+/* Take a run from each element on. A run the run decoder does not take, and
+ * an element out of any, are decoded one by one before looking for the next
+ * run. */
+static cbor_error_t decode_array(cbor_reader_t const *reader,
+		cbor_item_t const *array, void *out, size_t elemsize,
+		size_t maxn, size_t *ndecoded, uint8_t kind_mask,
+		run_decoder_t decode_run, element_decoder_t decode_element)
+{
+	cbor_item_t const *elements = array + 1;
+	uint8_t *dst = (uint8_t *)out;
+	size_t n = 0;
+	size_t i = 0;
+	size_t stride = 0;
+	cbor_error_t err = get_elements(reader, array, maxn, &n);
+
+	while (err == CBOR_SUCCESS && i < n) {
+		size_t m = get_uniform_run(reader, &elements[i], n - i,
+				kind_mask, &stride);
+		size_t done = 0;
+
+		if (m > 0) {
+			done = (*decode_run)(&reader->msg[elements[i].offset],
+					stride, m, &dst[i * elemsize]);
+			i += done;
+		}
+
+		for (size_t end = i + (m > 0? m : 1); done == 0 &&
+				err == CBOR_SUCCESS && i < end;) {
+			err = (*decode_element)(reader, &elements[i],
+					&dst[i * elemsize]);
+			if (err == CBOR_SUCCESS) {
+				i++;
+			}
+		}
+	}
+
+	if (ndecoded != NULL) {
+		*ndecoded = i;
+	}
+
+	return err;
+}
+
+cbor_error_t cbor_decode_array_u32(cbor_reader_t const *reader,
+		cbor_item_t const *array, uint32_t *out, size_t maxn,
+		size_t *ndecoded)
+{
+	return decode_array(reader, array, out, sizeof(*out), maxn, ndecoded,
+			0xe0, decode_run_u32, decode_element_u32);
+}
+
+cbor_error_t cbor_decode_array_i64(cbor_reader_t const *reader,
+		cbor_item_t const *array, int64_t *out, size_t maxn,
+		size_t *ndecoded)
+{
+	/* unsigned and negative integers run together */
+	return decode_array(reader, array, out, sizeof(*out), maxn, ndecoded,
+			0xc0, decode_run_i64, decode_element_i64);
+}
+
+cbor_error_t cbor_decode_array_f32(cbor_reader_t const *reader,
+		cbor_item_t const *array, float *out, size_t maxn,
+		size_t *ndecoded)
+{
+	return decode_array(reader, array, out, sizeof(*out), maxn, ndecoded,
+			0xe0, decode_run_f32, decode_element_f32);
+}
+
+cbor_error_t cbor_decode_array_f64(cbor_reader_t const *reader,
+		cbor_item_t const *array, double *out, size_t maxn,
+		size_t *ndecoded)
+{
+	return decode_array(reader, array, out, sizeof(*out), maxn, ndecoded,
+			0xe0, decode_run_f64, decode_element_f64);
+}
+
 void const *cbor_decode_pointer(cbor_reader_t const *reader,
 		cbor_item_t const *item)
 {
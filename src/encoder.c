@@ -9,6 +9,47 @@
 #include "cbor/ieee754.h"
 
 #define MAJOR_TYPE_BIT			5
+#define MAX_ELEMENT_SIZE		9 /* initial byte and 8-byte argument */
+
+#if defined(CBOR_BIG_ENDIAN)
+#define to_be16(x)				(x)
+#define to_be32(x)				(x)
+#define to_be64(x)				(x)
+#elif defined(__GNUC__)
+#define to_be16(x)				__builtin_bswap16(x)
+#define to_be32(x)				__builtin_bswap32(x)
+#define to_be64(x)				__builtin_bswap64(x)
+#else
+static uint16_t to_be16(uint16_t x)
+{
+	return (uint16_t)((x << 8) | (x >> 8));
+}
+
+static uint32_t to_be32(uint32_t x)
+{
+	return ((uint32_t)to_be16((uint16_t)x) << 16) |
+		to_be16((uint16_t)(x >> 16));
+}
+
+static uint64_t to_be64(uint64_t x)
+{
+	return ((uint64_t)to_be32((uint32_t)x) << 32) |
+		to_be32((uint32_t)(x >> 32));
+}
+#endif
+
+#if defined(CBOR_WRITER_SORTED)
+/* The spans of a sorted map entry in the writer buffer */
+typedef struct {
+	size_t start;
+	size_t key_end;
+	size_t end;
+} sorted_entry_t;
+#endif
+
+/* Encodes up to n elements of values into buf, or only measures them when
+ * buf is NULL, returning the bytes taken. */
+typedef size_t (*run_encoder_t)(uint8_t *buf, void const *values, size_t n);
 
 static uint8_t get_additional_info(uint64_t value)
 {
@@ -29,6 +70,41 @@ static uint8_t get_additional_info(uint64_t value)
 	return additional_info;
 }
 
+static size_t get_argument_size(uint64_t value)
+{
+	return 1u + cbor_get_following_bytes(get_additional_info(value));
+}
+
+static size_t put_argument(uint8_t *buf, uint8_t major_bits, uint64_t value)
+{
+	uint8_t additional_info = get_additional_info(value);
+	uint16_t u16;
+	uint32_t u32;
+	uint64_t u64;
+
+	buf[0] = major_bits | additional_info;
+
+	switch (additional_info) {
+	case 24:
+		buf[1] = (uint8_t)value;
+		return 2;
+	case 25:
+		u16 = to_be16((uint16_t)value);
+		memcpy(&buf[1], &u16, sizeof(u16));
+		return 3;
+	case 26:
+		u32 = to_be32((uint32_t)value);
+		memcpy(&buf[1], &u32, sizeof(u32));
+		return 5;
+	case 27:
+		u64 = to_be64(value);
+		memcpy(&buf[1], &u64, sizeof(u64));
+		return 9;
+	default:
+		return 1;
+	}
+}
+
 static size_t count_strlen(char const *text, size_t maxlen)
 {
 	size_t len = 0;
@@ -45,10 +121,152 @@ static bool is_overrun(const cbor_writer_t *writer, size_t bytes_needed)
 	return bytes_needed > (writer->bufsize - writer->bufidx);
 }
 
-static cbor_error_t encode_core(cbor_writer_t *writer, uint8_t major_type,
+#if defined(CBOR_WRITER_SINK)
+static cbor_error_t drain(cbor_writer_t *writer, void const *data,
+		size_t datasize)
+{
+	if (!(*writer->sink)(data, datasize, writer->sink_arg)) {
+		return CBOR_ABORTED;
+	}
+
+	writer->flushed += datasize;
+
+	return CBOR_SUCCESS;
+}
+
+static cbor_error_t flush(cbor_writer_t *writer)
+{
+	cbor_error_t err = CBOR_SUCCESS;
+
+	if (writer->bufidx > 0) {
+		err = drain(writer, writer->buf, writer->bufidx);
+		if (err == CBOR_SUCCESS) {
+			writer->bufidx = 0;
+		}
+	}
+
+	return err;
+}
+#endif
+
+static bool is_growable(cbor_writer_t const *writer)
+{
+#if defined(CBOR_WRITER_GROW)
+	return writer->grow != NULL;
+#else
+	(void)writer;
+	return false;
+#endif
+}
+
+#if defined(CBOR_WRITER_GROW)
+/* At least double the buffer, so that growing costs amortized O(1) per
+ * byte. */
+static bool grow_buffer(cbor_writer_t *writer, size_t bytes_needed)
+{
+	size_t newsize = writer->bufidx + bytes_needed;
+
+	if (newsize < writer->bufidx) { /* overflow */
+		return false;
+	}
+	if (writer->bufsize <= ((size_t)-1) / 2 &&
+			newsize < writer->bufsize * 2) {
+		newsize = writer->bufsize * 2;
+	}
+
+	void *buf = (*writer->grow)(writer->buf, writer->bufidx, newsize,
+			writer->grow_arg);
+
+	if (buf == NULL) {
+		return false;
+	}
+
+	writer->buf = (uint8_t *)buf;
+	writer->bufsize = newsize;
+
+	return true;
+}
+#endif
+
+#if defined(CBOR_WRITER_SINK) || defined(CBOR_WRITER_IOVEC)
+/* The bytes encoded must stay where they are while a deferred-length
+ * container is open, whose header and entries are written on close, and in
+ * a stringref namespace, whose strings are looked up in the buffer. */
+static bool is_pinned(cbor_writer_t const *writer)
+{
+	bool pinned = false;
+#if defined(CBOR_WRITER_DEFERRED)
+	pinned = writer->deferred > 0;
+#endif
+#if defined(CBOR_WRITER_STRINGREF)
+	pinned = pinned || writer->stringref;
+#endif
+	(void)writer;
+	return pinned;
+}
+#endif
+
+/* Make room for the bytes needed, growing the buffer if there is an
+ * allocator, or else flushing it if there is a sink. */
+static cbor_error_t reserve(cbor_writer_t *writer, size_t bytes_needed)
+{
+	if (!is_overrun(writer, bytes_needed)) {
+		return CBOR_SUCCESS;
+	}
+#if defined(CBOR_WRITER_GROW)
+	if (writer->grow != NULL && grow_buffer(writer, bytes_needed)) {
+		return CBOR_SUCCESS;
+	}
+#endif
+#if defined(CBOR_WRITER_SINK)
+	if (writer->sink != NULL && !is_pinned(writer)) {
+		cbor_error_t err = flush(writer);
+
+		if (err != CBOR_SUCCESS || !is_overrun(writer, bytes_needed)) {
+			return err;
+		}
+	}
+#endif
+	return CBOR_OVERRUN;
+}
+
+#if defined(CBOR_WRITER_IOVEC)
+/* A payload is referred to only while the buffer stays in place, leaving a
+ * span for the header before it and one for the bytes after it. */
+static bool is_borrowable(cbor_writer_t const *writer, uint64_t datasize)
+{
+#if defined(CBOR_WRITER_SINK)
+	if (writer->sink != NULL) {
+		return false;
+	}
+#endif
+	return writer->iov != NULL && !is_growable(writer) &&
+		!cbor_writer_is_dry_run(writer) &&
+		!is_pinned(writer) && datasize > 0 &&
+		datasize >= writer->iov_threshold &&
+		writer->maxiov - writer->niov >= 3;
+}
+
+static void list_span(cbor_writer_t *writer, void const *base, size_t len)
+{
+	writer->iov[writer->niov].base = base;
+	writer->iov[writer->niov].len = len;
+	writer->niov++;
+}
+
+static void borrow_payload(cbor_writer_t *writer,
+		uint8_t const *data, size_t datasize)
+{
+	list_span(writer, &writer->buf[writer->iov_mark],
+			writer->bufidx - writer->iov_mark);
+	list_span(writer, data, datasize);
+	writer->iov_mark = writer->bufidx;
+}
+#endif
+
+static cbor_error_t write_item(cbor_writer_t *writer, uint8_t major_type,
 		uint8_t const *data, uint64_t datasize, bool indefinite)
 {
-	uint8_t *buf = &writer->buf[writer->bufidx];
 	uint8_t additional_info = get_additional_info(datasize);
 	uint8_t following_bytes = cbor_get_following_bytes(additional_info);
 
@@ -57,19 +275,63 @@ static cbor_error_t encode_core(cbor_writer_t *writer, uint8_t major_type,
 		following_bytes = 0;
 	}
 
-	size_t bytes_to_write = (size_t)datasize + following_bytes + 1;
+	size_t header_size = following_bytes + 1u;
+	size_t bytes_to_write = (size_t)datasize + header_size;
 	/* NOTE: if not string, `datasize` is the actual value to be written.
 	 * And the `following_bytes` is the length of it. */
 	if (!(major_type == 2 || major_type == 3)) {
 		bytes_to_write -= (size_t)datasize;
 	}
 
-	if (is_overrun(writer, bytes_to_write)) {
-		return CBOR_OVERRUN;
+	bool direct = false;
+#if defined(CBOR_WRITER_SINK)
+	/* A string payload not fitting in the buffer goes to the sink as is,
+	 * right after the bytes staged so far and its header. */
+	direct = writer->sink != NULL && !is_growable(writer) &&
+		!is_pinned(writer) && data != NULL &&
+		is_overrun(writer, bytes_to_write);
+#endif
+	bool borrow = false;
+#if defined(CBOR_WRITER_IOVEC)
+	/* A large string payload is listed as a span instead of copied. */
+	borrow = data != NULL && is_borrowable(writer, datasize);
+#endif
+	cbor_error_t err = reserve(writer,
+			(direct || borrow)? header_size : bytes_to_write);
+
+	if (err != CBOR_SUCCESS) {
+		return err;
 	}
 
+	if (cbor_writer_is_dry_run(writer)) {
+		writer->bufidx += bytes_to_write;
+		return CBOR_SUCCESS;
+	}
+
+	uint8_t *buf = &writer->buf[writer->bufidx];
+
 	buf[0] = (uint8_t)(major_type << MAJOR_TYPE_BIT) | additional_info;
 	cbor_copy(&buf[1], (uint8_t const *)&datasize, following_bytes);
+
+#if defined(CBOR_WRITER_SINK)
+	if (direct) {
+		writer->bufidx += header_size;
+		err = flush(writer);
+		if (err != CBOR_SUCCESS) {
+			return err;
+		}
+		return drain(writer, data, (size_t)datasize);
+	}
+#endif
+
+#if defined(CBOR_WRITER_IOVEC)
+	if (borrow) {
+		writer->bufidx += header_size;
+		borrow_payload(writer, data, (size_t)datasize);
+		return CBOR_SUCCESS;
+	}
+#endif
+
 	if (data != NULL) {
 		cbor_copy_be(&buf[1 + following_bytes], data, (size_t)datasize);
 	}
@@ -79,14 +341,410 @@ static cbor_error_t encode_core(cbor_writer_t *writer, uint8_t major_type,
 	return CBOR_SUCCESS;
 }
 
+#if defined(CBOR_WRITER_DEFERRED) || defined(CBOR_WRITER_STRINGREF)
+static bool is_break(uint8_t major_type, bool indefinite)
+{
+	return major_type == 7 && indefinite;
+}
+#endif
+
+#if defined(CBOR_WRITER_DEFERRED)
+static bool is_container_open(uint8_t major_type, uint64_t datasize,
+		bool indefinite)
+{
+	if (major_type == 2 || major_type == 3) {
+		return indefinite;
+	}
+
+	return (major_type == 4 || major_type == 5) &&
+		(indefinite || datasize > 0);
+}
+
+#if defined(CBOR_WRITER_SORTED)
+/* Keep where the key or the value just done ends in a sorted map. */
+static void record_entry(cbor_writer_t *writer,
+		cbor_writer_frame_t const *frame)
+{
+	sorted_entry_t *entries = (sorted_entry_t *)writer->scratch;
+	size_t i = frame->mark + (frame->count - 1) / 2;
+
+	if (cbor_writer_is_dry_run(writer) || writer->scratch_exhausted) {
+		return;
+	}
+
+	if (frame->count % 2 == 0) { /* value */
+		entries[i].end = writer->bufidx;
+		return;
+	}
+
+	if ((writer->scratch_used + 1) * sizeof(*entries) >
+			writer->scratch_size) {
+		writer->scratch_exhausted = true;
+		return;
+	}
+
+	entries[i].start = (i == frame->mark)?
+		frame->offset + 1 : entries[i - 1].end;
+	entries[i].key_end = writer->bufidx;
+	writer->scratch_used++;
+}
+#endif
+
+/* Count an item done at the levels it completes, innermost first. */
+static void complete_item(cbor_writer_t *writer)
+{
+	while (writer->depth > 0) {
+		cbor_writer_frame_t *frame = &writer->frames[writer->depth - 1];
+
+		++frame->count;
+
+#if defined(CBOR_WRITER_SORTED)
+		if (frame->sorted) {
+			record_entry(writer, frame);
+		}
+#endif
+		if (frame->count != frame->expected) {
+			break;
+		}
+
+		writer->depth--;
+	}
+}
+
+static cbor_error_t push_frame(cbor_writer_t *writer, uint8_t major_type,
+		size_t expected, bool deferred)
+{
+	if (writer->depth >= writer->maxframes) {
+		return CBOR_EXCESSIVE;
+	}
+
+	cbor_writer_frame_t *frame = &writer->frames[writer->depth++];
+	frame->offset = writer->bufidx;
+	frame->expected = expected;
+	frame->count = 0;
+	frame->major_type = major_type;
+	frame->deferred = deferred;
+#if defined(CBOR_WRITER_SORTED)
+	frame->mark = writer->scratch_used;
+	frame->sorted = false;
+#endif
+
+	return CBOR_SUCCESS;
+}
+
+static cbor_writer_frame_t *get_open_frame(cbor_writer_t *writer)
+{
+	return writer->depth > 0? &writer->frames[writer->depth - 1] : NULL;
+}
+
+/* Check an item against the levels open before writing it. */
+static cbor_error_t check_item(cbor_writer_t *writer, uint8_t major_type,
+		uint64_t datasize, bool indefinite)
+{
+	cbor_writer_frame_t const *frame = get_open_frame(writer);
+
+	if (is_break(major_type, indefinite) && (frame == NULL ||
+			frame->deferred || frame->expected !=
+			(size_t)CBOR_INDEFINITE_VALUE)) {
+		return CBOR_INVALID;
+	}
+	if (is_container_open(major_type, datasize, indefinite) &&
+			writer->depth >= writer->maxframes) {
+		return CBOR_EXCESSIVE;
+	}
+
+	return CBOR_SUCCESS;
+}
+
+/* Account an item written to the levels open. A tag is done together with
+ * the item it wraps. */
+static void track_item(cbor_writer_t *writer, uint8_t major_type,
+		uint64_t datasize, bool indefinite)
+{
+	size_t expected = (size_t)CBOR_INDEFINITE_VALUE;
+
+	if (major_type == 6) {
+		return;
+	} else if (is_break(major_type, indefinite)) {
+		writer->depth--;
+	} else if (is_container_open(major_type, datasize, indefinite)) {
+		if (!indefinite) {
+			expected = (size_t)datasize;
+			if (major_type == 5) { /* keys and values */
+				expected = (expected > ((size_t)-1) / 2)?
+					(size_t)-2 : expected * 2;
+			}
+		}
+		push_frame(writer, major_type, expected, false);
+		return;
+	}
+
+	complete_item(writer);
+}
+#endif
+
+#if defined(CBOR_WRITER_STRINGREF)
+static bool is_opening_indefinite(uint8_t major_type, bool indefinite)
+{
+	return indefinite && major_type >= 2 && major_type <= 5;
+}
+
+/* Check an item against the indefinite-length items open in a namespace. */
+static cbor_error_t check_shared(cbor_writer_t const *writer,
+		uint8_t major_type, bool indefinite)
+{
+	if (is_opening_indefinite(major_type, indefinite) &&
+			writer->ns_open >= CBOR_RECURSION_MAX_LEVEL) {
+		return CBOR_EXCESSIVE;
+	}
+
+	return CBOR_SUCCESS;
+}
+
+/* Account an item written in a namespace, ending it along with the item
+ * tag 256 wraps. Items left at definite-length levels add up in one count;
+ * an indefinite-length item keeps the count outside of it until its BREAK,
+ * and the items right in it leave the count at zero. */
+static void account_shared(cbor_writer_t *writer, uint8_t major_type,
+		uint64_t datasize, bool indefinite)
+{
+	uint64_t children = 0;
+
+	if (is_break(major_type, indefinite)) {
+		if (writer->ns_pending == 0 && writer->ns_open > 0) {
+			writer->ns_pending = writer->ns_saved[--writer->ns_open];
+		}
+	} else {
+		if (writer->ns_pending > 0) {
+			writer->ns_pending--;
+		}
+
+		if (is_opening_indefinite(major_type, indefinite)) {
+			writer->ns_saved[writer->ns_open++] =
+				writer->ns_pending;
+			writer->ns_pending = 0;
+			return;
+		} else if (major_type == 6) {
+			children = 1;
+		} else if (major_type == 4) {
+			children = datasize;
+		} else if (major_type == 5) { /* keys and values */
+			children = datasize > UINT64_MAX / 2?
+				UINT64_MAX : datasize * 2;
+		}
+
+		writer->ns_pending = children > UINT64_MAX - writer->ns_pending?
+			UINT64_MAX : writer->ns_pending + children;
+	}
+
+	if (writer->ns_pending == 0 && writer->ns_open == 0) {
+		writer->stringref = false;
+	}
+}
+#endif
+
+static bool is_in_namespace(cbor_writer_t const *writer)
+{
+#if defined(CBOR_WRITER_STRINGREF)
+	return writer->stringref;
+#else
+	(void)writer;
+	return false;
+#endif
+}
+
+/* Count an item written other than by encode_item() at the levels open. */
+static void count_item(cbor_writer_t *writer)
+{
+#if defined(CBOR_WRITER_DEFERRED)
+	if (writer->frames != NULL) {
+		complete_item(writer);
+	}
+#endif
+#if defined(CBOR_WRITER_STRINGREF)
+	if (writer->stringref) {
+		account_shared(writer, 0, 0, false);
+	}
+#endif
+	(void)writer;
+}
+
+static cbor_error_t encode_item(cbor_writer_t *writer, uint8_t major_type,
+		uint8_t const *data, uint64_t datasize, bool indefinite)
+{
+	cbor_error_t err = CBOR_SUCCESS;
+
+#if defined(CBOR_WRITER_DEFERRED)
+	if (writer->frames != NULL) {
+		err = check_item(writer, major_type, datasize, indefinite);
+	}
+#endif
+	if (err == CBOR_SUCCESS) {
+		err = write_item(writer, major_type, data, datasize,
+				indefinite);
+	}
+#if defined(CBOR_WRITER_DEFERRED)
+	if (err == CBOR_SUCCESS && writer->frames != NULL) {
+		track_item(writer, major_type, datasize, indefinite);
+	}
+#endif
+
+	return err;
+}
+
+#if defined(CBOR_WRITER_STRINGREF)
+static uint32_t hash_string(uint8_t const *data, size_t len)
+{
+	uint32_t hash = 2166136261u; /* FNV-1a */
+
+	for (size_t i = 0; i < len; i++) {
+		hash = (hash ^ data[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+/* Look a string up in the open-addressed table of the strings kept. */
+static cbor_stringref_t *find_string(cbor_writer_t *writer,
+		uint8_t major_type, uint8_t const *data, size_t len,
+		bool *found)
+{
+	size_t i = hash_string(data, len) % writer->maxstrings;
+
+	for (*found = false; writer->strings[i].len != 0;
+			i = (i + 1) % writer->maxstrings) {
+		cbor_stringref_t *p = &writer->strings[i];
+
+		if (p->len == len && p->major_type == major_type &&
+				memcmp(&writer->buf[p->offset], data, len) == 0) {
+			*found = true;
+			break;
+		}
+	}
+
+	return &writer->strings[i];
+}
+
+/* Write a reference to a string encoded before, or else the string itself,
+ * numbering it when it is long enough. Strings are kept in up to three
+ * quarters of the table to keep the probes short; the ones not kept are
+ * numbered all the same as the decoder numbers every string. */
+static cbor_error_t encode_shared_string(cbor_writer_t *writer,
+		uint8_t major_type, uint8_t const *data, size_t len)
+{
+	bool found = false;
+	cbor_stringref_t *slot = NULL;
+	cbor_error_t err;
+
+	if (writer->maxstrings > 0) {
+		slot = find_string(writer, major_type, data, len, &found);
+	}
+
+	if (found) {
+		/* tag 25 takes 2 bytes */
+		err = reserve(writer, 2 + get_argument_size(slot->index));
+		if (err == CBOR_SUCCESS) {
+			err = encode_item(writer, 6, NULL, 25, false);
+		}
+		if (err == CBOR_SUCCESS) {
+			err = encode_item(writer, 0, NULL, slot->index, false);
+		}
+		return err;
+	}
+
+	bool numbered = cbor_stringref_is_numbered(len, writer->nstrings);
+
+	err = encode_item(writer, major_type, data, len, false);
+
+	if (err != CBOR_SUCCESS || !numbered) {
+		return err;
+	}
+
+	if (slot != NULL &&
+			(writer->nstrings_kept + 1) * 4 <= writer->maxstrings * 3) {
+		slot->offset = writer->bufidx - len;
+		slot->len = len;
+		slot->index = writer->nstrings;
+		slot->major_type = major_type;
+		writer->nstrings_kept++;
+	}
+
+	writer->nstrings++;
+
+	return CBOR_SUCCESS;
+}
+#endif
+
+static cbor_error_t encode_core(cbor_writer_t *writer, uint8_t major_type,
+		uint8_t const *data, uint64_t datasize, bool indefinite)
+{
+#if defined(CBOR_WRITER_STRINGREF)
+	const bool string = major_type == 2 || major_type == 3;
+	const bool shared = writer->stringref;
+	cbor_error_t err = CBOR_SUCCESS;
+
+	if (shared) {
+		err = check_shared(writer, major_type, indefinite);
+	}
+
+	if (err != CBOR_SUCCESS) {
+		return err;
+	} else if (shared && string && !indefinite && !writer->chunked) {
+		/* chunks of an indefinite-length string are neither numbered
+		 * nor referred to */
+		err = encode_shared_string(writer, major_type, data,
+				(size_t)datasize);
+	} else {
+		err = encode_item(writer, major_type, data, datasize,
+				indefinite);
+	}
+
+	if (err == CBOR_SUCCESS && string && indefinite) {
+		writer->chunked = true;
+	} else if (err == CBOR_SUCCESS && is_break(major_type, indefinite)) {
+		writer->chunked = false;
+	}
+
+	if (err == CBOR_SUCCESS && shared) {
+		account_shared(writer, major_type, datasize, indefinite);
+	}
+
+	return err;
+#else
+	return encode_item(writer, major_type, data, datasize, indefinite);
+#endif
+}
+
+/* An argument alone goes straight into the buffer when no bookkeeping is
+ * needed, with the room for the widest one checked once. */
+static bool can_put_in_place(cbor_writer_t const *writer)
+{
+	return !cbor_writer_is_tracking(writer) &&
+		!cbor_writer_is_dry_run(writer) &&
+		!is_in_namespace(writer) &&
+		!is_overrun(writer, MAX_ELEMENT_SIZE);
+}
+
+static cbor_error_t encode_argument(cbor_writer_t *writer, uint8_t major_type,
+		uint64_t value)
+{
+	if (can_put_in_place(writer)) {
+		writer->bufidx += put_argument(&writer->buf[writer->bufidx],
+				(uint8_t)(major_type << MAJOR_TYPE_BIT), value);
+		return CBOR_SUCCESS;
+	}
+
+	return encode_core(writer, major_type, NULL, value, false);
+}
+
 static cbor_error_t encode_simple(cbor_writer_t *writer, uint8_t value)
 {
-	return encode_core(writer, 7, NULL, value, false);
+	return encode_argument(writer, 7, value);
 }
 
 cbor_error_t cbor_encode_unsigned_integer(cbor_writer_t *writer, uint64_t value)
 {
-	return encode_core(writer, 0, NULL, value, false);
+	return encode_argument(writer, 0, value);
 }
 
 cbor_error_t cbor_encode_negative_integer(cbor_writer_t *writer, int64_t value)
@@ -95,7 +753,7 @@ cbor_error_t cbor_encode_negative_integer(cbor_writer_t *writer, int64_t value)
 		return CBOR_INVALID;
 	}
 
-	return encode_core(writer, 1, NULL, (uint64_t)(-1 - value), false);
+	return encode_argument(writer, 1, (uint64_t)(-1 - value));
 }
 
 cbor_error_t cbor_encode_byte_string(cbor_writer_t *writer,
@@ -125,6 +783,15 @@ cbor_error_t cbor_encode_null_terminated_text_string(cbor_writer_t *writer,
 	if (text != NULL) {
 		size_t maxlen = writer->bufsize - writer->bufidx;
 
+#if defined(CBOR_WRITER_SINK)
+		if (writer->sink != NULL) {
+			maxlen = (size_t)-1;
+		}
+#endif
+		if (is_growable(writer)) {
+			maxlen = (size_t)-1;
+		}
+
 		len = count_strlen(text, maxlen);
 		if (len == maxlen) {
 			return CBOR_OVERRUN;
@@ -184,56 +851,574 @@ cbor_error_t cbor_encode_undefined(cbor_writer_t *writer)
 	return encode_simple(writer, 23);
 }
 
-static cbor_error_t encode_float(cbor_writer_t *writer, float value)
+/* Write an initial byte followed by a value in network byte order. */
+static cbor_error_t encode_value(cbor_writer_t *writer, uint8_t initial_byte,
+		void const *value, size_t size)
 {
-	if (ieee754_is_shrinkable_to_half(value)) {
-		uint16_t half = ieee754_convert_single_to_half(value);
+	cbor_error_t err = reserve(writer, 1u + size);
 
-		if (is_overrun(writer, 1u + sizeof(half))) {
-			return CBOR_OVERRUN;
+	if (err != CBOR_SUCCESS) {
+		return err;
+	}
+
+	if (!cbor_writer_is_dry_run(writer)) {
+		writer->buf[writer->bufidx] = initial_byte;
+		cbor_copy(&writer->buf[writer->bufidx + 1],
+				(uint8_t const *)value, size);
+	}
+
+	writer->bufidx += 1u + size;
+	count_item(writer);
+
+	return CBOR_SUCCESS;
+}
+
+static cbor_error_t encode_float(cbor_writer_t *writer, uint64_t bits,
+		unsigned int size)
+{
+	const uint16_t half = (uint16_t)bits;
+	const uint32_t single = (uint32_t)bits;
+
+	switch (size) {
+	case 2:
+		return encode_value(writer, 0xF9, &half, sizeof(half));
+	case 4:
+		return encode_value(writer, 0xFA, &single, sizeof(single));
+	default:
+		return encode_value(writer, 0xFB, &bits, sizeof(bits));
+	}
+}
+
+cbor_error_t cbor_encode_float(cbor_writer_t *writer, float value)
+{
+	uint64_t bits;
+	unsigned int size = ieee754_shrink_single(value, &bits);
+
+	return encode_float(writer, bits, size);
+}
+
+cbor_error_t cbor_encode_double(cbor_writer_t *writer, double value)
+{
+	uint64_t bits;
+	unsigned int size = ieee754_shrink_double(value, &bits);
+
+	return encode_float(writer, bits, size);
+}
+
+cbor_error_t cbor_encode_text_string_indefinite(cbor_writer_t *writer)
+{
+	return encode_core(writer, 3, NULL, 0, true);
+}
+
+#if defined(CBOR_WRITER_SINK)
+void cbor_writer_set_sink(cbor_writer_t *writer, cbor_writer_sink_t sink,
+		void *arg)
+{
+	writer->sink = sink;
+	writer->sink_arg = arg;
+}
+
+cbor_error_t cbor_writer_flush(cbor_writer_t *writer)
+{
+	if (writer->sink == NULL) {
+		return CBOR_INVALID;
+	}
+
+	return flush(writer);
+}
+#endif
+
+#if defined(CBOR_WRITER_GROW)
+void cbor_writer_set_grow(cbor_writer_t *writer, cbor_writer_grow_t grow,
+		void *arg)
+{
+	writer->grow = grow;
+	writer->grow_arg = arg;
+}
+#endif
+
+#if defined(CBOR_WRITER_IOVEC)
+void cbor_writer_set_iovec(cbor_writer_t *writer, cbor_iovec_t *iov,
+		size_t maxiov, size_t threshold)
+{
+	writer->iov = iov;
+	writer->maxiov = iov != NULL? maxiov : 0;
+	writer->niov = 0;
+	writer->iov_threshold = threshold;
+	writer->iov_mark = 0;
+}
+
+size_t cbor_writer_finish_iovec(cbor_writer_t *writer)
+{
+	size_t n = writer->niov;
+
+	if (writer->iov != NULL && writer->bufidx > writer->iov_mark &&
+			n < writer->maxiov) {
+		writer->iov[n].base = &writer->buf[writer->iov_mark];
+		writer->iov[n].len = writer->bufidx - writer->iov_mark;
+		n++;
+	}
+
+	return n;
+}
+#endif
+
+#if defined(CBOR_WRITER_DEFERRED)
+void cbor_writer_set_frames(cbor_writer_t *writer,
+		cbor_writer_frame_t *frames, size_t maxframes)
+{
+	writer->frames = frames;
+	writer->maxframes = frames != NULL? maxframes : 0;
+	writer->depth = 0;
+	writer->deferred = 0;
+}
+
+static cbor_error_t begin_deferred(cbor_writer_t *writer, uint8_t major_type)
+{
+	if (writer->frames == NULL) {
+		return CBOR_INVALID;
+	}
+#if defined(CBOR_WRITER_STRINGREF)
+	if (writer->stringref) {
+		return CBOR_INVALID;
+	}
+#endif
+
+	/* room for the smallest header, grown on close if needed */
+	cbor_error_t err = reserve(writer, 1);
+
+	if (err == CBOR_SUCCESS) {
+		err = push_frame(writer, major_type,
+				(size_t)CBOR_INDEFINITE_VALUE, true);
+	}
+	if (err == CBOR_SUCCESS) {
+		writer->bufidx++;
+		writer->deferred++;
+	}
+
+	return err;
+}
+
+#if defined(CBOR_WRITER_SORTED)
+static int compare_keys(uint8_t const *buf,
+		sorted_entry_t const *a, sorted_entry_t const *b)
+{
+	size_t alen = a->key_end - a->start;
+	size_t blen = b->key_end - b->start;
+	int diff = memcmp(&buf[a->start], &buf[b->start],
+			alen < blen? alen : blen);
+
+	if (diff == 0) { /* the shorter first when one is a prefix */
+		diff = (alen > blen) - (alen < blen);
+	}
+
+	return diff;
+}
+
+static void sift_down(uint8_t const *buf, sorted_entry_t *entries,
+		size_t root, size_t n)
+{
+	sorted_entry_t entry = entries[root];
+
+	for (size_t child; (child = 2 * root + 1) < n; root = child) {
+		if (child + 1 < n && compare_keys(buf,
+				&entries[child], &entries[child + 1]) < 0) {
+			child++;
+		}
+		if (compare_keys(buf, &entry, &entries[child]) >= 0) {
+			break;
 		}
+		entries[root] = entries[child];
+	}
 
-		writer->buf[writer->bufidx++] = 0xF9;
-		writer->bufidx += cbor_copy(&writer->buf[writer->bufidx],
-				(uint8_t const *)&half, sizeof(half));
+	entries[root] = entry;
+}
 
-		return CBOR_SUCCESS;
+/* Heapsort, taking no memory beyond the entries themselves. */
+static void sort_entries(uint8_t const *buf, sorted_entry_t *entries,
+		size_t n)
+{
+	for (size_t i = n / 2; i-- > 0;) {
+		sift_down(buf, entries, i, n);
+	}
+
+	for (size_t i = n; i-- > 1;) {
+		sorted_entry_t tmp = entries[0];
+		entries[0] = entries[i];
+		entries[i] = tmp;
+		sift_down(buf, entries, 0, i);
+	}
+}
+
+/* Put the entries of a sorted map in the bytewise order of their keys,
+ * copying them through the scratch left after the entries. */
+static cbor_error_t sort_map(cbor_writer_t *writer,
+		cbor_writer_frame_t const *frame)
+{
+	sorted_entry_t *entries = (sorted_entry_t *)writer->scratch;
+	size_t n = writer->scratch_used - frame->mark;
+	size_t body = frame->offset + 1;
+	size_t bodysize = writer->bufidx - body;
+	size_t used = writer->scratch_used * sizeof(*entries);
+	uint8_t *tmp = &((uint8_t *)writer->scratch)[used];
+
+	if (writer->scratch_exhausted || bodysize > writer->scratch_size - used) {
+		return CBOR_EXCESSIVE;
 	}
 
-	if (is_overrun(writer, 1u + sizeof(value))) {
-		return CBOR_OVERRUN;
+	entries = &entries[frame->mark];
+	sort_entries(writer->buf, entries, n);
+
+	for (size_t i = 0, len = 0; i < n; i++) {
+		if (i > 0 && compare_keys(writer->buf,
+					&entries[i - 1], &entries[i]) == 0) {
+			return CBOR_INVALID; /* duplicate key */
+		}
+
+		memcpy(&tmp[len], &writer->buf[entries[i].start],
+				entries[i].end - entries[i].start);
+		len += entries[i].end - entries[i].start;
 	}
 
-	writer->buf[writer->bufidx++] = 0xFA;
-	writer->bufidx += cbor_copy(&writer->buf[writer->bufidx],
-			(uint8_t const *)&value, sizeof(value));
+	memcpy(&writer->buf[body], tmp, bodysize);
 
 	return CBOR_SUCCESS;
 }
+#endif
 
-cbor_error_t cbor_encode_float(cbor_writer_t *writer, float value)
+/* Write the smallest header for the items counted, moving the body up if
+ * the header takes more than the one byte reserved. */
+static cbor_error_t end_deferred(cbor_writer_t *writer, uint8_t major_type)
 {
-	return encode_float(writer, value);
+	cbor_writer_frame_t *frame = get_open_frame(writer);
+
+	if (frame == NULL || !frame->deferred ||
+			frame->major_type != major_type ||
+			(major_type == 5 && (frame->count % 2) != 0)) {
+		return CBOR_INVALID;
+	}
+
+	uint64_t n = major_type == 5? frame->count / 2 : frame->count;
+	uint8_t additional_info = get_additional_info(n);
+	uint8_t following_bytes = cbor_get_following_bytes(additional_info);
+	size_t offset = frame->offset;
+	cbor_error_t err = CBOR_SUCCESS;
+
+#if defined(CBOR_WRITER_SORTED)
+	if (frame->sorted && !cbor_writer_is_dry_run(writer)) {
+		err = sort_map(writer, frame);
+	}
+#endif
+	if (err == CBOR_SUCCESS) {
+		err = reserve(writer, following_bytes);
+	}
+	if (err != CBOR_SUCCESS) {
+		return err;
+	}
+#if defined(CBOR_WRITER_SORTED)
+	if (frame->sorted) {
+		writer->scratch_used = frame->mark;
+	}
+#endif
+
+	if (!cbor_writer_is_dry_run(writer)) {
+		uint8_t *buf = &writer->buf[offset];
+
+		if (following_bytes > 0) {
+			memmove(&buf[1 + following_bytes], &buf[1],
+					writer->bufidx - offset - 1);
+		}
+
+		buf[0] = (uint8_t)(major_type << MAJOR_TYPE_BIT)
+			| additional_info;
+		cbor_copy(&buf[1], (uint8_t const *)&n, following_bytes);
+	}
+
+	writer->bufidx += following_bytes;
+	writer->depth--;
+	writer->deferred--;
+
+	complete_item(writer);
+
+	return CBOR_SUCCESS;
 }
 
-cbor_error_t cbor_encode_double(cbor_writer_t *writer, double value)
+cbor_error_t cbor_encode_array_begin(cbor_writer_t *writer)
 {
-	if (ieee754_is_shrinkable_to_single(value)) {
-		return encode_float(writer, (float)value);
+	return begin_deferred(writer, 4);
+}
+
+cbor_error_t cbor_encode_array_end(cbor_writer_t *writer)
+{
+	return end_deferred(writer, 4);
+}
+
+cbor_error_t cbor_encode_map_begin(cbor_writer_t *writer)
+{
+	return begin_deferred(writer, 5);
+}
+
+cbor_error_t cbor_encode_map_end(cbor_writer_t *writer)
+{
+	return end_deferred(writer, 5);
+}
+#endif
+
+#if defined(CBOR_WRITER_SORTED)
+void cbor_writer_set_scratch(cbor_writer_t *writer, void *scratch,
+		size_t scratch_size)
+{
+	writer->scratch = scratch;
+	writer->scratch_size = scratch != NULL? scratch_size : 0;
+	writer->scratch_used = 0;
+	writer->scratch_exhausted = false;
+}
+
+cbor_error_t cbor_encode_sorted_map_begin(cbor_writer_t *writer)
+{
+	if (writer->scratch == NULL) {
+		return CBOR_INVALID;
 	}
 
-	if (is_overrun(writer, 1u + sizeof(value))) {
-		return CBOR_OVERRUN;
+	cbor_error_t err = begin_deferred(writer, 5);
+
+	if (err == CBOR_SUCCESS) {
+		writer->frames[writer->depth - 1].sorted = true;
 	}
 
-	writer->buf[writer->bufidx++] = 0xFB;
-	writer->bufidx += cbor_copy(&writer->buf[writer->bufidx],
-			(uint8_t const *)&value, sizeof(value));
+	return err;
+}
+#endif
+
+#if defined(CBOR_WRITER_STRINGREF)
+void cbor_writer_set_stringrefs(cbor_writer_t *writer,
+		cbor_stringref_t *strings, size_t maxstrings)
+{
+	writer->strings = strings;
+	writer->maxstrings = strings != NULL? maxstrings : 0;
+	writer->nstrings_kept = 0;
+	writer->nstrings = 0;
+	writer->stringref = false;
+}
+
+cbor_error_t cbor_encode_stringref_namespace(cbor_writer_t *writer)
+{
+	if (writer->strings == NULL || cbor_writer_is_dry_run(writer) ||
+			writer->stringref) {
+		return CBOR_INVALID;
+	}
+#if defined(CBOR_WRITER_DEFERRED)
+	if (writer->deferred > 0) {
+		return CBOR_INVALID;
+	}
+#endif
+
+	cbor_error_t err = encode_core(writer, 6, NULL, 256, false);
+
+	if (err == CBOR_SUCCESS) {
+		for (size_t i = 0; i < writer->maxstrings; i++) {
+			writer->strings[i].len = 0;
+		}
+
+		writer->nstrings_kept = 0;
+		writer->nstrings = 0;
+		writer->stringref = true;
+		writer->ns_pending = 1; /* the item it wraps */
+		writer->ns_open = 0;
+	}
+
+	return err;
+}
+#endif
+
+static size_t put_float(uint8_t *buf, uint64_t bits, unsigned int size)
+{
+	const uint16_t half = to_be16((uint16_t)bits);
+	const uint32_t single = to_be32((uint32_t)bits);
+	const uint64_t u64 = to_be64(bits);
+
+	switch (size) {
+	case 2:
+		buf[0] = 0xF9;
+		memcpy(&buf[1], &half, sizeof(half));
+		break;
+	case 4:
+		buf[0] = 0xFA;
+		memcpy(&buf[1], &single, sizeof(single));
+		break;
+	default:
+		buf[0] = 0xFB;
+		memcpy(&buf[1], &u64, sizeof(u64));
+		break;
+	}
+
+	return 1u + size;
+}
+
+static size_t encode_run_u64(uint8_t *buf, void const *values, size_t n)
+{
+	uint64_t const *v = (uint64_t const *)values;
+	size_t len = 0;
+
+	if (buf == NULL) {
+		for (size_t i = 0; i < n; i++) {
+			len += get_argument_size(v[i]);
+		}
+		return len;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		len += put_argument(&buf[len], 0x00, v[i]);
+	}
+
+	return len;
+}
+
+static size_t encode_run_i64(uint8_t *buf, void const *values, size_t n)
+{
+	int64_t const *v = (int64_t const *)values;
+	size_t len = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		/* -1 - v flips the bits, so the argument is v or ~v */
+		uint64_t mask = v[i] < 0? ~(uint64_t)0 : 0;
+		uint64_t arg = (uint64_t)v[i] ^ mask;
+
+		if (buf == NULL) {
+			len += get_argument_size(arg);
+		} else {
+			len += put_argument(&buf[len],
+					(uint8_t)(mask & 0x20), arg);
+		}
+	}
+
+	return len;
+}
+
+static size_t encode_run_f32(uint8_t *buf, void const *values, size_t n)
+{
+	float const *v = (float const *)values;
+	size_t len = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		uint64_t bits;
+		unsigned int size = ieee754_shrink_single(v[i], &bits);
+
+		if (buf == NULL) {
+			len += 1u + size;
+		} else {
+			len += put_float(&buf[len], bits, size);
+		}
+	}
+
+	return len;
+}
+
+static size_t encode_run_f64(uint8_t *buf, void const *values, size_t n)
+{
+	double const *v = (double const *)values;
+	size_t len = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		uint64_t bits;
+		unsigned int size = ieee754_shrink_double(v[i], &bits);
+
+		if (buf == NULL) {
+			len += 1u + size;
+		} else {
+			len += put_float(&buf[len], bits, size);
+		}
+	}
+
+	return len;
+}
+
+/* Encode as many elements at a time as surely fit in the room left, and
+ * make room one element at a time once it runs short. */
+static cbor_error_t encode_array_of(cbor_writer_t *writer, void const *values,
+		size_t n, size_t elemsize, run_encoder_t encode_run)
+{
+	uint8_t const *p = (uint8_t const *)values;
+	size_t const start = writer->bufidx;
+#if defined(CBOR_WRITER_SINK)
+	size_t const flushed = writer->flushed;
+#endif
+	cbor_error_t err = CBOR_SUCCESS;
+
+#if defined(CBOR_WRITER_DEFERRED)
+	/* the array nests as any other, though done as one item */
+	if (writer->frames != NULL) {
+		err = check_item(writer, 4, n, false);
+	}
+#endif
+	if (err == CBOR_SUCCESS) {
+		err = write_item(writer, 4, NULL, n, false);
+	}
+
+	if (err == CBOR_SUCCESS && cbor_writer_is_dry_run(writer)) {
+		writer->bufidx += (*encode_run)(NULL, values, n);
+	}
+
+	for (size_t i = 0; err == CBOR_SUCCESS &&
+			!cbor_writer_is_dry_run(writer) && i < n;) {
+		size_t room = writer->bufsize - writer->bufidx;
+		size_t chunk = room / MAX_ELEMENT_SIZE;
+
+		if (chunk == 0) {
+			err = reserve(writer,
+					(*encode_run)(NULL, &p[i * elemsize], 1));
+			chunk = 1;
+		} else if (chunk > n - i) {
+			chunk = n - i;
+		}
+
+		if (err == CBOR_SUCCESS) {
+			writer->bufidx += (*encode_run)(
+					&writer->buf[writer->bufidx],
+					&p[i * elemsize], chunk);
+			i += chunk;
+		}
+	}
+
+	if (err != CBOR_SUCCESS) {
+#if defined(CBOR_WRITER_SINK)
+		if (writer->flushed != flushed) {
+			return err;
+		}
+#endif
+		writer->bufidx = start;
+		return err;
+	}
+
+	count_item(writer);
 
 	return CBOR_SUCCESS;
 }
 
-cbor_error_t cbor_encode_text_string_indefinite(cbor_writer_t *writer)
+cbor_error_t cbor_encode_array_u64(cbor_writer_t *writer,
+		uint64_t const *values, size_t n)
 {
-	return encode_core(writer, 3, NULL, 0, true);
+	return encode_array_of(writer, values, n, sizeof(*values),
+			encode_run_u64);
+}
+
+cbor_error_t cbor_encode_array_i64(cbor_writer_t *writer,
+		int64_t const *values, size_t n)
+{
+	return encode_array_of(writer, values, n, sizeof(*values),
+			encode_run_i64);
+}
+
+cbor_error_t cbor_encode_array_f32(cbor_writer_t *writer,
+		float const *values, size_t n)
+{
+	return encode_array_of(writer, values, n, sizeof(*values),
+			encode_run_f32);
+}
+
+cbor_error_t cbor_encode_array_f64(cbor_writer_t *writer,
+		double const *values, size_t n)
+{
+	return encode_array_of(writer, values, n, sizeof(*values),
+			encode_run_f64);
 }
@@ -54,6 +54,22 @@ static bool path_matches(const struct path_stack *stack,
 	return true;
 }
 
+/* True if @p p goes deeper than the current path and could still match below
+ * it. */
+static bool path_continues(const struct path_stack *stack,
+		const struct cbor_parser *p)
+{
+	if (p->depth <= stack->depth) {
+		return false;
+	}
+	for (size_t i = 0; i < stack->depth; i++) {
+		if (!segment_equal(&p->path[i], &stack->segments[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
 static bool path_has_wildcard(const struct cbor_parser *p)
 {
 	for (size_t i = 0; i < p->depth; i++) {
@@ -71,6 +87,17 @@ struct parser_ctx {
 	struct path_stack *stack;
 };
 
+static bool has_parser_below(const struct parser_ctx *ctx)
+{
+	for (size_t i = 0; i < ctx->nr_parsers; i++) {
+		const struct cbor_parser *p = &ctx->parsers[i];
+		if (p->run && path_continues(ctx->stack, p)) {
+			return true;
+		}
+	}
+	return false;
+}
+
 static void dispatch_item(const cbor_reader_t *reader,
 		const cbor_item_t *item, struct parser_ctx *ctx)
 {
@@ -119,8 +146,12 @@ typedef enum {
 
 static bool is_indefinite_string(const cbor_item_t *item)
 {
-	return item->type == CBOR_ITEM_STRING &&
-		item->size == (size_t)CBOR_INDEFINITE_VALUE;
+	return item->type == CBOR_ITEM_STRING && cbor_item_is_indefinite(item);
+}
+
+static bool is_pair_count_valid(size_t nr_pairs)
+{
+	return nr_pairs <= SIZE_MAX / 2;
 }
 
 static bool is_container(const cbor_item_t *item)
@@ -130,7 +161,7 @@ static bool is_container(const cbor_item_t *item)
 
 static bool is_indefinite_container(const cbor_item_t *item)
 {
-	return item->size == (size_t)CBOR_INDEFINITE_VALUE;
+	return cbor_item_is_indefinite(item);
 }
 
 static iter_action_t get_iter_action(const cbor_item_t *item,
@@ -155,10 +186,10 @@ static iter_action_t get_iter_action(const cbor_item_t *item,
 	}
 
 	if (item->type == CBOR_ITEM_MAP) {
-		if (item->size > SIZE_MAX / 2) {
+		if (!is_pair_count_valid(item->size)) {
 			return ITER_STOP;
 		}
-		*len = item->size * 2;
+		*len = (size_t)item->size * 2;
 		return ITER_RECURSE;
 	}
 
@@ -208,8 +239,7 @@ static size_t iterate_each(const cbor_reader_t *reader,
 		}
 
 		if (cbor_item_is_break(item)) {
-			if (parent && parent->size == (size_t)
-					CBOR_INDEFINITE_VALUE) {
+			if (parent && cbor_item_is_indefinite(parent)) {
 				i++;
 			}
 			break;
@@ -299,6 +329,47 @@ static size_t skip_subtree(const cbor_item_t *items, size_t nr_items,
 	return i + extra;
 }
 
+/* Look up the index of the item following the subtree of @p item, when the
+ * parser recorded one. */
+static bool get_next_sibling_index(const cbor_reader_t *reader,
+		const cbor_item_t *item, size_t *next)
+{
+	if (reader->siblings == NULL) {
+		return false;
+	}
+
+	size_t idx = (size_t)(item - reader->items);
+
+	if (idx >= reader->itemidx) {
+		return false;
+	}
+
+	size_t n = reader->siblings[idx];
+
+	if (n <= idx || n > reader->itemidx) {
+		return false;
+	}
+
+	*next = n;
+	return true;
+}
+
+/* Skip the items nested in @p item, returning how many there are. */
+static size_t skip_children(const cbor_reader_t *reader,
+		const cbor_item_t *item, size_t len, size_t remaining_nodes)
+{
+	size_t next;
+
+	if (get_next_sibling_index(reader, item, &next)) {
+		size_t nested = next - (size_t)(item - reader->items) - 1;
+		if (nested <= remaining_nodes) {
+			return nested;
+		}
+	}
+
+	return skip_subtree(item + 1, len, remaining_nodes);
+}
+
 static size_t dispatch_each(const cbor_reader_t *reader,
 		const cbor_item_t *items, size_t nr_items, size_t max_nodes,
 		const cbor_item_t *parent, struct parser_ctx *ctx);
@@ -321,13 +392,14 @@ static bool try_make_segment(const cbor_reader_t *reader,
 	return false;
 }
 
-static size_t skip_if_needed(iter_action_t action, const cbor_item_t *item,
+static size_t skip_if_needed(const cbor_reader_t *reader,
+		iter_action_t action, const cbor_item_t *item,
 		size_t len, size_t remaining_nodes)
 {
 	if (action == ITER_LEAF) {
 		return 0;
 	}
-	return skip_subtree(item + 1, len, remaining_nodes);
+	return skip_children(reader, item, len, remaining_nodes);
 }
 
 static size_t dispatch_by_action(const cbor_reader_t *reader,
@@ -336,11 +408,16 @@ static size_t dispatch_by_action(const cbor_reader_t *reader,
 {
 	if (action == ITER_RECURSE_CALLBACK_FIRST) {
 		dispatch_item(reader, item, ctx);
-		return skip_subtree(item + 1, len, remaining_nodes);
+		return skip_children(reader, item, len, remaining_nodes);
 	}
 
 	if (action == ITER_RECURSE) {
 		dispatch_item(reader, item, ctx);
+		/* nothing below can match; step over the whole subtree */
+		if (!has_parser_below(ctx)) {
+			return skip_children(reader, item, len,
+					remaining_nodes);
+		}
 		return dispatch_each(reader, item + 1, len,
 				remaining_nodes, item, ctx);
 	}
@@ -367,11 +444,13 @@ static size_t dispatch_value(const cbor_reader_t *reader,
 				array_idx, &seg);
 
 		if (parent->type == CBOR_ITEM_MAP && !seg_valid) {
-			return skip_if_needed(action, item, len, remaining_nodes);
+			return skip_if_needed(reader, action, item, len,
+					remaining_nodes);
 		}
 
 		if (seg_valid && !push_seg(ctx->stack, &seg)) {
-			return skip_if_needed(action, item, len, remaining_nodes);
+			return skip_if_needed(reader, action, item, len,
+					remaining_nodes);
 		}
 
 		seg_pushed = seg_valid;
@@ -396,7 +475,7 @@ static bool is_indefinite_break(const cbor_item_t *item,
 		const cbor_item_t *parent)
 {
 	return cbor_item_is_break(item) && parent &&
-		parent->size == (size_t)CBOR_INDEFINITE_VALUE;
+		cbor_item_is_indefinite(parent);
 }
 
 static size_t handle_map_dispatch(const cbor_reader_t *reader,
@@ -410,8 +489,9 @@ static size_t handle_map_dispatch(const cbor_reader_t *reader,
 	if (is_key) {
 		*last_key_item = &items[i + extra];
 		if (should_skip_map_key(action)) {
-			size_t skipped = skip_subtree(&items[i + extra + 1],
-					len, remaining_nodes);
+			size_t skipped = skip_children(reader,
+					&items[i + extra], len,
+					remaining_nodes);
 			*last_key_item = NULL;
 			return skipped;
 		}
@@ -589,13 +669,13 @@ bool cbor_dispatch(const cbor_reader_t *reader,
 	size_t remaining = reader->itemidx - item_idx - 1;
 	size_t nr_children;
 
-	if (container->size == (size_t)CBOR_INDEFINITE_VALUE) {
+	if (cbor_item_is_indefinite(container)) {
 		nr_children = remaining;
 	} else if (container->type == CBOR_ITEM_MAP) {
-		if (container->size > SIZE_MAX / 2) {
+		if (!is_pair_count_valid(container->size)) {
 			return false;
 		}
-		nr_children = container->size * 2;
+		nr_children = (size_t)container->size * 2;
 	} else {
 		nr_children = container->size;
 	}
@@ -619,3 +699,36 @@ size_t cbor_iterate(const cbor_reader_t *reader, const cbor_item_t *parent,
 	return iterate_each(reader, reader->items, reader->itemidx,
 			reader->itemidx, parent, iterate_trampoline, &wrap);
 }
+
+const cbor_item_t *cbor_next_sibling(const cbor_reader_t *reader,
+		const cbor_item_t *item)
+{
+	size_t idx = (size_t)(item - reader->items);
+	size_t next = idx + 1;
+
+	if (idx >= reader->itemidx) {
+		return NULL;
+	}
+
+	if (!get_next_sibling_index(reader, item, &next)) {
+		size_t remaining = reader->itemidx - next;
+		size_t len = 1;
+
+		switch (get_iter_action(item, remaining, &len)) {
+		case ITER_TAG: /* the tagged item is the only child */
+			len = 1;
+			/* fall through */
+		case ITER_RECURSE:
+		case ITER_RECURSE_CALLBACK_FIRST:
+			next += skip_subtree(item + 1, len, remaining);
+			break;
+		case ITER_STOP:
+			return NULL;
+		case ITER_LEAF:
+		default:
+			break;
+		}
+	}
+
+	return next < reader->itemidx? &reader->items[next] : NULL;
+}
@@ -31,177 +31,264 @@
  */
 
 #include "cbor/ieee754.h"
+#include <string.h>
 
 #define BIAS_HALF				15
 #define BIAS_SINGLE				127
 #define BIAS_DOUBLE				1023
 
-#define E_MASK_HALF				((1u << 5) - 1)
-#define E_MASK_SINGLE				((1ul << 8) - 1)
-#define E_MASK_DOUBLE				((1ul << 11) - 1)
+#define E_BIT_HALF				5
+#define E_BIT_SINGLE				8
+#define E_BIT_DOUBLE				11
+
+#define E_MASK_HALF				((1u << E_BIT_HALF) - 1)
 
 #define M_BIT_HALF				10
 #define M_BIT_SINGLE				23
 #define M_BIT_DOUBLE				52
 
 #define M_MASK_HALF				((1u << M_BIT_HALF) - 1)
-#define M_MASK_SINGLE				((1ul << M_BIT_SINGLE) - 1)
-#define M_MASK_DOUBLE				((1ull << M_BIT_DOUBLE) - 1)
 
-static int find_last_set_bit(unsigned int value)
-{
-	int cnt = 0;
+typedef struct {
+	unsigned int m_bits;
+	unsigned int e_bits;
+	int bias;
+} format_t;
 
-	while (value != 0) {
-		value >>= 1;
-		cnt++;
-	}
+static const format_t half_format = {
+	M_BIT_HALF, E_BIT_HALF, BIAS_HALF,
+};
+static const format_t single_format = {
+	M_BIT_SINGLE, E_BIT_SINGLE, BIAS_SINGLE,
+};
+static const format_t double_format = {
+	M_BIT_DOUBLE, E_BIT_DOUBLE, BIAS_DOUBLE,
+};
 
-	return cnt;
+#if defined(CBOR_FLOAT16)
+__extension__ typedef _Float16 half_t;
+#endif
+
+static uint32_t get_single_bits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
 }
 
-static bool is_over_range(unsigned int e, unsigned int f, unsigned int t)
+static uint64_t get_double_bits(double value)
 {
-	return e > (f + t);
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
 }
 
-static bool is_under_range(unsigned int e, unsigned int f, unsigned int t)
+/* Narrow the bits of a value in the format f to the format t in one pass,
+ * dropping the lower mantissa bits t has no room for. A value under the
+ * normal range of t gets subnormal, dropping one more bit per exponent, and
+ * one over the range gets infinity. Return true if no set bit is dropped,
+ * or t represents the value exactly. */
+static bool narrow(uint64_t bits, format_t const *f, format_t const *t,
+		uint64_t *out)
 {
-	return e < (f - t + 1);
+	const unsigned int e_max = (1u << f->e_bits) - 1;
+	const unsigned int e = (unsigned int)(bits >> f->m_bits) & e_max;
+	const uint64_t m = bits & ((1ull << f->m_bits) - 1);
+	const uint64_t sign = (bits >> (f->m_bits + f->e_bits))
+		<< (t->m_bits + t->e_bits);
+	const uint64_t infinity = (uint64_t)((1u << t->e_bits) - 1)
+		<< t->m_bits;
+	const int exp = (int)e - f->bias;
+	const int exp_min = 1 - t->bias;
+	/* the implicit bit of normal values counts one up in the exponent
+	 * when added to the exponent field below */
+	const uint64_t sig = m | ((uint64_t)(e != 0 && e != e_max)
+			<< f->m_bits);
+	unsigned int drop = f->m_bits - t->m_bits;
+	uint64_t e_field = 0;
+
+	if (e == e_max) { /* NaN or infinity keeps the upper payload */
+		*out = sign | infinity | (m >> drop);
+		if (m != 0 && (m >> drop) == 0) { /* keep NaN not infinity */
+			*out |= 1ull << (t->m_bits - 1);
+		}
+		return (m & ((1ull << drop) - 1)) == 0;
+	} else if (exp > t->bias) {
+		*out = sign | infinity;
+		return false;
+	} else if (exp < exp_min) { /* zero or subnormal */
+		const unsigned int under = (unsigned int)(exp_min - exp);
+		drop = (under > t->m_bits)? f->m_bits + 1 : drop + under;
+	} else {
+		e_field = (uint64_t)(exp - exp_min) << t->m_bits;
+	}
+
+	*out = sign | (e_field + (sig >> drop));
+
+	return (sig & ((1ull << drop) - 1)) == 0;
 }
 
-static bool is_in_range(unsigned int e, unsigned int f, unsigned int t)
+/* A set bit among the lower ones the target has no room for tells at once
+ * that a value does not shrink, as it goes for most values. */
+static bool has_dropped_bits(uint64_t bits, unsigned int f_m_bits,
+		unsigned int t_m_bits)
 {
-	return !is_over_range(e, f, t) && !is_under_range(e, f, t);
+	return (bits & ((1ull << (f_m_bits - t_m_bits)) - 1)) != 0;
 }
 
-static bool is_in_subrange(unsigned int e, unsigned int target_m_bits,
-		unsigned int f, unsigned int t)
+static bool is_normal_in(unsigned int e, int f_bias, int t_bias)
 {
-	return is_under_range(e, f, t) && ((f - e - t) < target_m_bits);
+	return (unsigned int)((int)e - (f_bias - t_bias + 1))
+		< (unsigned int)(2 * t_bias);
 }
 
-static bool is_precision_lost(uint64_t m, unsigned int f, unsigned int t)
+/* Within the normal range of the target, which most values shrinking fall
+ * in, narrowing takes no more than rebiasing the exponent. */
+static uint64_t rebias(uint64_t bits, unsigned int e,
+		format_t const *f, format_t const *t)
 {
-	return (m & ((1ull << (f - t)) - 1)) != 0;
+	const uint64_t sign = bits >> (f->m_bits + f->e_bits);
+	const uint64_t m = (bits >> (f->m_bits - t->m_bits))
+		& ((1ull << t->m_bits) - 1);
+
+	return (sign << (t->m_bits + t->e_bits))
+		| ((uint64_t)(e - (unsigned int)(f->bias - t->bias))
+				<< t->m_bits)
+		| m;
 }
 
-uint16_t ieee754_convert_single_to_half(float value)
+static unsigned int shrink_single(uint32_t bits, uint64_t *out)
 {
-	ieee754_single_t single = { .value = value };
-	ieee754_half_t half = { .value = 0 };
-	uint8_t exp = M_BIT_SINGLE - M_BIT_HALF;
-
-	half.components.sign = single.components.sign;
-	if (single.components.e == E_MASK_SINGLE) { /* NaN or infinity */
-		half.components.e = E_MASK_HALF;
-	} else if (is_over_range(single.components.e, BIAS_SINGLE, BIAS_HALF)) {
-		/* make it NaN */
-		half.components.e = E_MASK_HALF;
-		single.components.m = 0;
-	} else if (is_under_range(single.components.e, BIAS_SINGLE, BIAS_HALF)) {
-		/* expand the exponent to the mantissa to make it subnormal */
-		exp = (uint8_t)(exp + ((BIAS_SINGLE - single.components.e) - BIAS_HALF));
-		single.components.m = M_MASK_SINGLE;
-	} else { /* zero, normal */
-		if (single.components.e != 0) {
-			half.components.e = (uint8_t)(single.components.e
-				- BIAS_SINGLE + BIAS_HALF) & E_MASK_HALF;
+	const unsigned int e = (bits >> M_BIT_SINGLE)
+		& ((1u << E_BIT_SINGLE) - 1);
+
+	if (has_dropped_bits(bits, M_BIT_SINGLE, M_BIT_HALF)) {
+		*out = bits;
+		return 4;
+	}
+#if defined(CBOR_FLOAT16)
+	/* The conversion instructions make signaling NaNs quiet, so NaNs and
+	 * infinities take the way below. */
+	if (e != (1u << E_BIT_SINGLE) - 1) {
+		float value;
+		half_t half;
+		uint16_t half_bits;
+
+		memcpy(&value, &bits, sizeof(value));
+		half = (half_t)value;
+		memcpy(&half_bits, &half, sizeof(half_bits));
+
+		*out = half_bits;
+		if (get_single_bits((float)half) == bits) {
+			return 2;
 		}
+
+		*out = bits;
+		return 4;
+	}
+#endif
+	if (is_normal_in(e, BIAS_SINGLE, BIAS_HALF)) {
+		*out = rebias(bits, e, &single_format, &half_format);
+		return 2;
+	} else if (narrow(bits, &single_format, &half_format, out)) {
+		return 2;
 	}
 
+	*out = bits;
+	return 4;
+}
+
+uint16_t ieee754_convert_single_to_half(float value)
+{
+	uint64_t half;
+
 	/* precision may be lost discarding outrange lower bits */
-	half.components.m = ((uint32_t)single.components.m >> exp) & M_MASK_HALF;
+	narrow(get_single_bits(value), &single_format, &half_format, &half);
 
-	return half.value;
+	return (uint16_t)half;
 }
 
 double ieee754_convert_half_to_double(uint16_t value)
 {
-	ieee754_half_t half = { .value = value };
-	ieee754_double_t d;
-
-	d.components.sign = half.components.sign;
-	d.components.e = half.components.e;
-	d.components.m = half.components.m;
-
-	if (half.components.e == E_MASK_HALF) { /* NaN or infinity */
-		d.components.e = E_MASK_DOUBLE;
-		if (half.components.m == M_MASK_HALF) { /* Quiet NaN */
-			d.components.m = M_MASK_DOUBLE;
-		} else if (half.components.m != 0){ /* Signaling NaN */
-			d.components.m = (1ull << (M_BIT_DOUBLE - 1));
-		}
-	} else if (half.components.e == 0) { /* zero or subnormal */
-		if (half.components.m != 0) { /* subnormal */
-			/* find the leading 1 to nomalize */
-			uint64_t leading_shift = (uint64_t)(M_BIT_HALF -
-					find_last_set_bit(half.components.m) + 1);
-			d.components.m <<= leading_shift;
-			d.components.e =
-				(BIAS_DOUBLE - BIAS_HALF - leading_shift + 1)
-				& E_MASK_DOUBLE;
+	const unsigned int e = (value >> M_BIT_HALF) & E_MASK_HALF;
+	uint64_t m = value & M_MASK_HALF;
+	uint64_t bits;
+	double d;
+
+	if (e != 0 && e != E_MASK_HALF) { /* normal */
+		bits = ((uint64_t)(e + BIAS_DOUBLE - BIAS_HALF) << M_BIT_DOUBLE)
+			| (m << (M_BIT_DOUBLE - M_BIT_HALF));
+	} else if (e == 0) { /* zero or subnormal, m * 2^-24 */
+		d = (double)m / (double)(1ul << (BIAS_HALF - 1 + M_BIT_HALF));
+		bits = get_double_bits(d);
+	} else { /* NaN or infinity */
+		bits = ((uint64_t)((1u << E_BIT_DOUBLE) - 1) << M_BIT_DOUBLE)
+			| (m << (M_BIT_DOUBLE - M_BIT_HALF));
+		if (m != 0) { /* NaN keeps its payload and gets quiet */
+			bits |= 1ull << (M_BIT_DOUBLE - 1);
 		}
-	} else { /* normal */
-		d.components.e = (uint32_t)(BIAS_DOUBLE + (half.components.e
-					- BIAS_HALF)) & 0x7FFu/*11-bit*/;
 	}
 
-	d.components.m <<= M_BIT_DOUBLE - M_BIT_HALF;
+	bits |= (uint64_t)(value >> 15) << 63;
+	memcpy(&d, &bits, sizeof(d));
 
-	return d.value;
+	return d;
 }
 
 bool ieee754_is_shrinkable_to_half(float value)
 {
-	ieee754_single_t single = { .value = value };
+	uint64_t half;
+	return shrink_single(get_single_bits(value), &half) == 2;
+}
 
-	if (single.components.e == 0) {
-		if (single.components.m == 0) { /* zero */
-			return true;
-		}
-		/* subnormal */
-		if (!is_precision_lost(single.components.m,
-					M_BIT_SINGLE, M_BIT_HALF)) {
-			return true;
-		}
-	} else if (single.components.e == E_MASK_SINGLE) { /* NaN or infinity */
-		return true;
-	} else if (is_in_range(single.components.e, BIAS_SINGLE, BIAS_HALF) &&
-			!is_precision_lost(single.components.m, M_BIT_SINGLE,
-				M_BIT_HALF)) {
-		return true;
-	} else if (is_in_subrange(single.components.e, M_BIT_HALF,
-				BIAS_SINGLE, BIAS_HALF)) {
-		return true;
-	}
+bool ieee754_is_shrinkable_to_single(double value)
+{
+	uint64_t single;
+	return narrow(get_double_bits(value), &double_format, &single_format,
+			&single);
+}
 
-	return false;
+unsigned int ieee754_shrink_single(float value, uint64_t *bits)
+{
+	return shrink_single(get_single_bits(value), bits);
 }
 
-bool ieee754_is_shrinkable_to_single(double value)
+unsigned int ieee754_shrink_double(double value, uint64_t *bits)
 {
-	ieee754_double_t d = { .value = value };
+	const uint64_t u = get_double_bits(value);
+	const unsigned int e = (unsigned int)(u >> M_BIT_DOUBLE)
+		& ((1u << E_BIT_DOUBLE) - 1);
 
-	if (d.components.e == 0) {
-		if (d.components.m == 0) { /* zero */
-			return true;
-		}
-		/* subnormal */
-		if (!is_precision_lost(d.components.m,
-					M_BIT_DOUBLE, M_BIT_SINGLE)) {
-			return true;
-		}
-	} else if (d.components.e == E_MASK_DOUBLE) { /* NaN or infinity */
-		return true;
-	} else if (is_in_range(d.components.e, BIAS_DOUBLE, BIAS_SINGLE) &&
-			!is_precision_lost(d.components.m, M_BIT_DOUBLE,
-				M_BIT_SINGLE)) {
-		return true;
-	} else if (is_in_subrange(d.components.e, M_BIT_SINGLE,
-				BIAS_DOUBLE, BIAS_SINGLE)) {
-		return true;
+	if (has_dropped_bits(u, M_BIT_DOUBLE, M_BIT_SINGLE)) {
+		*bits = u;
+		return 8;
+	}
+#if !defined(CBOR_FLOAT16)
+	/* straight to half, not by way of single */
+	if (!has_dropped_bits(u, M_BIT_DOUBLE, M_BIT_HALF) &&
+			is_normal_in(e, BIAS_DOUBLE, BIAS_HALF)) {
+		*bits = rebias(u, e, &double_format, &half_format);
+		return 2;
+	}
+	/* the rest of the normal range of single goes beyond half */
+	if (is_normal_in(e, BIAS_DOUBLE, BIAS_SINGLE) &&
+			e >= BIAS_DOUBLE - BIAS_HALF + 1) {
+		*bits = rebias(u, e, &double_format, &single_format);
+		return 4;
+	} else if (narrow(u, &double_format, &half_format, bits)) {
+		return 2;
+	} else if (narrow(u, &double_format, &single_format, bits)) {
+		return 4;
+	}
+#else
+	if (is_normal_in(e, BIAS_DOUBLE, BIAS_SINGLE)) {
+		return shrink_single((uint32_t)rebias(u, e,
+				&double_format, &single_format), bits);
+	} else if (narrow(u, &double_format, &single_format, bits)) {
+		return shrink_single((uint32_t)*bits, bits);
 	}
+#endif
 
-	return false;
+	*bits = u;
+	return 8;
 }
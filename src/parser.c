@@ -5,12 +5,19 @@
  */
 
 #include "cbor/parser.h"
+#include "cbor/utf8.h"
 #include <stdbool.h>
 
 #if !defined(assert)
 #define assert(expr)
 #endif
 
+#if defined(CBOR_COMPACT_ITEM)
+#define ITEM_SIZE_MAX				CBOR_ITEM_MAX_SIZE
+#else
+#define ITEM_SIZE_MAX				SIZE_MAX
+#endif
+
 struct parser_context {
 	cbor_reader_t *reader;
 
@@ -18,31 +25,48 @@ struct parser_context {
 	uint8_t additional_info;
 	uint8_t following_bytes;
 
-	uint8_t recursion_depth;
-	_Static_assert(CBOR_RECURSION_MAX_LEVEL < 256, "");
+	cbor_parser_frame_t *frames;
+	size_t maxframes;
+	size_t depth;
 
 	bool dry_run;
+	bool resumable;
 };
 
-typedef cbor_error_t (*type_parser_t)(struct parser_context *ctx);
-
 static cbor_error_t do_integer(struct parser_context *ctx);
 static cbor_error_t do_string(struct parser_context *ctx);
 static cbor_error_t do_recursive(struct parser_context *ctx);
 static cbor_error_t do_tag(struct parser_context *ctx);
 static cbor_error_t do_float_and_other(struct parser_context *ctx);
 
-/* 8 parsers for 3-bit major type */
-static const type_parser_t parsers[] = {
-	do_integer,		/* 0: unsigned integer */
-	do_integer,		/* 1: negative integer */
-	do_string,		/* 2: byte string */
-	do_string,		/* 3: text string encoded as utf-8 */
-	do_recursive,		/* 4: array */
-	do_recursive,		/* 5: map */
-	do_tag,			/* 6: tag */
-	do_float_and_other,	/* 7: float, simple value, and break */
-};
+/* Parse an item of the kind given by its initial byte. A switch rather than a
+ * table of function pointers lets the compiler inline the parsers. */
+static cbor_error_t parse_item(struct parser_context *ctx, uint8_t kind)
+{
+	switch (kind) {
+	case CBOR_ITEM_INTEGER:
+		return do_integer(ctx);
+	case CBOR_ITEM_STRING:
+		return do_string(ctx);
+	case CBOR_ITEM_ARRAY: /* fall through */
+	case CBOR_ITEM_MAP:
+		return do_recursive(ctx);
+	case CBOR_ITEM_TAG:
+		return do_tag(ctx);
+	case CBOR_ITEM_FLOAT: /* fall through */
+	case CBOR_ITEM_SIMPLE_VALUE:
+		return do_float_and_other(ctx);
+	default:
+		return CBOR_ILLEGAL;
+	}
+}
+
+/* A message ending in the middle of an item is not well-formed, unless more
+ * bytes are still to come. */
+static cbor_error_t get_truncation_error(const struct parser_context *ctx)
+{
+	return ctx->resumable? CBOR_NEED_MORE : CBOR_ILLEGAL;
+}
 
 static bool has_valid_following_bytes(const struct parser_context *ctx,
 		cbor_error_t *err)
@@ -58,7 +82,7 @@ static bool has_valid_following_bytes(const struct parser_context *ctx,
 
 	if ((ctx->following_bytes + 1u)
 			> (ctx->reader->msgsize - ctx->reader->msgidx)) {
-		*err = CBOR_ILLEGAL;
+		*err = get_truncation_error(ctx);
 		return false;
 	}
 
@@ -90,7 +114,7 @@ static bool should_stop_on_break(uint8_t val, size_t maxitems,
 {
 	const bool direct = (val == 0xff); /* BREAK(major 7, add-info 31) */
 	const bool indefinite = (maxitems == (size_t)CBOR_INDEFINITE_VALUE);
-	const bool at_end = !indefinite &&
+	const bool at_end = !indefinite && !ctx->resumable &&
 			(ctx->reader->msgidx == ctx->reader->msgsize);
 	return (direct && indefinite) || at_end;
 }
@@ -106,61 +130,199 @@ static bool is_item_buffer_overrun(const struct parser_context *ctx)
 		ctx->reader->msgidx < ctx->reader->msgsize;
 }
 
-static cbor_error_t parse(struct parser_context *ctx, size_t maxitems,
-			  size_t *nitems_parsed)
+static bool has_more_items(const struct parser_context *ctx,
+		const cbor_parser_frame_t *frame)
 {
-	cbor_error_t err = CBOR_SUCCESS;
-	uint8_t last_val = 0;
-	size_t i;
+	return frame->nparsed < frame->expected &&
+		ctx->reader->itemidx < ctx->reader->maxitems &&
+		ctx->reader->msgidx < ctx->reader->msgsize;
+}
 
-	if (ctx->recursion_depth >= CBOR_RECURSION_MAX_LEVEL) {
-		return CBOR_EXCESSIVE;
+/* A resumable parse stops at the end of the bytes given so far, keeping its
+ * frames, unless the level is complete anyway. */
+static bool can_suspend(const struct parser_context *ctx,
+		const cbor_parser_frame_t *frame)
+{
+	return ctx->resumable &&
+		ctx->reader->msgidx == ctx->reader->msgsize &&
+		(ctx->depth == 1 || frame->nparsed < frame->expected);
+}
+
+static bool push_frame(struct parser_context *ctx, uint8_t major_type,
+		size_t expected)
+{
+	if (ctx->depth >= ctx->maxframes) {
+		return false;
 	}
 
-	ctx->recursion_depth++;
+	cbor_parser_frame_t *frame = &ctx->frames[ctx->depth++];
+	frame->expected = expected;
+	frame->nparsed = 0;
+	frame->owner = ctx->reader->itemidx - 1;
+	frame->major_type = major_type;
 
-	for (i = 0; i < maxitems &&
-			ctx->reader->itemidx < ctx->reader->maxitems &&
-			ctx->reader->msgidx < ctx->reader->msgsize; i++) {
-		const uint8_t val = ctx->reader->msg[ctx->reader->msgidx];
-		last_val = val;
-		ctx->major_type = get_cbor_major_type(val);
-		ctx->additional_info = get_cbor_additional_info(val);
-		ctx->following_bytes =
-			cbor_get_following_bytes(ctx->additional_info);
+	return true;
+}
 
-		if (!has_valid_following_bytes(ctx, &err)) {
-			break;
-		}
+static void set_sibling(struct parser_context *ctx, size_t idx, size_t next)
+{
+	if (ctx->dry_run || ctx->reader->siblings == NULL) {
+		return;
+	}
 
-		err = parsers[ctx->major_type](ctx);
+	ctx->reader->siblings[idx] = next;
+}
 
-		if (err == CBOR_BREAK) {
-			if (is_illegal_break(val, maxitems)) {
-				err = CBOR_ILLEGAL;
-				break;
-			} else if (should_stop_on_break(val, maxitems, ctx)) {
-				break;
-			}
+/* Turn the result of a finished level into the result of the item owning it,
+ * as seen by the level one up. */
+static cbor_error_t close_item(const struct parser_context *ctx,
+		uint8_t major_type, size_t expected, size_t nparsed,
+		cbor_error_t err)
+{
+	switch (major_type) {
+	case 2: /* indefinite-length byte string */
+	case 3: /* indefinite-length text string */
+		if (err != CBOR_SUCCESS) {
+			return err;
+		}
+		return is_item_buffer_overrun(ctx)? CBOR_OVERRUN : CBOR_ILLEGAL;
+	case 4: /* array */
+	case 5: /* map */
+		if (err == CBOR_BREAK &&
+				expected != (size_t)CBOR_INDEFINITE_VALUE) {
+			return nparsed < expected? CBOR_ILLEGAL : CBOR_SUCCESS;
 		} else if (err != CBOR_SUCCESS) {
-			break;
+			return err;
+		}
+		if (expected == (size_t)CBOR_INDEFINITE_VALUE ||
+				nparsed < expected) {
+			return is_item_buffer_overrun(ctx)?
+				CBOR_OVERRUN : CBOR_ILLEGAL;
 		}
+		return CBOR_SUCCESS;
+	case 6: /* tag */
+		if (nparsed == 0) {
+			return is_item_buffer_overrun(ctx)?
+				CBOR_OVERRUN : CBOR_ILLEGAL;
+		}
+		return err;
+	default:
+		return err;
+	}
+}
 
-		err = CBOR_SUCCESS;
+/* Open a new level for the children of the item just stored. When the depth
+ * limit is hit, the level fails at once as if it had parsed nothing. */
+static cbor_error_t descend(struct parser_context *ctx, size_t expected)
+{
+	if (!push_frame(ctx, ctx->major_type, expected)) {
+		return close_item(ctx, ctx->major_type, expected, 0,
+				CBOR_EXCESSIVE);
 	}
 
-	ctx->recursion_depth--;
-	if (nitems_parsed != NULL) {
-		/* When stopped by BREAK from a sub-container (last_val is not
-		 * the BREAK byte 0xff itself), the item at index i was fully
-		 * parsed, so the actual count is i+1. */
-		*nitems_parsed = (err == CBOR_BREAK && last_val != 0xff) ?
-			i + 1 : i;
+	return CBOR_SUCCESS;
+}
+
+/* Account the result of one item on the current level. Returns false when the
+ * level has to stop with @p err. */
+static bool settle_item(const struct parser_context *ctx,
+		cbor_parser_frame_t *frame, uint8_t val, cbor_error_t *err)
+{
+	if (*err == CBOR_BREAK) {
+		if (is_illegal_break(val, frame->expected)) {
+			*err = CBOR_ILLEGAL;
+			return false;
+		} else if (should_stop_on_break(val, frame->expected, ctx)) {
+			return false;
+		}
+	} else if (*err != CBOR_SUCCESS) {
+		return false;
 	}
 
-	assert(ctx->reader->msgidx <= ctx->reader->msgsize);
+	*err = CBOR_SUCCESS;
+	frame->nparsed++;
 
-	return err;
+	return true;
+}
+
+/* Parse from the top of the frame stack, or start a new top level when no
+ * frame is in use. */
+static cbor_error_t parse(struct parser_context *ctx, size_t maxitems)
+{
+	if (ctx->depth == 0 && !push_frame(ctx, 0, maxitems)) {
+		return CBOR_EXCESSIVE;
+	}
+
+	for (;;) {
+		cbor_parser_frame_t *frame = &ctx->frames[ctx->depth - 1];
+		cbor_error_t err = CBOR_SUCCESS;
+		uint8_t val = 0;
+
+		if (has_more_items(ctx, frame)) {
+			const size_t depth = ctx->depth;
+			const size_t item_start = ctx->reader->msgidx;
+
+			val = ctx->reader->msg[ctx->reader->msgidx];
+			const cbor_initial_byte_t *hdr =
+				&cbor_initial_bytes[val];
+			ctx->major_type = get_cbor_major_type(val);
+			ctx->additional_info = get_cbor_additional_info(val);
+			ctx->following_bytes = hdr->following_bytes;
+
+			if (has_valid_following_bytes(ctx, &err)) {
+				err = parse_item(ctx, hdr->kind);
+
+				if (ctx->depth > depth) {
+					continue;
+				}
+			}
+
+			if (err == CBOR_NEED_MORE) {
+				/* the item gets parsed again from its header */
+				ctx->reader->msgidx = item_start;
+				return err;
+			}
+
+			if (settle_item(ctx, frame, val, &err)) {
+				continue;
+			}
+		} else if (can_suspend(ctx, frame)) {
+			return ctx->depth > 1? CBOR_NEED_MORE : CBOR_SUCCESS;
+		}
+
+		/* The level is done. Unwind as long as the result stops the
+		 * enclosing level as well. */
+		do {
+			/* When stopped by BREAK from a sub-container (val is
+			 * not the BREAK byte 0xff itself), the item at the
+			 * current index was fully parsed. */
+			const size_t nparsed = frame->nparsed +
+				((err == CBOR_BREAK && val != 0xff)? 1u : 0u);
+
+			assert(ctx->reader->msgidx <= ctx->reader->msgsize);
+
+			if (--ctx->depth == 0) {
+				return err;
+			}
+
+			set_sibling(ctx, frame->owner, ctx->reader->itemidx);
+
+			err = close_item(ctx, frame->major_type,
+					frame->expected, nparsed, err);
+			frame = &ctx->frames[ctx->depth - 1];
+			val = 0; /* the owning item is never a BREAK */
+		} while (!settle_item(ctx, frame, val, &err));
+	}
+}
+
+static bool is_addressable(size_t msgsize)
+{
+#if defined(CBOR_COMPACT_ITEM)
+	return msgsize <= CBOR_ITEM_MAX_OFFSET;
+#else
+	(void)msgsize;
+	return true;
+#endif
 }
 
 static void set_item(struct parser_context *ctx,
@@ -170,10 +332,19 @@ static void set_item(struct parser_context *ctx,
 		return;
 	}
 
+	set_sibling(ctx, ctx->reader->itemidx, ctx->reader->itemidx + 1);
+
 	cbor_item_t *item = &ctx->reader->items[ctx->reader->itemidx];
+#if defined(CBOR_COMPACT_ITEM)
+	item->type = (uint32_t)type & 0x7u;
+	item->offset = (uint32_t)(offset & CBOR_ITEM_MAX_OFFSET);
+	item->size = (size == (size_t)CBOR_INDEFINITE_VALUE)?
+			UINT32_MAX : (uint32_t)size;
+#else
 	item->type = type;
 	item->size = size;
 	item->offset = offset;
+#endif
 }
 
 static cbor_error_t do_integer(struct parser_context *ctx)
@@ -191,25 +362,40 @@ static cbor_error_t do_integer(struct parser_context *ctx)
 	return CBOR_SUCCESS;
 }
 
+static bool is_valid_text(struct parser_context *ctx, size_t len)
+{
+	if (ctx->dry_run || !ctx->reader->validate_utf8 ||
+			ctx->major_type != 3) {
+		return true;
+	}
+
+	uint8_t state = CBOR_UTF8_ACCEPT;
+	size_t valid = cbor_utf8_validate(&state,
+			&ctx->reader->msg[ctx->reader->msgidx], len);
+
+	if (valid == len && state == CBOR_UTF8_ACCEPT) {
+		return true;
+	}
+
+	ctx->reader->msgidx += valid;
+	return false;
+}
+
 static cbor_error_t do_string(struct parser_context *ctx)
 {
 	size_t len = go_get_item_length(ctx);
-	cbor_error_t err;
 
 	set_item(ctx, CBOR_ITEM_STRING, ctx->reader->msgidx, len);
 
 	if (len == (size_t)CBOR_INDEFINITE_VALUE) {
 		ctx->reader->itemidx++;
-		err = parse(ctx, (size_t)CBOR_INDEFINITE_VALUE, NULL);
-		if (err != CBOR_SUCCESS) {
-			return err;
-		} else if (is_item_buffer_overrun(ctx)) {
-			return CBOR_OVERRUN;
-		}
-		return CBOR_ILLEGAL;
+		return descend(ctx, (size_t)CBOR_INDEFINITE_VALUE);
 	}
 	if (len > ctx->reader->msgsize - ctx->reader->msgidx) {
-		return CBOR_ILLEGAL;
+		return get_truncation_error(ctx);
+	}
+	if (!is_valid_text(ctx, len)) {
+		return CBOR_INVALID;
 	}
 
 	ctx->reader->msgidx += len;
@@ -222,8 +408,12 @@ static cbor_error_t do_recursive(struct parser_context *ctx)
 {
 	size_t len = go_get_item_length(ctx);
 	size_t expected_items = len;
-	cbor_error_t err;
 
+#if defined(CBOR_COMPACT_ITEM)
+	if (len != (size_t)CBOR_INDEFINITE_VALUE && len > CBOR_ITEM_MAX_SIZE) {
+		return CBOR_INVALID;
+	}
+#endif
 	set_item(ctx, (cbor_item_data_t)(ctx->major_type - 1),
 			ctx->reader->msgidx, len);
 	if (len != (size_t)CBOR_INDEFINITE_VALUE && (cbor_item_data_t)
@@ -235,26 +425,8 @@ static cbor_error_t do_recursive(struct parser_context *ctx)
 	}
 
 	ctx->reader->itemidx++;
-	size_t nparsed = 0;
 
-	if ((err = parse(ctx, expected_items, &nparsed)) != CBOR_SUCCESS) {
-		if (err == CBOR_BREAK && len != (size_t)CBOR_INDEFINITE_VALUE) {
-			if (nparsed < expected_items) {
-				return CBOR_ILLEGAL;
-			}
-			return CBOR_SUCCESS;
-		}
-		return err;
-	}
-
-	if (len == (size_t)CBOR_INDEFINITE_VALUE || nparsed < expected_items) {
-		if (is_item_buffer_overrun(ctx)) {
-			return CBOR_OVERRUN;
-		}
-		return CBOR_ILLEGAL;
-	}
-
-	return CBOR_SUCCESS;
+	return descend(ctx, expected_items);
 }
 
 static cbor_error_t do_tag(struct parser_context *ctx)
@@ -275,21 +447,14 @@ static cbor_error_t do_tag(struct parser_context *ctx)
 	}
 	ctx->reader->msgidx += (size_t)ctx->following_bytes + 1;
 
-	if (tag_number > (uint64_t)SIZE_MAX) {
+	if (tag_number > (uint64_t)ITEM_SIZE_MAX) {
 		return CBOR_INVALID;
 	}
 
 	set_item(ctx, CBOR_ITEM_TAG, tag_offset, (cbor_tag_t)tag_number);
 	ctx->reader->itemidx++;
 
-	size_t nparsed = 0;
-	cbor_error_t err = parse(ctx, 1, &nparsed);
-
-	if (nparsed == 0) {
-		return is_item_buffer_overrun(ctx)? CBOR_OVERRUN : CBOR_ILLEGAL;
-	}
-
-	return err;
+	return descend(ctx, 1);
 }
 
 static cbor_error_t do_float_and_other(struct parser_context *ctx)
@@ -318,22 +483,312 @@ static cbor_error_t do_float_and_other(struct parser_context *ctx)
 	return err;
 }
 
+struct stringref_context {
+	cbor_reader_t *reader;
+	size_t nitems;
+	size_t base; /* the first table entry of the namespace */
+	uint64_t count; /* strings numbered in the namespace */
+	bool active;
+
+	cbor_parser_frame_t *frames;
+	size_t maxframes;
+	size_t depth;
+};
+
+static uint64_t get_unsigned(cbor_reader_t const *reader,
+		cbor_item_t const *item)
+{
+	uint8_t const *p = &reader->msg[item->offset];
+	size_t len = cbor_get_item_size(item);
+	uint64_t value = len == 0? (uint64_t)(p[0] & 0x1fu) : 0;
+
+	for (size_t i = 1; i <= len; i++) {
+		value = (value << 8) | p[i];
+	}
+
+	return value;
+}
+
+static size_t count_kept(struct stringref_context const *ctx)
+{
+	size_t room = ctx->reader->maxstringrefs - ctx->base;
+	return ctx->count < room? (size_t)ctx->count : room;
+}
+
+/* Open a level for the children of the item at @p owner. A namespace, tag
+ * 256, gets a level of its own keeping the state of the one it is nested in:
+ * the base in owner, the count in expected and whether any was active in
+ * nparsed. It closes with the single item it wraps. */
+static bool open_level(struct stringref_context *ctx, uint8_t major_type,
+		size_t owner, size_t expected)
+{
+	if (ctx->depth >= ctx->maxframes) {
+		return false;
+	}
+
+	cbor_parser_frame_t *frame = &ctx->frames[ctx->depth++];
+	frame->major_type = major_type;
+	frame->owner = owner;
+	frame->expected = expected;
+	frame->nparsed = 0;
+
+	if (major_type == 6) {
+		frame->owner = ctx->base;
+		frame->expected = (size_t)ctx->count;
+		frame->nparsed = ctx->active;
+
+		ctx->base += count_kept(ctx);
+		ctx->count = 0;
+		ctx->active = true;
+	}
+
+	return true;
+}
+
+static void close_level(struct stringref_context *ctx)
+{
+	cbor_parser_frame_t const *frame = &ctx->frames[--ctx->depth];
+
+	if (frame->major_type == 6) {
+		ctx->base = frame->owner;
+		ctx->count = frame->expected;
+		ctx->active = frame->nparsed != 0;
+	}
+}
+
+/* Count an item done on its level, closing the levels it completes */
+static void complete_item(struct stringref_context *ctx)
+{
+	while (ctx->depth > 0) {
+		cbor_parser_frame_t *frame = &ctx->frames[ctx->depth - 1];
+
+		if (frame->major_type != 6) {
+			if (frame->expected == (size_t)CBOR_INDEFINITE_VALUE ||
+					++frame->nparsed < frame->expected) {
+				return;
+			}
+		}
+
+		close_level(ctx);
+	}
+}
+
+/* Replace the number of tag 25 with the string it refers to. The tag item
+ * is left as it is, like any other tag. */
+static cbor_error_t resolve_reference(struct stringref_context *ctx,
+		size_t *idx)
+{
+	cbor_reader_t *reader = ctx->reader;
+	cbor_item_t *item = &reader->items[*idx];
+
+	if (*idx >= ctx->nitems || item->type != CBOR_ITEM_INTEGER ||
+			(reader->msg[item->offset] >> 5) != 0) {
+		return CBOR_INVALID;
+	}
+
+	uint64_t n = get_unsigned(reader, item);
+
+	if (n >= ctx->count) {
+		return CBOR_INVALID;
+	} else if (n >= count_kept(ctx)) {
+		return CBOR_EXCESSIVE;
+	}
+
+	*item = reader->items[reader->stringrefs[ctx->base + (size_t)n]];
+	(*idx)++;
+	complete_item(ctx);
+
+	return CBOR_SUCCESS;
+}
+
+/* Chunks of an indefinite-length string, on a level of major type 2, are
+ * not numbered */
+static bool is_numbered(struct stringref_context const *ctx, size_t size)
+{
+	return ctx->active && cbor_stringref_is_numbered(size, ctx->count) &&
+		(ctx->depth == 0 ||
+			ctx->frames[ctx->depth - 1].major_type > 3);
+}
+
+static cbor_error_t resolve_item(struct stringref_context *ctx, size_t *idx)
+{
+	cbor_reader_t *reader = ctx->reader;
+	size_t i = (*idx)++;
+	cbor_item_t const *item = &reader->items[i];
+	size_t size = cbor_get_item_size(item);
+	bool indefinite = cbor_item_is_indefinite(item);
+
+	switch (item->type) {
+	case CBOR_ITEM_TAG:
+		if (*idx >= ctx->nitems) {
+			return CBOR_INVALID;
+		} else if (cbor_get_tag_number(item) == 25 && ctx->active) {
+			return resolve_reference(ctx, idx);
+		} else if (cbor_get_tag_number(item) == 256 &&
+				!open_level(ctx, 6, i, 1)) {
+			return CBOR_EXCESSIVE;
+		}
+		return CBOR_SUCCESS; /* done with the item it wraps */
+	case CBOR_ITEM_STRING:
+		if (indefinite) {
+			return open_level(ctx, 2, i,
+					(size_t)CBOR_INDEFINITE_VALUE)?
+				CBOR_SUCCESS : CBOR_EXCESSIVE;
+		} else if (is_numbered(ctx, size)) {
+			if (ctx->count < reader->maxstringrefs - ctx->base) {
+				reader->stringrefs[ctx->base +
+					(size_t)ctx->count] = i;
+			}
+			ctx->count++;
+		}
+		break;
+	case CBOR_ITEM_MAP: /* fall through */
+	case CBOR_ITEM_ARRAY:
+		if (indefinite) {
+			size = (size_t)CBOR_INDEFINITE_VALUE;
+		} else if (item->type == CBOR_ITEM_MAP) {
+			size *= 2;
+		}
+		if (size > 0) {
+			return open_level(ctx, (uint8_t)(item->type + 1), i,
+					size)? CBOR_SUCCESS : CBOR_EXCESSIVE;
+		}
+		break;
+	default:
+		break;
+	}
+
+	complete_item(ctx);
+
+	return CBOR_SUCCESS;
+}
+
+/* Walk the items in order, numbering the strings of each stringref
+ * namespace as they appear and resolving references to them. Nesting is
+ * kept in the reader's frames above those a resumed parse keeps in use.
+ * Items resolved by an earlier call of a resumed parse are skipped; they
+ * end on a top-level boundary, where no namespace is open. */
+static cbor_error_t resolve_stringrefs(cbor_reader_t *reader)
+{
+	cbor_parser_frame_t frames[CBOR_RECURSION_MAX_LEVEL];
+	struct stringref_context ctx = {
+		.reader = reader,
+		.nitems = reader->itemidx,
+		.frames = frames,
+		.maxframes = CBOR_RECURSION_MAX_LEVEL,
+	};
+	cbor_error_t err = CBOR_SUCCESS;
+
+	if (reader->frames != NULL) {
+		ctx.frames = &reader->frames[reader->depth];
+		ctx.maxframes = reader->maxframes - reader->depth;
+	}
+
+	for (size_t i = reader->resolved;
+			err == CBOR_SUCCESS && i < ctx.nitems;) {
+		if (!cbor_item_is_break(&reader->items[i])) {
+			err = resolve_item(&ctx, &i);
+			continue;
+		}
+
+		i++;
+		/* closing an indefinite-length level, or a top-level one */
+		if (ctx.depth > 0 && ctx.frames[ctx.depth - 1].expected ==
+				(size_t)CBOR_INDEFINITE_VALUE) {
+			close_level(&ctx);
+			complete_item(&ctx);
+		}
+	}
+
+	if (err == CBOR_SUCCESS && ctx.depth > 0) {
+		err = CBOR_INVALID;
+	}
+	if (err == CBOR_SUCCESS) {
+		reader->resolved = ctx.nitems;
+	}
+
+	return err;
+}
+
+static cbor_error_t finish_parse(cbor_reader_t *reader, cbor_error_t err)
+{
+	if ((err == CBOR_SUCCESS || err == CBOR_BREAK) &&
+			reader->stringrefs != NULL) {
+		cbor_error_t resolved = resolve_stringrefs(reader);
+
+		if (resolved != CBOR_SUCCESS) {
+			err = resolved;
+		}
+	}
+
+	return err;
+}
+
+void cbor_reader_set_frames(cbor_reader_t *reader,
+		cbor_parser_frame_t *frames, size_t maxframes)
+{
+	assert(reader != NULL);
+
+	reader->frames = frames;
+	reader->maxframes = frames != NULL? maxframes : 0;
+}
+
+void cbor_reader_set_sibling_index(cbor_reader_t *reader, size_t *siblings)
+{
+	assert(reader != NULL);
+
+	reader->siblings = siblings;
+}
+
+void cbor_reader_set_utf8_validation(cbor_reader_t *reader, bool enable)
+{
+	assert(reader != NULL);
+
+	reader->validate_utf8 = enable;
+}
+
+void cbor_reader_set_stringrefs(cbor_reader_t *reader,
+		size_t *stringrefs, size_t maxstringrefs)
+{
+	assert(reader != NULL);
+
+	reader->stringrefs = stringrefs;
+	reader->maxstringrefs = stringrefs != NULL? maxstringrefs : 0;
+}
+
 cbor_error_t cbor_parse(cbor_reader_t *reader,
 		void const *msg, size_t msgsize, size_t *nitems_parsed)
 {
 	assert(reader->items != NULL);
 	reader->itemidx = 0;
+	reader->resolved = 0;
+
+	if (!is_addressable(msgsize)) {
+		if (nitems_parsed != NULL) {
+			*nitems_parsed = 0;
+		}
+		return CBOR_INVALID;
+	}
 
 	reader->msg = (uint8_t const *)msg;
 	reader->msgsize = msgsize;
 	reader->msgidx = 0;
+	reader->depth = 0;
 
+	cbor_parser_frame_t frames[CBOR_RECURSION_MAX_LEVEL];
 	struct parser_context ctx = {
 		.reader = reader,
+		.frames = frames,
+		.maxframes = CBOR_RECURSION_MAX_LEVEL,
 		.dry_run = false,
 	};
 
-	cbor_error_t err = parse(&ctx, reader->maxitems, NULL);
+	if (reader->frames != NULL) {
+		ctx.frames = reader->frames;
+		ctx.maxframes = reader->maxframes;
+	}
+
+	cbor_error_t err = parse(&ctx, reader->maxitems);
 
 	if (err == CBOR_SUCCESS && reader->msgidx < reader->msgsize) {
 		err = CBOR_OVERRUN;
@@ -343,12 +798,75 @@ cbor_error_t cbor_parse(cbor_reader_t *reader,
 		*nitems_parsed = reader->itemidx;
 	}
 
+	return finish_parse(reader, err);
+}
+
+cbor_error_t cbor_parse_resume(cbor_reader_t *reader,
+		void const *msg, size_t msgsize, size_t *nitems_parsed)
+{
+	assert(reader->items != NULL);
+
+	if (reader->frames == NULL || reader->maxframes == 0 ||
+			!is_addressable(msgsize)) {
+		return CBOR_INVALID;
+	}
+
+	if (reader->depth == 0) {
+		reader->itemidx = 0;
+		reader->msgidx = 0;
+		reader->resolved = 0;
+	} else if (msgsize < reader->msgidx) {
+		return CBOR_INVALID;
+	}
+
+	reader->msg = (uint8_t const *)msg;
+	reader->msgsize = msgsize;
+
+	struct parser_context ctx = {
+		.reader = reader,
+		.frames = reader->frames,
+		.maxframes = reader->maxframes,
+		.depth = reader->depth,
+		.dry_run = false,
+		.resumable = true,
+	};
+
+	cbor_error_t err = parse(&ctx, reader->maxitems);
+
+	reader->depth = ctx.depth;
+
+	if (err == CBOR_SUCCESS && reader->msgidx < reader->msgsize) {
+		err = CBOR_OVERRUN;
+	}
+
+	if (nitems_parsed != NULL) {
+		*nitems_parsed = reader->itemidx;
+	}
+
+	err = finish_parse(reader, err);
+
+	if (err != CBOR_SUCCESS && err != CBOR_NEED_MORE) {
+		reader->depth = 0; /* a new message starts */
+	}
+
 	return err;
 }
 
 cbor_error_t cbor_count_items(void const *msg, size_t msgsize,
 		size_t *nitems_counted)
 {
+	cbor_parser_frame_t frames[CBOR_RECURSION_MAX_LEVEL];
+
+	return cbor_count_items_with_frames(msg, msgsize,
+			frames, CBOR_RECURSION_MAX_LEVEL, nitems_counted);
+}
+
+cbor_error_t cbor_count_items_with_frames(void const *msg, size_t msgsize,
+		cbor_parser_frame_t *frames, size_t maxframes,
+		size_t *nitems_counted)
+{
+	assert(frames != NULL || maxframes == 0);
+
 	cbor_reader_t reader = {
 		.msg = (uint8_t const *)msg,
 		.msgsize = msgsize,
@@ -360,10 +878,12 @@ cbor_error_t cbor_count_items(void const *msg, size_t msgsize,
 
 	struct parser_context ctx = {
 		.reader = &reader,
+		.frames = frames,
+		.maxframes = maxframes,
 		.dry_run = true,
 	};
 
-	cbor_error_t err = parse(&ctx, reader.msgsize, NULL);
+	cbor_error_t err = parse(&ctx, reader.msgsize);
 
 	/* CBOR_BREAK means the message contained indefinite-length items;
 	 * that is valid for counting purposes. */
@@ -380,3 +900,208 @@ cbor_error_t cbor_count_items(void const *msg, size_t msgsize,
 
 	return err;
 }
+
+struct record_walk {
+	uint8_t const *msg;
+	size_t msgsize;
+	size_t msgidx;
+	size_t nitems;
+
+	cbor_parser_frame_t *frames; /* items left on each level */
+	size_t maxframes;
+	size_t depth;
+};
+
+/* Count an item done on its level, closing the levels it completes */
+static void walk_past_item(struct record_walk *w)
+{
+	while (w->depth > 0) {
+		size_t *left = &w->frames[w->depth - 1].expected;
+
+		if (*left == (size_t)CBOR_INDEFINITE_VALUE || --*left > 0) {
+			break;
+		}
+
+		w->depth--;
+	}
+}
+
+/* Open a level of @p n items, nesting as deep as cbor_parse() would */
+static cbor_error_t walk_into(struct record_walk *w, size_t n)
+{
+	if (w->depth >= w->maxframes) {
+		return CBOR_EXCESSIVE;
+	}
+
+	if (n == 0) {
+		walk_past_item(w);
+	} else {
+		w->frames[w->depth++].expected = n;
+	}
+
+	return CBOR_SUCCESS;
+}
+
+static uint64_t read_argument(uint8_t const *p, uint8_t following_bytes)
+{
+	uint64_t val = 0;
+
+	if (following_bytes == 0) {
+		return get_cbor_additional_info(p[0]);
+	}
+
+	for (uint8_t i = 1; i <= following_bytes; i++) {
+		val = (val << 8) | p[i];
+	}
+
+	return val;
+}
+
+/* Step over the header of the item at the current index and, for a
+ * definite-length string, its payload */
+static cbor_error_t walk_item(struct record_walk *w)
+{
+	uint8_t const *p = &w->msg[w->msgidx];
+	size_t avail = w->msgsize - w->msgidx;
+	cbor_initial_byte_t const *hdr = &cbor_initial_bytes[p[0]];
+	bool indefinite = hdr->following_bytes == (uint8_t)CBOR_INDEFINITE_VALUE;
+	uint64_t arg = 0;
+
+	if (hdr->kind == CBOR_ITEM_UNKNOWN) {
+		return CBOR_ILLEGAL;
+	} else if (!indefinite && hdr->following_bytes >= avail) {
+		return CBOR_NEED_MORE;
+	} else if (!indefinite) {
+		arg = read_argument(p, hdr->following_bytes);
+		w->msgidx += hdr->following_bytes;
+	}
+
+	w->msgidx++;
+	w->nitems++;
+
+	switch (hdr->kind) {
+	case CBOR_ITEM_STRING:
+		if (indefinite) {
+			return walk_into(w, (size_t)CBOR_INDEFINITE_VALUE);
+		} else if (arg > w->msgsize - w->msgidx) {
+			return CBOR_NEED_MORE;
+		}
+		w->msgidx += (size_t)arg;
+		break;
+	case CBOR_ITEM_ARRAY: /* fall through */
+	case CBOR_ITEM_MAP:
+		if (indefinite) {
+			return walk_into(w, (size_t)CBOR_INDEFINITE_VALUE);
+		}
+#if defined(CBOR_COMPACT_ITEM)
+		if (arg > CBOR_ITEM_MAX_SIZE) {
+			return CBOR_INVALID;
+		}
+#endif
+		if (hdr->kind == CBOR_ITEM_MAP && arg > SIZE_MAX / 2) {
+			return CBOR_ILLEGAL;
+		}
+		return walk_into(w, (hdr->kind == CBOR_ITEM_MAP)?
+				(size_t)arg * 2 : (size_t)arg);
+	case CBOR_ITEM_TAG:
+		if (indefinite) {
+			return CBOR_ILLEGAL;
+		} else if (arg > (uint64_t)ITEM_SIZE_MAX) {
+			return CBOR_INVALID;
+		}
+		return walk_into(w, 1);
+	case CBOR_ITEM_INTEGER:
+		if (indefinite) {
+			return CBOR_ILLEGAL;
+		}
+		break;
+	default: /* a BREAK closes an indefinite-length level */
+		if (indefinite) {
+			if (w->frames[w->depth - 1].expected !=
+					(size_t)CBOR_INDEFINITE_VALUE) {
+				return CBOR_ILLEGAL;
+			}
+			w->depth--;
+		}
+		break;
+	}
+
+	walk_past_item(w);
+
+	return CBOR_SUCCESS;
+}
+
+/* Find the end of the first top-level item of msg from the headers and
+ * lengths alone, counting the items cbor_parse() would store. Only the
+ * number of items left on each level is kept, in the expected count of a
+ * frame. A truncated item gives CBOR_NEED_MORE, as a resumable parse does. */
+static cbor_error_t skip_record(uint8_t const *msg, size_t msgsize,
+		cbor_parser_frame_t *frames, size_t maxframes,
+		cbor_seq_record_t *record)
+{
+	struct record_walk w = {
+		.msg = msg,
+		.msgsize = msgsize,
+		.frames = frames,
+		.maxframes = maxframes,
+	};
+	cbor_error_t err = walk_into(&w, 1);
+
+	while (err == CBOR_SUCCESS && w.depth > 0) {
+		err = (w.msgidx < w.msgsize)? walk_item(&w) : CBOR_NEED_MORE;
+	}
+
+	record->size = w.msgidx;
+	record->nitems = w.nitems;
+
+	return err;
+}
+
+cbor_error_t cbor_split_sequence(void const *msg, size_t msgsize,
+		cbor_seq_record_t *records, size_t maxrecords,
+		size_t *nrecords_found)
+{
+	cbor_parser_frame_t frames[CBOR_RECURSION_MAX_LEVEL];
+
+	return cbor_split_sequence_with_frames(msg, msgsize,
+			frames, CBOR_RECURSION_MAX_LEVEL,
+			records, maxrecords, nrecords_found);
+}
+
+cbor_error_t cbor_split_sequence_with_frames(void const *msg, size_t msgsize,
+		cbor_parser_frame_t *frames, size_t maxframes,
+		cbor_seq_record_t *records, size_t maxrecords,
+		size_t *nrecords_found)
+{
+	assert(frames != NULL || maxframes == 0);
+
+	uint8_t const *p = (uint8_t const *)msg;
+	size_t offset = 0;
+	size_t n = 0;
+	cbor_error_t err = CBOR_SUCCESS;
+
+	while (offset < msgsize) {
+		cbor_seq_record_t record = { .offset = offset, };
+
+		if (n >= maxrecords) {
+			err = CBOR_OVERRUN;
+			break;
+		}
+
+		err = skip_record(&p[offset], msgsize - offset,
+				frames, maxframes, &record);
+
+		if (err != CBOR_SUCCESS) {
+			break;
+		}
+
+		records[n++] = record;
+		offset += record.size;
+	}
+
+	if (nrecords_found != NULL) {
+		*nrecords_found = n;
+	}
+
+	return err;
+}
@@ -5,7 +5,9 @@
  */
 
 #include "cbor/stream.h"
+#include "cbor/helper.h"
 #include "cbor/ieee754.h"
+#include "cbor/utf8.h"
 
 #include <limits.h>
 #include <string.h>
@@ -26,20 +28,222 @@ static bool can_fit_int64(uint64_t value)
 	return value <= (uint64_t)INT64_MAX;
 }
 
-static void build_event(const cbor_stream_decoder_t *d,
-		cbor_stream_event_type_t type, cbor_stream_event_t *event)
+static void build_event(cbor_stream_decoder_t *d,
+		cbor_stream_event_type_t type)
 {
+	cbor_stream_event_t *event = &d->record.event;
+
 	event->type = type;
 	event->depth = d->depth;
 	event->is_map_key = (d->depth > 0) &&
 		(d->stack[d->depth - 1].type == CBOR_ITEM_MAP) &&
 		d->stack[d->depth - 1].is_key;
+	event->parser = d->parser;
 }
 
-static cbor_error_t invoke_cb(cbor_stream_decoder_t *d,
-		const cbor_stream_event_t *event, const cbor_stream_data_t *data)
+static bool has_path(uint32_t match, unsigned int i)
+{
+	return (match & ((uint32_t)1 << i)) != 0;
+}
+
+/* The segment an item at the current depth is matched against */
+static const struct cbor_path_segment *get_segment(
+		const cbor_stream_decoder_t *d, unsigned int i)
+{
+	return &d->paths[i].path[d->depth - 1];
+}
+
+/* Of the paths the item is on, pick the first one ending at it */
+static bool ends_here(cbor_stream_decoder_t *d, uint32_t match)
+{
+	for (unsigned int i = 0; i < d->nr_paths && (match >> i) != 0; i++) {
+		if (has_path(match, i) && d->paths[i].depth == d->depth) {
+			d->parser = &d->paths[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint32_t match_index(const cbor_stream_decoder_t *d,
+		const cbor_stream_frame_t *f)
+{
+	uint32_t match = 0;
+
+	for (unsigned int i = 0; i < d->nr_paths; i++) {
+		if (!has_path(f->match, i)) {
+			continue;
+		}
+
+		const struct cbor_path_segment *seg = get_segment(d, i);
+
+		if (seg->type == CBOR_KEY_ANY || (seg->type == CBOR_KEY_IDX &&
+				seg->val >= 0 && (size_t)seg->val == f->index)) {
+			match |= (uint32_t)1 << i;
+		}
+	}
+
+	return match;
+}
+
+/* Find the paths the item starting at the current depth is on. It is
+ * delivered when its parent is, or when one of them ends at it. */
+static bool filter_item(cbor_stream_decoder_t *d, uint32_t *match)
+{
+	if (d->skip_next) {
+		return false;
+	}
+	if (d->nr_paths == 0) {
+		return d->depth == 0 || d->stack[d->depth - 1].deliver;
+	}
+	if (d->depth == 0) {
+		*match = (uint32_t)(((uint64_t)1 << d->nr_paths) - 1);
+		return ends_here(d, *match);
+	}
+
+	const cbor_stream_frame_t *f = &d->stack[d->depth - 1];
+
+	if (f->deliver) {
+		return true;
+	}
+	if (f->match == 0 || (f->type == CBOR_ITEM_MAP && f->is_key)) {
+		return false;
+	}
+
+	*match = (f->type == CBOR_ITEM_MAP)? f->key_match : match_index(d, f);
+	return *match != 0 && ends_here(d, *match);
+}
+
+static bool wanted(cbor_stream_decoder_t *d)
+{
+	uint32_t match = 0;
+	return filter_item(d, &match);
+}
+
+/* The map whose key starts at the current depth, if it has paths to match */
+static cbor_stream_frame_t *get_key_frame(cbor_stream_decoder_t *d)
+{
+	if (d->nr_paths == 0 || d->depth == 0) {
+		return NULL;
+	}
+
+	cbor_stream_frame_t *f = &d->stack[d->depth - 1];
+
+	if (f->type != CBOR_ITEM_MAP || !f->is_key || f->deliver ||
+			f->match == 0) {
+		return NULL;
+	}
+
+	return f;
+}
+
+static void match_int_key(cbor_stream_decoder_t *d,
+		bool negative, uint64_t raw)
+{
+	cbor_stream_frame_t *f = get_key_frame(d);
+
+	if (f == NULL) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < d->nr_paths; i++) {
+		if (!has_path(f->match, i)) {
+			continue;
+		}
+
+		const struct cbor_path_segment *seg = get_segment(d, i);
+		bool equal = negative?
+			(seg->val < 0 && (uint64_t)(-1 - seg->val) == raw) :
+			(seg->val >= 0 && (uint64_t)seg->val == raw);
+
+		if (seg->type == CBOR_KEY_ANY ||
+				(seg->type == CBOR_KEY_INT && equal)) {
+			f->key_match |= (uint32_t)1 << i;
+		}
+	}
+}
+
+/* A string key is compared chunk by chunk, so it may straddle feeds */
+static void match_str_key(cbor_stream_decoder_t *d,
+		const uint8_t *ptr, size_t len, bool first, bool last)
+{
+	cbor_stream_frame_t *f = get_key_frame(d);
+
+	if (f == NULL) {
+		return;
+	}
+
+	if (first) {
+		f->key_match = f->match;
+		d->key_offset = 0;
+	}
+
+	for (unsigned int i = 0; i < d->nr_paths; i++) {
+		if (!has_path(f->key_match, i)) {
+			continue;
+		}
+
+		const struct cbor_path_segment *seg = get_segment(d, i);
+		const uint8_t *key = (const uint8_t *)seg->val + d->key_offset;
+
+		if (seg->type == CBOR_KEY_ANY) {
+			continue;
+		}
+		if (seg->type != CBOR_KEY_STR ||
+				seg->len - d->key_offset < len ||
+				(last && d->key_offset + len != seg->len) ||
+				(len > 0 && (key[0] != ptr[0] ||
+					memcmp(key, ptr, len) != 0))) {
+			f->key_match &= ~((uint32_t)1 << i);
+		}
+	}
+
+	d->key_offset += len;
+}
+
+static cbor_stream_data_t *clear_data(cbor_stream_decoder_t *d)
 {
-	if (!d->callback(event, data, d->callback_arg)) {
+	static const cbor_stream_data_t zero = { 0 };
+
+	d->record.data = zero;
+	return &d->record.data;
+}
+
+/* Leave out what is left of the item the event just delivered is part of.
+ * A container is turned into a subtree no path matches. */
+static void skip_rest(cbor_stream_decoder_t *d)
+{
+	cbor_stream_frame_t *f;
+
+	switch (d->record.event.type) {
+	case CBOR_STREAM_EVENT_ARRAY_START: /* fall through */
+	case CBOR_STREAM_EVENT_MAP_START:
+		f = &d->stack[d->depth - 1];
+		f->deliver = false;
+		f->match   = 0;
+		break;
+	case CBOR_STREAM_EVENT_BYTES: /* fall through */
+	case CBOR_STREAM_EVENT_TEXT:
+		if (!d->record.data.str.last) {
+			d->str_deliver = false;
+			d->utf8_state  = CBOR_UTF8_ACCEPT;
+		}
+		break;
+	case CBOR_STREAM_EVENT_TAG:
+		d->skip_next = true;
+		break;
+	default:
+		break;
+	}
+}
+
+static cbor_error_t flush_batch(cbor_stream_decoder_t *d)
+{
+	size_t n = d->batch_len;
+
+	d->batch_len = 0;
+
+	if (n > 0 && !d->batch_callback(d->batch, n, d->callback_arg)) {
 		d->error = CBOR_ABORTED;
 		d->state = STREAM_STATE_ERROR;
 		return CBOR_ABORTED;
@@ -47,21 +251,77 @@ static cbor_error_t invoke_cb(cbor_stream_decoder_t *d,
 	return CBOR_SUCCESS;
 }
 
+/* Count in the record at the end of the batch, handing it over once full */
+static cbor_error_t add_to_batch(cbor_stream_decoder_t *d)
+{
+	d->pulled = true;
+
+	if (++d->batch_len == d->batch_cap) {
+		return flush_batch(d);
+	}
+	return CBOR_SUCCESS;
+}
+
+/* The event is built in the decoder, so a pull only has to mark it ready */
+static cbor_error_t hand_over(cbor_stream_decoder_t *d)
+{
+	if (d->batch != NULL) {
+		d->batch[d->batch_len] = d->record;
+		return add_to_batch(d);
+	}
+
+	d->pulled = true;
+	return CBOR_SUCCESS;
+}
+
+/* Act on a callback asking for anything but to go on */
+static cbor_error_t act_on(cbor_stream_decoder_t *d,
+		cbor_stream_action_t action)
+{
+	if (action == CBOR_STREAM_SKIP) {
+		skip_rest(d);
+	} else if (action == CBOR_STREAM_ABORT) {
+		d->error = CBOR_ABORTED;
+		d->state = STREAM_STATE_ERROR;
+		return CBOR_ABORTED;
+	}
+	return CBOR_SUCCESS;
+}
+
+/* Only a decoder without a callback pulls or batches, so a callback is
+ * called with no test for either */
+static cbor_error_t invoke_cb(cbor_stream_decoder_t *d,
+		const cbor_stream_data_t *data)
+{
+	if (d->callback == NULL) {
+		return hand_over(d);
+	}
+
+	cbor_stream_action_t action =
+		d->callback(&d->record.event, data, d->callback_arg);
+
+	if (action != CBOR_STREAM_CONTINUE) {
+		return act_on(d, action);
+	}
+	return CBOR_SUCCESS;
+}
+
 static cbor_error_t emit_tag(cbor_stream_decoder_t *d, uint64_t tag_number)
 {
 	if (d->pending_tag_count >= CBOR_STREAM_MAX_PENDING_TAGS) {
 		return CBOR_EXCESSIVE;
 	}
 
-	cbor_stream_event_t event;
-	cbor_stream_data_t  data = {0};
+	if (wanted(d)) {
+		cbor_stream_data_t *data = clear_data(d);
 
-	build_event(d, CBOR_STREAM_EVENT_TAG, &event);
-	data.tag = tag_number;
+		build_event(d, CBOR_STREAM_EVENT_TAG);
+		data->tag = tag_number;
 
-	cbor_error_t err = invoke_cb(d, &event, &data);
-	if (err != CBOR_SUCCESS) {
-		return err;
+		cbor_error_t err = invoke_cb(d, data);
+		if (err != CBOR_SUCCESS) {
+			return err;
+		}
 	}
 
 	d->pending_tag_count++;
@@ -70,24 +330,32 @@ static cbor_error_t emit_tag(cbor_stream_decoder_t *d, uint64_t tag_number)
 
 static cbor_error_t emit_container_end(cbor_stream_decoder_t *d)
 {
-	cbor_stream_event_t event;
 	cbor_stream_event_type_t type;
 
 	d->depth--;
+	if (!d->stack[d->depth].deliver) {
+		return CBOR_SUCCESS;
+	}
+
 	type = (d->stack[d->depth].type == CBOR_ITEM_ARRAY)
 		? CBOR_STREAM_EVENT_ARRAY_END : CBOR_STREAM_EVENT_MAP_END;
-	build_event(d, type, &event);
-	return invoke_cb(d, &event, NULL);
+	build_event(d, type);
+	return invoke_cb(d, NULL);
 }
 
-static cbor_error_t after_item(cbor_stream_decoder_t *d)
+/* Count the item just done in its container, closing the ones it ends */
+static cbor_error_t count_item(cbor_stream_decoder_t *d)
 {
 	while (d->depth > 0) {
 		cbor_stream_frame_t *f = &d->stack[d->depth - 1];
 
 		if (f->type == CBOR_ITEM_MAP) {
 			f->is_key = !f->is_key;
+			if (f->is_key) {
+				f->key_match = 0;
+			}
 		}
+		f->index++;
 
 		if (f->count < 0) {
 			/* indefinite: wait for BREAK */
@@ -101,6 +369,11 @@ static cbor_error_t after_item(cbor_stream_decoder_t *d)
 
 		f->count--; /* reaches 0: emit END */
 
+		if (d->pull && f->deliver && d->pulled) {
+			/* one event at a time: cbor_stream_next() closes it */
+			break;
+		}
+
 		cbor_error_t err = emit_container_end(d);
 		if (err != CBOR_SUCCESS) {
 			return err;
@@ -110,6 +383,28 @@ static cbor_error_t after_item(cbor_stream_decoder_t *d)
 	return CBOR_SUCCESS;
 }
 
+static cbor_error_t after_item(cbor_stream_decoder_t *d)
+{
+	d->skip_next = false;
+	return count_item(d);
+}
+
+static cbor_stream_frame_t *push_frame(cbor_stream_decoder_t *d,
+		cbor_item_data_t type, int64_t count, bool deliver, uint32_t match)
+{
+	cbor_stream_frame_t *f = &d->stack[d->depth++];
+
+	f->type      = type;
+	f->count     = count;
+	f->is_key    = (type == CBOR_ITEM_MAP);
+	f->deliver   = deliver;
+	f->match     = match;
+	f->key_match = 0;
+	f->index     = 0;
+
+	return f;
+}
+
 static cbor_error_t push_container(cbor_stream_decoder_t *d,
 		cbor_item_data_t type, int64_t count)
 {
@@ -117,31 +412,36 @@ static cbor_error_t push_container(cbor_stream_decoder_t *d,
 		return CBOR_EXCESSIVE;
 	}
 
-	cbor_stream_event_t event;
-	cbor_stream_data_t  data = {0};
-	cbor_stream_event_type_t evtype = (type == CBOR_ITEM_ARRAY)
-		? CBOR_STREAM_EVENT_ARRAY_START : CBOR_STREAM_EVENT_MAP_START;
-
-	build_event(d, evtype, &event);
-	data.container.size = (type == CBOR_ITEM_MAP && count >= 0)
-		? (count / 2) : count;
+	uint32_t match = 0;
+	bool deliver = filter_item(d, &match);
+	cbor_error_t err;
 
 	/* clear pending tags before emitting START — tags were already
 	 * delivered as TAG events; this START is the "wrapped item" */
 	d->pending_tag_count = 0;
+	d->skip_next = false;
 
-	cbor_error_t err = invoke_cb(d, &event, &data);
-	if (err != CBOR_SUCCESS) {
-		return err;
+	if (deliver) {
+		cbor_stream_data_t *data = clear_data(d);
+
+		build_event(d, (type == CBOR_ITEM_ARRAY)
+				? CBOR_STREAM_EVENT_ARRAY_START
+				: CBOR_STREAM_EVENT_MAP_START);
+		data->container.size = (type == CBOR_ITEM_MAP && count >= 0)
+			? (count / 2) : count;
 	}
 
-	cbor_stream_frame_t *f = &d->stack[d->depth];
-	f->type   = type;
-	f->count  = count;
-	f->is_key = (type == CBOR_ITEM_MAP);
-	d->depth++;
+	/* pushed before the callback, so that it can skip the container */
+	cbor_stream_frame_t *f = push_frame(d, type, count, deliver, match);
 
-	if (count == 0) {
+	if (deliver) {
+		err = invoke_cb(d, &d->record.data);
+		if (err != CBOR_SUCCESS) {
+			return err;
+		}
+	}
+
+	if (count == 0 && !(d->pull && f->deliver)) {
 		err = emit_container_end(d);
 		if (err != CBOR_SUCCESS) {
 			return err;
@@ -152,11 +452,11 @@ static cbor_error_t push_container(cbor_stream_decoder_t *d,
 	return CBOR_SUCCESS;
 }
 
-static uint64_t decode_length_buf(const cbor_stream_decoder_t *d)
+static uint64_t decode_be(const uint8_t *buf, uint8_t n)
 {
 	uint64_t val = 0;
-	for (uint8_t i = 0; i < d->following_bytes; i++) {
-		val = (val << 8) | d->length_buf[i];
+	for (uint8_t i = 0; i < n; i++) {
+		val = (val << 8) | buf[i];
 	}
 	return val;
 }
@@ -166,16 +466,14 @@ static uint64_t get_item_value(const cbor_stream_decoder_t *d)
 	if (d->following_bytes == 0) {
 		return d->additional_info;
 	}
-	return decode_length_buf(d);
+	return d->argument;
 }
 
-static double decode_float_value(const cbor_stream_decoder_t *d)
+static double decode_float_value(uint8_t following_bytes, uint64_t raw)
 {
-	uint64_t raw = decode_length_buf(d);
-
-	if (d->following_bytes == 2) {
+	if (following_bytes == 2) {
 		return ieee754_convert_half_to_double((uint16_t)raw);
-	} else if (d->following_bytes == 4) {
+	} else if (following_bytes == 4) {
 		uint32_t u32 = (uint32_t)raw;
 		float f;
 		memcpy(&f, &u32, 4);
@@ -189,14 +487,21 @@ static double decode_float_value(const cbor_stream_decoder_t *d)
 
 static cbor_error_t emit_uint(cbor_stream_decoder_t *d)
 {
-	cbor_stream_event_t event;
-	cbor_stream_data_t  data = {0};
+	uint64_t val = get_item_value(d);
 
-	build_event(d, CBOR_STREAM_EVENT_UINT, &event);
-	data.uint = get_item_value(d);
 	d->pending_tag_count = 0;
 
-	cbor_error_t err = invoke_cb(d, &event, &data);
+	if (!wanted(d)) {
+		match_int_key(d, false, val);
+		return after_item(d);
+	}
+
+	cbor_stream_data_t *data = clear_data(d);
+
+	build_event(d, CBOR_STREAM_EVENT_UINT);
+	data->uint = val;
+
+	cbor_error_t err = invoke_cb(d, data);
 	if (err != CBOR_SUCCESS) {
 		return err;
 	}
@@ -205,19 +510,25 @@ static cbor_error_t emit_uint(cbor_stream_decoder_t *d)
 
 static cbor_error_t emit_int(cbor_stream_decoder_t *d)
 {
-	cbor_stream_event_t event;
-	cbor_stream_data_t  data = {0};
 	uint64_t raw = get_item_value(d);
 
 	if (!can_fit_int64(raw)) {
 		return CBOR_INVALID;
 	}
 
-	build_event(d, CBOR_STREAM_EVENT_INT, &event);
-	data.sint = -(int64_t)raw - 1;
 	d->pending_tag_count = 0;
 
-	cbor_error_t err = invoke_cb(d, &event, &data);
+	if (!wanted(d)) {
+		match_int_key(d, true, raw);
+		return after_item(d);
+	}
+
+	cbor_stream_data_t *data = clear_data(d);
+
+	build_event(d, CBOR_STREAM_EVENT_INT);
+	data->sint = -(int64_t)raw - 1;
+
+	cbor_error_t err = invoke_cb(d, data);
 	if (err != CBOR_SUCCESS) {
 		return err;
 	}
@@ -228,54 +539,59 @@ static cbor_error_t emit_str_chunk(cbor_stream_decoder_t *d,
 		cbor_stream_event_type_t type,
 		const uint8_t *ptr, size_t len, bool first, bool last)
 {
-	cbor_stream_event_t event;
-	cbor_stream_data_t  data = {0};
-
-	build_event(d, type, &event);
-	data.str.ptr   = ptr;
-	data.str.len   = len;
-	data.str.total = d->payload_total;
-	data.str.first = first;
-	data.str.last  = last;
-
 	/* clear pending tags on the first chunk — this is the wrapped item start */
 	if (first) {
 		d->pending_tag_count = 0;
 	}
 
-	return invoke_cb(d, &event, &data);
+	if (!d->str_deliver) {
+		match_str_key(d, ptr, len, first, last);
+		return CBOR_SUCCESS;
+	}
+
+	cbor_stream_data_t *data = clear_data(d);
+
+	build_event(d, type);
+	data->str.ptr   = ptr;
+	data->str.len   = len;
+	data->str.total = d->payload_total;
+	data->str.first = first;
+	data->str.last  = last;
+
+	return invoke_cb(d, data);
 }
 
-static cbor_error_t emit_simple(cbor_stream_decoder_t *d, uint8_t val)
+static cbor_stream_event_type_t set_simple(cbor_stream_data_t *data,
+		uint8_t val)
 {
-	cbor_stream_event_t event;
-	cbor_stream_data_t  data = {0};
-	cbor_error_t        err;
-
 	switch (val) {
-	case 20:
-		build_event(d, CBOR_STREAM_EVENT_BOOL, &event);
-		data.boolean = false;
-		break;
+	case 20: /* fall through */
 	case 21:
-		build_event(d, CBOR_STREAM_EVENT_BOOL, &event);
-		data.boolean = true;
-		break;
+		data->boolean = (val == 21);
+		return CBOR_STREAM_EVENT_BOOL;
 	case 22:
-		build_event(d, CBOR_STREAM_EVENT_NULL, &event);
-		break;
+		return CBOR_STREAM_EVENT_NULL;
 	case 23:
-		build_event(d, CBOR_STREAM_EVENT_UNDEFINED, &event);
-		break;
+		return CBOR_STREAM_EVENT_UNDEFINED;
 	default:
-		build_event(d, CBOR_STREAM_EVENT_SIMPLE, &event);
-		data.simple = val;
-		break;
+		data->simple = val;
+		return CBOR_STREAM_EVENT_SIMPLE;
 	}
+}
 
+static cbor_error_t emit_simple(cbor_stream_decoder_t *d, uint8_t val)
+{
 	d->pending_tag_count = 0;
 
-	err = invoke_cb(d, &event, &data);
+	if (!wanted(d)) {
+		return after_item(d);
+	}
+
+	cbor_stream_data_t *data = clear_data(d);
+
+	build_event(d, set_simple(data, val));
+
+	cbor_error_t err = invoke_cb(d, data);
 	if (err != CBOR_SUCCESS) {
 		return err;
 	}
@@ -284,14 +600,18 @@ static cbor_error_t emit_simple(cbor_stream_decoder_t *d, uint8_t val)
 
 static cbor_error_t emit_float(cbor_stream_decoder_t *d)
 {
-	cbor_stream_event_t event;
-	cbor_stream_data_t  data = {0};
-
-	build_event(d, CBOR_STREAM_EVENT_FLOAT, &event);
-	data.flt = decode_float_value(d);
 	d->pending_tag_count = 0;
 
-	cbor_error_t err = invoke_cb(d, &event, &data);
+	if (!wanted(d)) {
+		return after_item(d);
+	}
+
+	cbor_stream_data_t *data = clear_data(d);
+
+	build_event(d, CBOR_STREAM_EVENT_FLOAT);
+	data->flt = decode_float_value(d->following_bytes, d->argument);
+
+	cbor_error_t err = invoke_cb(d, data);
 	if (err != CBOR_SUCCESS) {
 		return err;
 	}
@@ -353,6 +673,7 @@ static cbor_error_t process_immediate(cbor_stream_decoder_t *d)
 		if (!d->in_indef_str) {
 			d->payload_total       = (int64_t)slen;
 			d->payload_first_chunk = true;
+			d->str_deliver         = wanted(d);
 		}
 
 		if (slen == 0) {
@@ -392,7 +713,7 @@ static cbor_error_t process_immediate(cbor_stream_decoder_t *d)
 
 static cbor_error_t process_string_length(cbor_stream_decoder_t *d)
 {
-	uint64_t len = decode_length_buf(d);
+	uint64_t len = d->argument;
 	cbor_stream_event_type_t type = (d->major_type == 2)
 		? CBOR_STREAM_EVENT_BYTES : CBOR_STREAM_EVENT_TEXT;
 
@@ -402,6 +723,7 @@ static cbor_error_t process_string_length(cbor_stream_decoder_t *d)
 			return CBOR_INVALID;
 		}
 		d->payload_total = (int64_t)len;
+		d->str_deliver   = wanted(d);
 	}
 
 	if (len == 0) {
@@ -430,7 +752,7 @@ static cbor_error_t process_string_length(cbor_stream_decoder_t *d)
 
 static cbor_error_t process_container_length(cbor_stream_decoder_t *d)
 {
-	uint64_t n = decode_length_buf(d);
+	uint64_t n = d->argument;
 	cbor_item_data_t type = (d->major_type == 4)
 		? CBOR_ITEM_ARRAY : CBOR_ITEM_MAP;
 	int64_t count;
@@ -452,7 +774,7 @@ static cbor_error_t process_container_length(cbor_stream_decoder_t *d)
 
 static cbor_error_t process_tag_length(cbor_stream_decoder_t *d)
 {
-	cbor_error_t err = emit_tag(d, decode_length_buf(d));
+	cbor_error_t err = emit_tag(d, d->argument);
 	d->state = STREAM_STATE_IDLE;
 	return err;
 }
@@ -461,7 +783,7 @@ static cbor_error_t process_float_simple_length(cbor_stream_decoder_t *d)
 {
 	if (d->following_bytes == 1) {
 		/* 1 following byte → simple value */
-		return emit_simple(d, d->length_buf[0]);
+		return emit_simple(d, (uint8_t)d->argument);
 	}
 	return emit_float(d);
 }
@@ -501,6 +823,7 @@ static cbor_error_t handle_indefinite(cbor_stream_decoder_t *d)
 		d->indef_str_major     = d->major_type;
 		d->payload_first_chunk = true;
 		d->payload_total       = -1;
+		d->str_deliver         = wanted(d);
 		d->state = STREAM_STATE_IDLE;
 		return CBOR_SUCCESS;
 
@@ -520,11 +843,13 @@ static cbor_error_t handle_indefinite(cbor_stream_decoder_t *d)
 
 static cbor_error_t process_initial_byte(cbor_stream_decoder_t *d, uint8_t b)
 {
+	const cbor_initial_byte_t *hdr = &cbor_initial_bytes[b];
+
 	d->major_type      = b >> 5;
 	d->additional_info = b & 0x1fu;
-	d->following_bytes = cbor_get_following_bytes(d->additional_info);
+	d->following_bytes = hdr->following_bytes;
 
-	if (d->following_bytes == (uint8_t)CBOR_RESERVED_VALUE) {
+	if (hdr->kind == CBOR_ITEM_UNKNOWN) {
 		return CBOR_ILLEGAL;
 	}
 
@@ -551,11 +876,23 @@ static cbor_error_t process_initial_byte(cbor_stream_decoder_t *d, uint8_t b)
 
 	/* need to read following_bytes bytes */
 	d->following_bytes_read = 0;
-	memset(d->length_buf, 0, sizeof(d->length_buf));
 	d->state = STREAM_STATE_LENGTH;
 	return CBOR_SUCCESS;
 }
 
+/* Decode the following bytes straight from the chunk when all of them are
+ * in it. Only a header straddling two chunks is collected byte by byte in
+ * STREAM_STATE_LENGTH. */
+static cbor_error_t process_whole_header(cbor_stream_decoder_t *d,
+		const uint8_t **p, size_t *remaining)
+{
+	d->argument = decode_be(*p, d->following_bytes);
+	*p         += d->following_bytes;
+	*remaining -= d->following_bytes;
+
+	return process_length_complete(d);
+}
+
 static cbor_error_t consume_payload(cbor_stream_decoder_t *d,
 		const uint8_t **p, size_t *remaining)
 {
@@ -570,7 +907,20 @@ static cbor_error_t consume_payload(cbor_stream_decoder_t *d,
 
 	cbor_stream_event_type_t type = (d->major_type == 2)
 		? CBOR_STREAM_EVENT_BYTES : CBOR_STREAM_EVENT_TEXT;
-	bool last = ((int64_t)avail == d->payload_remaining) && !d->in_indef_str;
+	bool ends = (int64_t)avail == d->payload_remaining;
+	bool last = ends && !d->in_indef_str;
+
+	if (type == CBOR_STREAM_EVENT_TEXT && d->validate_utf8 &&
+			d->str_deliver) {
+		size_t valid = cbor_utf8_validate(&d->utf8_state, *p, avail);
+
+		if (valid < avail ||
+				(ends && d->utf8_state != CBOR_UTF8_ACCEPT)) {
+			*p         += valid;
+			*remaining -= valid;
+			return CBOR_INVALID;
+		}
+	}
 
 	cbor_error_t err = emit_str_chunk(d, type, *p, avail,
 			d->payload_first_chunk, last);
@@ -597,6 +947,424 @@ static cbor_error_t consume_payload(cbor_stream_decoder_t *d,
 	return CBOR_SUCCESS;
 }
 
+/* Whether no path can match the item starting at the current depth: it is
+ * in a subtree none matches, or the value of a key none matches */
+static bool is_dead(const cbor_stream_decoder_t *d)
+{
+	if (d->depth == 0) {
+		return false;
+	}
+
+	const cbor_stream_frame_t *f = &d->stack[d->depth - 1];
+
+	if (f->deliver) {
+		return false;
+	}
+
+	return f->match == 0 || (f->type == CBOR_ITEM_MAP && !f->is_key &&
+			f->key_match == 0);
+}
+
+/* Run through the item at @p p without an event, as no path can match it, it
+ * is skipped or it is a key to match. @p size is set to the bytes it takes,
+ * or to 0 to leave it to the regular state machine: indefinite-length items,
+ * items not whole in the chunk, and anything that is an error. */
+static cbor_error_t skip_item(cbor_stream_decoder_t *d,
+		const uint8_t *p, size_t remaining, bool key, size_t *size)
+{
+	uint8_t major = p[0] >> 5;
+	uint8_t n = cbor_initial_bytes[p[0]].following_bytes;
+
+	*size = 0;
+
+	if (n > 8 || n >= remaining ||
+			cbor_initial_bytes[p[0]].kind == CBOR_ITEM_UNKNOWN) {
+		return CBOR_SUCCESS;
+	}
+
+	uint64_t arg = (n == 0)? (uint64_t)(p[0] & 0x1fu) : decode_be(&p[1], n);
+	size_t len = 1u + n;
+
+	switch (major) {
+	case 0: /* fall through */
+	case 1:
+		if (major == 1 && !can_fit_int64(arg)) {
+			return CBOR_SUCCESS;
+		}
+		if (key) {
+			match_int_key(d, major == 1, arg);
+		}
+		break;
+	case 2: /* fall through */
+	case 3:
+		if (arg > remaining - len) {
+			return CBOR_SUCCESS;
+		}
+		if (key) {
+			match_str_key(d, &p[len], (size_t)arg, true, true);
+		}
+		len += (size_t)arg;
+		break;
+	case 4: /* fall through */
+	case 5:
+		if (arg > (uint64_t)(INT64_MAX / 2) ||
+				d->depth >= CBOR_RECURSION_MAX_LEVEL) {
+			return CBOR_SUCCESS;
+		}
+		if (arg > 0) {
+			push_frame(d, (major == 4)? CBOR_ITEM_ARRAY : CBOR_ITEM_MAP,
+					(int64_t)((major == 4)? arg : arg * 2u),
+					false, 0);
+			d->pending_tag_count = 0;
+			*size = len;
+			return CBOR_SUCCESS;
+		}
+		break;
+	case 6:
+		if (d->pending_tag_count >= CBOR_STREAM_MAX_PENDING_TAGS) {
+			return CBOR_SUCCESS;
+		}
+		d->pending_tag_count++;
+		*size = len;
+		return CBOR_SUCCESS;
+	default:
+		break;
+	}
+
+	/* it may close a skipped container, whose parent is delivered */
+	d->pending_tag_count = 0;
+	*size = len;
+	return after_item(d);
+}
+
+static cbor_error_t skip_unmatched(cbor_stream_decoder_t *d,
+		const uint8_t **pos, size_t *len)
+{
+	cbor_error_t err = CBOR_SUCCESS;
+
+	/* chunks of an indefinite-length string are not items of their own */
+	while (*len > 0 && !d->in_indef_str && !d->pulled &&
+			err == CBOR_SUCCESS) {
+		bool key = get_key_frame(d) != NULL;
+		size_t size;
+
+		if (!key && !is_dead(d)) {
+			break;
+		}
+
+		err = skip_item(d, *pos, *len, key, &size);
+
+		if (size == 0) {
+			break;
+		}
+
+		*pos += size;
+		*len -= size;
+	}
+
+	return err;
+}
+
+/* Whether every item goes to the callback as it comes: no paths to match,
+ * nothing being skipped, and neither pull nor batch mode */
+static bool is_unfiltered(const cbor_stream_decoder_t *d)
+{
+	return d->callback != NULL && d->nr_paths == 0 && !d->skip_next &&
+		!d->in_indef_str &&
+		(d->depth == 0 || d->stack[d->depth - 1].deliver);
+}
+
+/* Deliver the item at @p p to the callback in one go. @p size is set to the
+ * bytes it takes, or to 0 to leave it to the regular state machine as
+ * skip_item() does. */
+static cbor_error_t deliver_item(cbor_stream_decoder_t *d,
+		const uint8_t *p, size_t remaining, size_t *size,
+		cbor_stream_action_t *action)
+{
+	uint8_t major = p[0] >> 5;
+	uint8_t n = cbor_initial_bytes[p[0]].following_bytes;
+
+	*size = 0;
+
+	if (n > 8 || n >= remaining ||
+			cbor_initial_bytes[p[0]].kind == CBOR_ITEM_UNKNOWN) {
+		return CBOR_SUCCESS;
+	}
+
+	uint64_t arg = (n == 0)? (uint64_t)(p[0] & 0x1fu) : decode_be(&p[1], n);
+	size_t len = 1u + n;
+	cbor_stream_data_t *data = clear_data(d);
+	cbor_stream_event_type_t type;
+	uint8_t utf8 = CBOR_UTF8_ACCEPT;
+
+	switch (major) {
+	case 0:
+		type = CBOR_STREAM_EVENT_UINT;
+		data->uint = arg;
+		break;
+	case 1:
+		if (!can_fit_int64(arg)) {
+			return CBOR_SUCCESS;
+		}
+		type = CBOR_STREAM_EVENT_INT;
+		data->sint = -(int64_t)arg - 1;
+		break;
+	case 2: /* fall through */
+	case 3:
+		if (arg > remaining - len || (major == 3 && d->validate_utf8 &&
+				(cbor_utf8_validate(&utf8, &p[len], (size_t)arg)
+					< arg || utf8 != CBOR_UTF8_ACCEPT))) {
+			return CBOR_SUCCESS;
+		}
+		type = (major == 2)?
+			CBOR_STREAM_EVENT_BYTES : CBOR_STREAM_EVENT_TEXT;
+		data->str.ptr   = (arg > 0)? &p[len] : NULL;
+		data->str.len   = (size_t)arg;
+		data->str.total = (int64_t)arg;
+		data->str.first = true;
+		data->str.last  = true;
+		len += (size_t)arg;
+		break;
+	case 4: /* fall through */
+	case 5:
+		if (arg > (uint64_t)(INT64_MAX / 2) ||
+				d->depth >= CBOR_RECURSION_MAX_LEVEL) {
+			return CBOR_SUCCESS;
+		}
+		type = (major == 4)?
+			CBOR_STREAM_EVENT_ARRAY_START : CBOR_STREAM_EVENT_MAP_START;
+		data->container.size = (int64_t)arg;
+		break;
+	case 6:
+		if (d->pending_tag_count >= CBOR_STREAM_MAX_PENDING_TAGS) {
+			return CBOR_SUCCESS;
+		}
+		type = CBOR_STREAM_EVENT_TAG;
+		data->tag = arg;
+		break;
+	default:
+		if (n > 1) {
+			type = CBOR_STREAM_EVENT_FLOAT;
+			data->flt = decode_float_value(n, arg);
+		} else {
+			type = set_simple(data, (uint8_t)arg);
+		}
+		break;
+	}
+
+	build_event(d, type);
+	*size = len;
+
+	if (major == 4 || major == 5) {
+		push_frame(d, (major == 4)? CBOR_ITEM_ARRAY : CBOR_ITEM_MAP,
+				(int64_t)((major == 4)? arg : arg * 2u), true, 0);
+	}
+
+	*action = d->callback(&d->record.event, data, d->callback_arg);
+
+	if (*action != CBOR_STREAM_CONTINUE) {
+		cbor_error_t err = act_on(d, *action);
+		if (err != CBOR_SUCCESS) {
+			return err;
+		}
+	}
+
+	if (major == 6) {
+		d->pending_tag_count++;
+		return CBOR_SUCCESS;
+	}
+
+	d->pending_tag_count = 0;
+
+	if ((major == 4 || major == 5) && arg > 0) {
+		return CBOR_SUCCESS;
+	}
+	if (major == 4 || major == 5) {
+		cbor_error_t err = emit_container_end(d);
+		if (err != CBOR_SUCCESS) {
+			return err;
+		}
+	}
+	return count_item(d);
+}
+
+/* Deliver whole items with no test for paths, skipping, pull or batch mode
+ * on the way, until one is left to the state machine or the callback skips
+ * one */
+static cbor_error_t decode_unfiltered(cbor_stream_decoder_t *d,
+		const uint8_t **pos, size_t *len)
+{
+	cbor_stream_action_t action = CBOR_STREAM_CONTINUE;
+	cbor_error_t err = CBOR_SUCCESS;
+
+	while (*len > 0 && err == CBOR_SUCCESS &&
+			action == CBOR_STREAM_CONTINUE) {
+		size_t size;
+
+		err = deliver_item(d, *pos, *len, &size, &action);
+
+		if (size == 0) {
+			break;
+		}
+
+		*pos += size;
+		*len -= size;
+	}
+
+	return err;
+}
+
+/* Decode the integers of a delivered container straight into the batch, as
+ * they are most of an integer-heavy stream. Anything else, and an integer
+ * not whole in the chunk, is left to the regular state machine. */
+static cbor_error_t batch_integers(cbor_stream_decoder_t *d,
+		const uint8_t **pos, size_t *len)
+{
+	static const cbor_stream_data_t zero = { 0 };
+	cbor_error_t err = CBOR_SUCCESS;
+
+	while (*len > 0 && err == CBOR_SUCCESS && d->depth > 0) {
+		const cbor_stream_frame_t *f = &d->stack[d->depth - 1];
+		const uint8_t *p = *pos;
+		uint8_t major = p[0] >> 5;
+		uint8_t n = cbor_initial_bytes[p[0]].following_bytes;
+
+		if (major > 1 || n > 8 || n >= *len || !f->deliver) {
+			break;
+		}
+
+		uint64_t arg = (n == 0)?
+			(uint64_t)(p[0] & 0x1fu) : decode_be(&p[1], n);
+
+		if (major == 1 && !can_fit_int64(arg)) {
+			break;
+		}
+
+		cbor_stream_record_t *r = &d->batch[d->batch_len];
+
+		r->event.type = (major == 0)?
+			CBOR_STREAM_EVENT_UINT : CBOR_STREAM_EVENT_INT;
+		r->event.depth = d->depth;
+		r->event.is_map_key = f->type == CBOR_ITEM_MAP && f->is_key;
+		r->event.parser = d->parser;
+		r->data = zero;
+		if (major == 0) {
+			r->data.uint = arg;
+		} else {
+			r->data.sint = -(int64_t)arg - 1;
+		}
+
+		*pos += 1u + n;
+		*len -= 1u + n;
+		d->pending_tag_count = 0;
+
+		err = add_to_batch(d);
+		if (err == CBOR_SUCCESS) {
+			err = after_item(d);
+		}
+	}
+
+	return err;
+}
+
+/* Decode until the bytes run out, or until one event is taken in pull mode
+ * or put in the batch. Containers closed by that event are left to
+ * cbor_stream_next(), so a pull never makes more than one. */
+static cbor_error_t decode(cbor_stream_decoder_t *d,
+		const uint8_t **pos, size_t *len)
+{
+	const uint8_t *p         = *pos;
+	size_t         remaining = *len;
+	cbor_error_t   err       = CBOR_SUCCESS;
+
+	while (remaining > 0) {
+		switch (d->state) {
+		case STREAM_STATE_IDLE:
+			if (is_unfiltered(d)) {
+				const uint8_t *start = p;
+
+				err = decode_unfiltered(d, &p, &remaining);
+				if (err != CBOR_SUCCESS || p != start) {
+					break;
+				}
+			} else if (d->depth > 0 &&
+					!d->stack[d->depth - 1].deliver) {
+				err = skip_unmatched(d, &p, &remaining);
+				if (err != CBOR_SUCCESS || remaining == 0 ||
+						d->pulled) {
+					break;
+				}
+			}
+			err = process_initial_byte(d, *p);
+			p++;
+			remaining--;
+			if (err == CBOR_SUCCESS &&
+					d->state == STREAM_STATE_LENGTH &&
+					remaining >= d->following_bytes) {
+				err = process_whole_header(d, &p, &remaining);
+			}
+			break;
+
+		case STREAM_STATE_LENGTH:
+			d->length_buf[d->following_bytes_read++] = *p;
+			p++;
+			remaining--;
+			if (d->following_bytes_read == d->following_bytes) {
+				d->argument = decode_be(d->length_buf,
+						d->following_bytes);
+				err = process_length_complete(d);
+			}
+			break;
+
+		case STREAM_STATE_PAYLOAD:
+			err = consume_payload(d, &p, &remaining);
+			break;
+
+		case STREAM_STATE_ERROR:
+			err = d->error;
+			break;
+		default:
+			err = CBOR_ILLEGAL;
+			break;
+		}
+
+		if (err != CBOR_SUCCESS || d->pulled) {
+			break;
+		}
+	}
+
+	*pos = p;
+	*len = remaining;
+	return err;
+}
+
+/* Decode an event at a time, so that the integers in between go straight
+ * into the batch */
+static cbor_error_t decode_batch(cbor_stream_decoder_t *d,
+		const uint8_t **pos, size_t *len)
+{
+	cbor_error_t err = CBOR_SUCCESS;
+
+	while (*len > 0 && err == CBOR_SUCCESS) {
+		if (d->state == STREAM_STATE_IDLE && !d->in_indef_str) {
+			err = batch_integers(d, pos, len);
+		}
+
+		d->pulled = false;
+
+		if (err == CBOR_SUCCESS && *len > 0) {
+			err = decode(d, pos, len);
+		}
+	}
+
+	return err;
+}
+
+static bool has_closed_container(const cbor_stream_decoder_t *d)
+{
+	return d->depth > 0 && d->stack[d->depth - 1].count == 0;
+}
+
 void cbor_stream_init(cbor_stream_decoder_t *decoder,
 		cbor_stream_callback_t callback, void *arg)
 {
@@ -612,10 +1380,70 @@ void cbor_stream_init(cbor_stream_decoder_t *decoder,
 	decoder->state        = STREAM_STATE_IDLE;
 }
 
+void cbor_stream_init_pull(cbor_stream_decoder_t *decoder)
+{
+	assert(decoder != NULL);
+
+	if (decoder == NULL) {
+		return;
+	}
+
+	cbor_stream_init(decoder, NULL, NULL);
+	decoder->pull = true;
+}
+
+void cbor_stream_init_batch(cbor_stream_decoder_t *decoder,
+		cbor_stream_record_t *records, size_t nr_records,
+		cbor_stream_batch_callback_t callback, void *arg)
+{
+	assert(decoder != NULL);
+
+	if (decoder == NULL) {
+		return;
+	}
+
+	cbor_stream_init(decoder, NULL, arg);
+
+	if (records != NULL && nr_records > 0 && callback != NULL) {
+		decoder->batch          = records;
+		decoder->batch_cap      = nr_records;
+		decoder->batch_callback = callback;
+	}
+}
+
+cbor_error_t cbor_stream_set_paths(cbor_stream_decoder_t *decoder,
+		const struct cbor_parser *parsers, size_t nr_parsers)
+{
+	if (decoder == NULL || (parsers == NULL && nr_parsers > 0)) {
+		return CBOR_INVALID;
+	}
+	if (nr_parsers > CBOR_STREAM_MAX_PATHS) {
+		return CBOR_EXCESSIVE;
+	}
+
+	decoder->paths    = parsers;
+	decoder->nr_paths = (uint8_t)nr_parsers;
+
+	return CBOR_SUCCESS;
+}
+
+void cbor_stream_set_utf8_validation(cbor_stream_decoder_t *decoder,
+		bool enable)
+{
+	assert(decoder != NULL);
+
+	if (decoder == NULL) {
+		return;
+	}
+
+	decoder->validate_utf8 = enable;
+}
+
 cbor_error_t cbor_stream_feed(cbor_stream_decoder_t *decoder,
 		const void *data, size_t len)
 {
-	if (decoder == NULL || decoder->callback == NULL) {
+	if (decoder == NULL || (decoder->callback == NULL &&
+			!decoder->pull && decoder->batch == NULL)) {
 		return CBOR_INVALID;
 	}
 
@@ -627,43 +1455,104 @@ cbor_error_t cbor_stream_feed(cbor_stream_decoder_t *decoder,
 		return decoder->error;
 	}
 
+	if (decoder->pull) {
+		if (decoder->input_len > 0) {
+			return CBOR_INVALID;
+		}
+		decoder->input     = (const uint8_t *)data;
+		decoder->input_len = len;
+		return CBOR_SUCCESS;
+	}
+
 	const uint8_t *p         = (const uint8_t *)data;
-	size_t         remaining  = len;
-	cbor_error_t   err        = CBOR_SUCCESS;
+	size_t         remaining = len;
+	cbor_error_t   err;
 
-	while (remaining > 0) {
-		switch (decoder->state) {
-		case STREAM_STATE_IDLE:
-			err = process_initial_byte(decoder, *p);
-			p++;
-			remaining--;
-			break;
+	if (decoder->batch == NULL) {
+		err = decode(decoder, &p, &remaining);
+	} else {
+		err = decode_batch(decoder, &p, &remaining);
 
-		case STREAM_STATE_LENGTH:
-			decoder->length_buf[decoder->following_bytes_read++] = *p;
-			p++;
-			remaining--;
-			if (decoder->following_bytes_read == decoder->following_bytes) {
-				err = process_length_complete(decoder);
+		/* strings point into this chunk, so the batch can not wait */
+		if (err != CBOR_ABORTED) {
+			cbor_error_t flushed = flush_batch(decoder);
+
+			if (err == CBOR_SUCCESS) {
+				err = flushed;
 			}
-			break;
+		}
+	}
 
-		case STREAM_STATE_PAYLOAD:
-			err = consume_payload(decoder, &p, &remaining);
-			break;
+	if (err != CBOR_SUCCESS) {
+		decoder->error = err;
+		decoder->state = STREAM_STATE_ERROR;
+		decoder->offset += (size_t)(p - (const uint8_t *)data);
+		return err;
+	}
 
-		case STREAM_STATE_ERROR:
-			return decoder->error;
-		default:
-			return CBOR_ILLEGAL;
-		}
+	decoder->offset += len;
 
-		if (err != CBOR_SUCCESS) {
-			decoder->error = err;
-			decoder->state = STREAM_STATE_ERROR;
-			return err;
+	return CBOR_SUCCESS;
+}
+
+cbor_error_t cbor_stream_next(cbor_stream_decoder_t *decoder,
+		const cbor_stream_event_t **event, const cbor_stream_data_t **data)
+{
+	if (decoder == NULL || !decoder->pull ||
+			event == NULL || data == NULL) {
+		return CBOR_INVALID;
+	}
+
+	if (decoder->state == STREAM_STATE_ERROR) {
+		return decoder->error;
+	}
+
+	cbor_error_t err = CBOR_SUCCESS;
+
+	decoder->pulled = false;
+
+	/* a container skipped after its START closes with no event */
+	if (has_closed_container(decoder)) {
+		err = emit_container_end(decoder);
+		if (err == CBOR_SUCCESS) {
+			err = after_item(decoder);
 		}
 	}
+	if (err == CBOR_SUCCESS && !decoder->pulled) {
+		const uint8_t *p = decoder->input;
+
+		err = decode(decoder, &p, &decoder->input_len);
+		decoder->offset += (size_t)(p - decoder->input);
+		decoder->input   = p;
+	}
+
+	if (err != CBOR_SUCCESS) {
+		decoder->error = err;
+		decoder->state = STREAM_STATE_ERROR;
+		return err;
+	}
+
+	if (!decoder->pulled) {
+		return CBOR_NEED_MORE;
+	}
+
+	*event = &decoder->record.event;
+	*data  = (decoder->record.event.type == CBOR_STREAM_EVENT_ARRAY_END ||
+			decoder->record.event.type == CBOR_STREAM_EVENT_MAP_END)
+		? NULL : &decoder->record.data;
+
+	return CBOR_SUCCESS;
+}
+
+cbor_error_t cbor_stream_skip(cbor_stream_decoder_t *decoder)
+{
+	if (decoder == NULL || !decoder->pull) {
+		return CBOR_INVALID;
+	}
+
+	if (decoder->pulled) {
+		skip_rest(decoder);
+	}
 
 	return CBOR_SUCCESS;
 }
@@ -681,7 +1570,8 @@ cbor_error_t cbor_stream_finish(cbor_stream_decoder_t *decoder)
 	if (decoder->state != STREAM_STATE_IDLE || decoder->depth > 0 ||
 			decoder->in_indef_str ||
 			decoder->following_bytes_read > 0 ||
-			decoder->pending_tag_count > 0) {
+			decoder->pending_tag_count > 0 ||
+			decoder->input_len > 0) {
 		return CBOR_NEED_MORE;
 	}
 
@@ -698,8 +1588,22 @@ void cbor_stream_reset(cbor_stream_decoder_t *decoder)
 
 	cbor_stream_callback_t cb  = decoder->callback;
 	void                  *arg = decoder->callback_arg;
+	bool                   utf8 = decoder->validate_utf8;
+	bool                   pull = decoder->pull;
+	const struct cbor_parser *paths = decoder->paths;
+	uint8_t                nr_paths = decoder->nr_paths;
+	cbor_stream_record_t  *batch = decoder->batch;
+	size_t                 batch_cap = decoder->batch_cap;
+	cbor_stream_batch_callback_t batch_cb = decoder->batch_callback;
 	memset(decoder, 0, sizeof(*decoder));
-	decoder->callback     = cb;
-	decoder->callback_arg = arg;
+	decoder->callback      = cb;
+	decoder->callback_arg  = arg;
+	decoder->validate_utf8 = utf8;
+	decoder->pull          = pull;
+	decoder->paths         = paths;
+	decoder->nr_paths      = nr_paths;
+	decoder->batch         = batch;
+	decoder->batch_cap     = batch_cap;
+	decoder->batch_callback = batch_cb;
 	decoder->state        = STREAM_STATE_IDLE;
 }
@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Kyunghwan Kwon <k@mononn.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "cbor/utf8.h"
+#include <string.h>
+
+/* States 1 to 3 wait for that many continuation bytes in 0x80..0xBF. The
+ * others wait for the second byte of a sequence whose range is narrowed to
+ * rule out overlong forms, surrogates and code points above U+10FFFF. */
+enum {
+	UTF8_TAIL1 = 1,
+	UTF8_TAIL2,
+	UTF8_TAIL3,
+	UTF8_E0, /* 0xA0..0xBF, then one more */
+	UTF8_ED, /* 0x80..0x9F, then one more */
+	UTF8_F0, /* 0x90..0xBF, then two more */
+	UTF8_F4, /* 0x80..0x8F, then two more */
+	UTF8_REJECT,
+};
+
+#define ASCII_MASK				((size_t)-1 / 0xffu * 0x80u)
+
+static uint8_t get_lead_state(uint8_t c)
+{
+	if (c < 0x80) {
+		return CBOR_UTF8_ACCEPT;
+	} else if (c < 0xc2) {
+		return UTF8_REJECT;
+	} else if (c < 0xe0) {
+		return UTF8_TAIL1;
+	} else if (c == 0xe0) {
+		return UTF8_E0;
+	} else if (c == 0xed) {
+		return UTF8_ED;
+	} else if (c < 0xf0) {
+		return UTF8_TAIL2;
+	} else if (c == 0xf0) {
+		return UTF8_F0;
+	} else if (c < 0xf4) {
+		return UTF8_TAIL3;
+	} else if (c == 0xf4) {
+		return UTF8_F4;
+	}
+
+	return UTF8_REJECT;
+}
+
+static uint8_t step(uint8_t state, uint8_t c)
+{
+	switch (state) {
+	case CBOR_UTF8_ACCEPT:
+		return get_lead_state(c);
+	case UTF8_TAIL1: /* fall through */
+	case UTF8_TAIL2: /* fall through */
+	case UTF8_TAIL3:
+		return (c & 0xc0u) == 0x80u? (uint8_t)(state - 1) : UTF8_REJECT;
+	case UTF8_E0:
+		return (c >= 0xa0 && c <= 0xbf)? UTF8_TAIL1 : UTF8_REJECT;
+	case UTF8_ED:
+		return (c >= 0x80 && c <= 0x9f)? UTF8_TAIL1 : UTF8_REJECT;
+	case UTF8_F0:
+		return (c >= 0x90 && c <= 0xbf)? UTF8_TAIL2 : UTF8_REJECT;
+	case UTF8_F4:
+		return (c >= 0x80 && c <= 0x8f)? UTF8_TAIL2 : UTF8_REJECT;
+	default:
+		return UTF8_REJECT;
+	}
+}
+
+size_t cbor_utf8_validate(uint8_t *state, uint8_t const *s, size_t len)
+{
+	uint8_t st = *state;
+	size_t i = 0;
+
+	while (i < len) {
+		/* Skip ASCII a word at a time between code points. */
+		if (st == CBOR_UTF8_ACCEPT) {
+			size_t word;
+
+			while (len - i >= sizeof(word)) {
+				memcpy(&word, &s[i], sizeof(word));
+				if (word & ASCII_MASK) {
+					break;
+				}
+				i += sizeof(word);
+			}
+			if (i == len) {
+				break;
+			}
+		}
+
+		uint8_t next = step(st, s[i]);
+
+		if (next == UTF8_REJECT) {
+			break;
+		}
+
+		st = next;
+		i++;
+	}
+
+	*state = st;
+	return i;
+}
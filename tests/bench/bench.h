@@ -0,0 +1,27 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Kyunghwan Kwon <k@mononn.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CBOR_BENCH_H
+#define CBOR_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BENCH_MIN_NS				200000000ull /* 0.2 s per case */
+
+uint64_t bench_now_ns(void);
+/* Print a result line; @p count units of work were done in @p ns. */
+void bench_report(const char *name, const char *unit, uint64_t count,
+		uint64_t ns);
+
+void bench_parser(void);
+void bench_decoder(void);
+void bench_encoder(void);
+void bench_utf8(void);
+void bench_sequence(void);
+void bench_stream(void);
+
+#endif /* CBOR_BENCH_H */
@@ -0,0 +1,36 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Kyunghwan Kwon <k@mononn.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "bench.h"
+#include <stdio.h>
+#include <time.h>
+
+uint64_t bench_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void bench_report(const char *name, const char *unit, uint64_t count,
+		uint64_t ns)
+{
+	double secs = (double)ns / 1e9;
+	printf("%-32s %12.2f M%s/s\n", name, (double)count / secs / 1e6, unit);
+}
+
+int main(void)
+{
+	bench_parser();
+	bench_decoder();
+	bench_encoder();
+	bench_utf8();
+	bench_sequence();
+	bench_stream();
+	return 0;
+}
@@ -0,0 +1,243 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Kyunghwan Kwon <k@mononn.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "cbor/cbor.h"
+#include "cbor/ieee754.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NR_VALUES				1000
+
+static uint8_t msg[NR_VALUES * 9 + 8];
+static cbor_item_t items[NR_VALUES + 1];
+
+/* An array of integers of every width, both signs, and doubles */
+static size_t make_payload(uint8_t *buf, size_t bufsize)
+{
+	static const int64_t ints[] = {
+		7, -7, 100, -100, 1000, -1000, 100000, -100000,
+		10000000000, -10000000000,
+	};
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, buf, bufsize);
+	cbor_encode_array(&writer, NR_VALUES);
+
+	for (int i = 0; i < NR_VALUES; i++) {
+		int64_t v = ints[i % 10];
+
+		if (i % 5 == 4) {
+			cbor_encode_double(&writer, (double)i + 0.1);
+		} else if (v < 0) {
+			cbor_encode_negative_integer(&writer, v);
+		} else {
+			cbor_encode_unsigned_integer(&writer, (uint64_t)v);
+		}
+	}
+
+	return cbor_writer_len(&writer);
+}
+
+static double sum_generic(const cbor_reader_t *reader)
+{
+	double sum = 0;
+
+	for (size_t i = 1; i <= NR_VALUES; i++) {
+		if (cbor_get_item_type(&items[i]) == CBOR_ITEM_FLOAT) {
+			double d;
+			cbor_decode(reader, &items[i], &d, sizeof(d));
+			sum += d;
+		} else {
+			int64_t v;
+			cbor_decode(reader, &items[i], &v, sizeof(v));
+			sum += (double)v;
+		}
+	}
+
+	return sum;
+}
+
+static double sum_typed(const cbor_reader_t *reader)
+{
+	double sum = 0;
+
+	for (size_t i = 1; i <= NR_VALUES; i++) {
+		int64_t v;
+		double d;
+
+		if (cbor_decode_i64(reader, &items[i], &v) == CBOR_SUCCESS) {
+			sum += (double)v;
+		} else if (cbor_decode_double(reader, &items[i], &d)
+				== CBOR_SUCCESS) {
+			sum += d;
+		}
+	}
+
+	return sum;
+}
+
+static void run(const char *name, double (*fn)(const cbor_reader_t *),
+		const cbor_reader_t *reader, double expected)
+{
+	uint64_t count = 0;
+	uint64_t start = bench_now_ns();
+	uint64_t elapsed;
+
+	do {
+		if (fn(reader) != expected) {
+			fprintf(stderr, "%s: wrong sum\n", name);
+			exit(1);
+		}
+		count += NR_VALUES;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report(name, "values", count, elapsed);
+}
+
+static void bench_half(void)
+{
+	volatile double sink = 0;
+	uint64_t count = 0;
+	uint64_t start = bench_now_ns();
+	uint64_t elapsed;
+
+	do {
+		double sum = 0;
+
+		/* normal values, as found in sensor data */
+		for (uint32_t i = 0x0400; i < 0x7c00; i++) {
+			sum += ieee754_convert_half_to_double((uint16_t)i);
+		}
+		sink = sum;
+		count += 0x7c00 - 0x0400;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	(void)sink;
+	bench_report("half to double", "values", count, elapsed);
+}
+
+static void bench_array(void)
+{
+	static uint32_t out[NR_VALUES];
+	cbor_reader_t reader;
+	cbor_writer_t writer;
+	uint64_t count = 0;
+	uint64_t start;
+	uint64_t elapsed;
+
+	cbor_writer_init(&writer, msg, sizeof(msg));
+	cbor_encode_array(&writer, NR_VALUES);
+	for (uint32_t i = 0; i < NR_VALUES; i++) {
+		cbor_encode_unsigned_integer(&writer, 1000 + i);
+	}
+
+	cbor_reader_init(&reader, items, sizeof(items) / sizeof(*items));
+	cbor_parse(&reader, msg, cbor_writer_len(&writer), NULL);
+
+	start = bench_now_ns();
+	do {
+		for (size_t i = 0; i < NR_VALUES; i++) {
+			cbor_decode(&reader, &items[i + 1], &out[i],
+					sizeof(out[i]));
+		}
+		count += NR_VALUES;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report("cbor_decode u32 array", "values", count, elapsed);
+
+	count = 0;
+	start = bench_now_ns();
+	do {
+		size_t n;
+		if (cbor_decode_array_u32(&reader, &items[0], out, NR_VALUES,
+					&n) != CBOR_SUCCESS || out[7] != 1007) {
+			fprintf(stderr, "array decode failed\n");
+			exit(1);
+		}
+		count += n;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report("cbor_decode_array_u32", "values", count, elapsed);
+}
+
+/* Small values of both signs: the same width, but not the same initial
+ * byte, and a wider value now and then breaking the runs */
+static void bench_array_mixed(void)
+{
+	static int64_t out[NR_VALUES];
+	cbor_reader_t reader;
+	cbor_writer_t writer;
+	uint64_t count = 0;
+	uint64_t start;
+	uint64_t elapsed;
+
+	cbor_writer_init(&writer, msg, sizeof(msg));
+	cbor_encode_array(&writer, NR_VALUES);
+	for (int i = 0; i < NR_VALUES; i++) {
+		int64_t v = (i % 50 == 49)? 1000 + i : i % 24;
+		if (i % 2) {
+			cbor_encode_negative_integer(&writer, -1 - v);
+		} else {
+			cbor_encode_unsigned_integer(&writer, (uint64_t)v);
+		}
+	}
+
+	cbor_reader_init(&reader, items, sizeof(items) / sizeof(*items));
+	cbor_parse(&reader, msg, cbor_writer_len(&writer), NULL);
+
+	start = bench_now_ns();
+	do {
+		for (size_t i = 0; i < NR_VALUES; i++) {
+			cbor_decode_i64(&reader, &items[i + 1], &out[i]);
+		}
+		count += NR_VALUES;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report("cbor_decode_i64 mixed array", "values", count, elapsed);
+
+	count = 0;
+	start = bench_now_ns();
+	do {
+		size_t n;
+		if (cbor_decode_array_i64(&reader, &items[0], out, NR_VALUES,
+					&n) != CBOR_SUCCESS || out[7] != -8 ||
+				out[49] != -1050) {
+			fprintf(stderr, "array decode failed\n");
+			exit(1);
+		}
+		count += n;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report("cbor_decode_array_i64 mixed", "values", count, elapsed);
+}
+
+void bench_decoder(void)
+{
+	cbor_reader_t reader;
+	size_t len = make_payload(msg, sizeof(msg));
+
+	cbor_reader_init(&reader, items, sizeof(items) / sizeof(*items));
+	if (cbor_parse(&reader, msg, len, NULL) != CBOR_SUCCESS) {
+		fprintf(stderr, "parse failed\n");
+		exit(1);
+	}
+
+	double expected = sum_generic(&reader);
+
+	run("cbor_decode numbers", sum_generic, &reader, expected);
+	run("cbor_decode_i64/double numbers", sum_typed, &reader, expected);
+	bench_half();
+	bench_array();
+	bench_array_mixed();
+}
@@ -0,0 +1,319 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Kyunghwan Kwon <k@mononn.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "cbor/cbor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NR_RECORDS				500
+#define INITIAL_BUFSIZE				256
+#define NR_SAMPLES				10000
+
+#define MAX_ENTRIES				10000
+
+static double samples[NR_SAMPLES];
+static float fsamples[NR_SAMPLES];
+static uint8_t sample_buf[NR_SAMPLES * 9 + 9];
+
+/* {key: n} with MAX_ENTRIES keys "key" followed by a scrambled number */
+static char keys[MAX_ENTRIES][16];
+static uint8_t map_buf[MAX_ENTRIES * 24];
+#if defined(CBOR_WRITER_SORTED)
+static size_t scratch[MAX_ENTRIES * 3 + sizeof(map_buf) / sizeof(size_t)];
+#endif
+static size_t nr_entries;
+
+/* A document of NR_RECORDS {"id": n, "name": "sensor", "value": 1.5} */
+static cbor_error_t encode_document(cbor_writer_t *writer)
+{
+	cbor_error_t err = cbor_encode_array(writer, NR_RECORDS);
+
+	for (int i = 0; i < NR_RECORDS && err == CBOR_SUCCESS; i++) {
+		cbor_encode_map(writer, 3);
+		cbor_encode_text_string(writer, "id", 2);
+		cbor_encode_unsigned_integer(writer, (uint64_t)i);
+		cbor_encode_text_string(writer, "name", 4);
+		cbor_encode_text_string(writer, "sensor", 6);
+		cbor_encode_text_string(writer, "value", 5);
+		err = cbor_encode_double(writer, 1.5 * i);
+	}
+
+	return err;
+}
+
+/* Retry with a twice as large buffer until the document fits. */
+static size_t encode_with_retries(void)
+{
+	size_t bufsize = INITIAL_BUFSIZE;
+
+	for (;;) {
+		cbor_writer_t writer;
+		void *buf = malloc(bufsize);
+
+		cbor_writer_init(&writer, buf, bufsize);
+		if (encode_document(&writer) == CBOR_SUCCESS) {
+			size_t len = cbor_writer_len(&writer);
+			free(buf);
+			return len;
+		}
+
+		free(buf);
+		bufsize *= 2;
+	}
+}
+
+#if defined(CBOR_WRITER_GROW)
+static void *grow_with_realloc(void *buf, size_t used, size_t newsize,
+		void *arg)
+{
+	(void)used;
+	(void)arg;
+	return realloc(buf, newsize);
+}
+
+static size_t encode_growing(void)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, malloc(INITIAL_BUFSIZE), INITIAL_BUFSIZE);
+	cbor_writer_set_grow(&writer, grow_with_realloc, NULL);
+
+	if (encode_document(&writer) != CBOR_SUCCESS) {
+		fprintf(stderr, "encoding failed\n");
+		exit(1);
+	}
+
+	size_t len = cbor_writer_len(&writer);
+	free(writer.buf);
+
+	return len;
+}
+#endif
+
+#if defined(CBOR_WRITER_DRY_RUN)
+/* Measure first, then encode into a buffer of the exact size. */
+static size_t encode_measured(void)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init_dry_run(&writer);
+	encode_document(&writer);
+
+	size_t bufsize = cbor_writer_len(&writer);
+	void *buf = malloc(bufsize);
+
+	cbor_writer_init(&writer, buf, bufsize);
+	if (encode_document(&writer) != CBOR_SUCCESS) {
+		fprintf(stderr, "encoding failed\n");
+		exit(1);
+	}
+
+	free(buf);
+
+	return bufsize;
+}
+#endif
+
+static size_t encode_samples_one_by_one(void)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, sample_buf, sizeof(sample_buf));
+	cbor_encode_array(&writer, NR_SAMPLES);
+	for (int i = 0; i < NR_SAMPLES; i++) {
+		cbor_encode_double(&writer, samples[i]);
+	}
+
+	return cbor_writer_len(&writer);
+}
+
+static size_t encode_samples_in_bulk(void)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, sample_buf, sizeof(sample_buf));
+	cbor_encode_array_f64(&writer, samples, NR_SAMPLES);
+
+	return cbor_writer_len(&writer);
+}
+
+static size_t encode_fsamples_one_by_one(void)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, sample_buf, sizeof(sample_buf));
+	cbor_encode_array(&writer, NR_SAMPLES);
+	for (int i = 0; i < NR_SAMPLES; i++) {
+		cbor_encode_float(&writer, fsamples[i]);
+	}
+
+	return cbor_writer_len(&writer);
+}
+
+static size_t encode_fsamples_in_bulk(void)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, sample_buf, sizeof(sample_buf));
+	cbor_encode_array_f32(&writer, fsamples, NR_SAMPLES);
+
+	return cbor_writer_len(&writer);
+}
+
+static void encode_entries(cbor_writer_t *writer)
+{
+	for (size_t i = 0; i < nr_entries; i++) {
+		cbor_encode_text_string(writer, keys[i], strlen(keys[i]));
+		cbor_encode_unsigned_integer(writer, i);
+	}
+}
+
+static size_t encode_map_unsorted(void)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, map_buf, sizeof(map_buf));
+	cbor_encode_map(&writer, nr_entries);
+	encode_entries(&writer);
+
+	return cbor_writer_len(&writer);
+}
+
+#if defined(CBOR_WRITER_SORTED)
+static size_t encode_map_sorted(void)
+{
+	cbor_writer_t writer;
+	cbor_writer_frame_t frames[1];
+
+	cbor_writer_init(&writer, map_buf, sizeof(map_buf));
+	cbor_writer_set_frames(&writer, frames, 1);
+	cbor_writer_set_scratch(&writer, scratch, sizeof(scratch));
+
+	cbor_encode_sorted_map_begin(&writer);
+	encode_entries(&writer);
+	if (cbor_encode_map_end(&writer) != CBOR_SUCCESS) {
+		fprintf(stderr, "sorting failed\n");
+		exit(1);
+	}
+
+	return cbor_writer_len(&writer);
+}
+#endif
+
+/* A telemetry record of small scalars, as items encoded */
+static size_t encode_scalars(void)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, sample_buf, sizeof(sample_buf));
+	for (int i = 0; i < NR_SAMPLES / 4; i++) {
+		cbor_encode_unsigned_integer(&writer, (uint64_t)(i & 15));
+		cbor_encode_negative_integer(&writer, -1 - (i & 7));
+		cbor_encode_bool(&writer, i & 1);
+		cbor_encode_unsigned_integer(&writer, (uint64_t)i * 1000u);
+	}
+
+	return NR_SAMPLES;
+}
+
+static size_t encode_scalars_inline(void)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, sample_buf, sizeof(sample_buf));
+	for (int i = 0; i < NR_SAMPLES / 4; i++) {
+		cbor_encode_unsigned_integer_inline(&writer,
+				(uint64_t)(i & 15));
+		cbor_encode_negative_integer_inline(&writer, -1 - (i & 7));
+		cbor_encode_bool_inline(&writer, i & 1);
+		cbor_encode_unsigned_integer_inline(&writer,
+				(uint64_t)i * 1000u);
+	}
+
+	return NR_SAMPLES;
+}
+
+static void run_items(const char *name, size_t (*encode)(void))
+{
+	uint64_t items = 0;
+	uint64_t start = bench_now_ns();
+	uint64_t elapsed;
+
+	do {
+		items += (*encode)();
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report(name, "items", items, elapsed);
+}
+
+static void run(const char *name, size_t (*encode)(void))
+{
+	uint64_t bytes = 0;
+	uint64_t start = bench_now_ns();
+	uint64_t elapsed;
+
+	do {
+		bytes += (*encode)();
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report(name, "B", bytes, elapsed);
+}
+
+void bench_encoder(void)
+{
+	run("encode, retry on overrun", encode_with_retries);
+#if defined(CBOR_WRITER_GROW)
+	run("encode, growable writer", encode_growing);
+#endif
+#if defined(CBOR_WRITER_DRY_RUN)
+	run("encode, measured first", encode_measured);
+#endif
+
+	/* a mix of halves, singles and doubles */
+	for (int i = 0; i < NR_SAMPLES; i++) {
+		samples[i] = (i % 3 == 0)? i * 0.5 : i * 0.1;
+	}
+	run("encode 10k doubles, one by one", encode_samples_one_by_one);
+	run("encode 10k doubles, in bulk", encode_samples_in_bulk);
+
+	/* doubles all fitting in halves */
+	for (int i = 0; i < NR_SAMPLES; i++) {
+		samples[i] = (i % 2048) * 0.25;
+	}
+	run("encode 10k halves, one by one", encode_samples_one_by_one);
+	run("encode 10k halves, in bulk", encode_samples_in_bulk);
+
+	/* a mix of halves and singles */
+	for (int i = 0; i < NR_SAMPLES; i++) {
+		fsamples[i] = (i % 2 == 0)? (float)(i % 2048) : (float)i * 0.1f;
+	}
+	run("encode 10k floats, one by one", encode_fsamples_one_by_one);
+	run("encode 10k floats, in bulk", encode_fsamples_in_bulk);
+
+	run_items("encode scalars, out of line", encode_scalars);
+	run_items("encode scalars, inline", encode_scalars_inline);
+
+	for (size_t i = 0; i < MAX_ENTRIES; i++) {
+		snprintf(keys[i], sizeof(keys[i]), "key%zu",
+				(i * 7919u) % MAX_ENTRIES);
+	}
+	for (nr_entries = 10; nr_entries <= MAX_ENTRIES; nr_entries *= 10) {
+		char name[64];
+
+		snprintf(name, sizeof(name), "map of %zu, as given",
+				nr_entries);
+		run(name, encode_map_unsorted);
+#if defined(CBOR_WRITER_SORTED)
+		snprintf(name, sizeof(name), "map of %zu, sorted", nr_entries);
+		run(name, encode_map_sorted);
+#endif
+	}
+}
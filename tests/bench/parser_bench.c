@@ -0,0 +1,95 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Kyunghwan Kwon <k@mononn.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "cbor/cbor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NR_RECORDS				400
+#define MAX_ITEMS				(NR_RECORDS * 14 + 1)
+
+/* An array of small sensor-like records:
+ * {"id": n, "t": -n, "ok": true, "v": [1, 2, 3], "s": "abc"} */
+static size_t make_payload(uint8_t *buf, size_t bufsize)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, buf, bufsize);
+	cbor_encode_array(&writer, NR_RECORDS);
+
+	for (int i = 0; i < NR_RECORDS; i++) {
+		cbor_encode_map(&writer, 5);
+		cbor_encode_text_string(&writer, "id", 2);
+		cbor_encode_unsigned_integer(&writer, (uint64_t)(i % 20));
+		cbor_encode_text_string(&writer, "t", 1);
+		cbor_encode_negative_integer(&writer, -(int64_t)(i % 10) - 1);
+		cbor_encode_text_string(&writer, "ok", 2);
+		cbor_encode_bool(&writer, true);
+		cbor_encode_text_string(&writer, "v", 1);
+		cbor_encode_array(&writer, 3);
+		cbor_encode_unsigned_integer(&writer, 1);
+		cbor_encode_unsigned_integer(&writer, 2);
+		cbor_encode_unsigned_integer(&writer, 3);
+		cbor_encode_text_string(&writer, "s", 1);
+		cbor_encode_text_string(&writer, "abc", 3);
+	}
+
+	return cbor_writer_len(&writer);
+}
+
+static cbor_stream_action_t count_event(const cbor_stream_event_t *event,
+		const cbor_stream_data_t *data, void *arg)
+{
+	(void)event;
+	(void)data;
+	(*(uint64_t *)arg)++;
+	return CBOR_STREAM_CONTINUE;
+}
+
+void bench_parser(void)
+{
+	static uint8_t msg[MAX_ITEMS * 4];
+	static cbor_item_t items[MAX_ITEMS];
+	size_t len = make_payload(msg, sizeof(msg));
+	uint64_t nitems = 0;
+	uint64_t start = bench_now_ns();
+	uint64_t elapsed;
+
+	do {
+		cbor_reader_t reader;
+		size_t n;
+
+		cbor_reader_init(&reader, items, MAX_ITEMS);
+		cbor_error_t err = cbor_parse(&reader, msg, len, &n);
+		if (err != CBOR_SUCCESS) {
+			fprintf(stderr, "parse failed: %d\n", err);
+			exit(1);
+		}
+		nitems += n;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report("cbor_parse small items", "items", nitems, elapsed);
+
+	uint64_t nevents = 0;
+	start = bench_now_ns();
+
+	do {
+		cbor_stream_decoder_t decoder;
+
+		cbor_stream_init(&decoder, count_event, &nevents);
+		if (cbor_stream_feed(&decoder, msg, len) != CBOR_SUCCESS) {
+			fprintf(stderr, "stream failed\n");
+			exit(1);
+		}
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report("cbor_stream_feed small items", "events", nevents,
+			elapsed);
+}
@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Kyunghwan Kwon <k@mononn.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "cbor/cbor.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NR_RECORDS				20000
+#define MAX_RECORD_ITEMS			16
+#define MAX_THREADS				4
+
+struct worker {
+	pthread_t thread;
+	const uint8_t *msg;
+	const cbor_seq_record_t *records;
+	cbor_error_t *errors;
+	size_t first;
+	size_t end;
+	cbor_item_t items[MAX_RECORD_ITEMS];
+};
+
+static uint8_t msg[NR_RECORDS * 32];
+static cbor_seq_record_t records[NR_RECORDS];
+static cbor_error_t errors[NR_RECORDS];
+
+/* A sequence of {"id": n, "t": -n, "v": [1, 2, 3], "s": "abc"} */
+static size_t make_sequence(uint8_t *buf, size_t bufsize)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, buf, bufsize);
+
+	for (int i = 0; i < NR_RECORDS; i++) {
+		cbor_encode_map(&writer, 4);
+		cbor_encode_text_string(&writer, "id", 2);
+		cbor_encode_unsigned_integer(&writer, (uint64_t)i);
+		cbor_encode_text_string(&writer, "t", 1);
+		cbor_encode_negative_integer(&writer, -(int64_t)(i % 10) - 1);
+		cbor_encode_text_string(&writer, "v", 1);
+		cbor_encode_array(&writer, 3);
+		cbor_encode_unsigned_integer(&writer, 1);
+		cbor_encode_unsigned_integer(&writer, 2);
+		cbor_encode_unsigned_integer(&writer, 3);
+		cbor_encode_text_string(&writer, "s", 1);
+		cbor_encode_text_string(&writer, "abc", 3);
+	}
+
+	return cbor_writer_len(&writer);
+}
+
+static void *parse_records(void *arg)
+{
+	struct worker *w = (struct worker *)arg;
+
+	for (size_t i = w->first; i < w->end; i++) {
+		cbor_reader_t reader;
+
+		cbor_reader_init(&reader, w->items, MAX_RECORD_ITEMS);
+		w->errors[i] = cbor_parse(&reader,
+				&w->msg[w->records[i].offset],
+				w->records[i].size, NULL);
+	}
+
+	return NULL;
+}
+
+static void bench_threads(size_t nrecords, size_t nthreads)
+{
+	static struct worker workers[MAX_THREADS];
+	char name[40];
+	uint64_t count = 0;
+	uint64_t start = bench_now_ns();
+	uint64_t elapsed;
+
+	do {
+		/* a contiguous range each, so that no two workers write
+		 * errors on the same cache line but at range ends */
+		for (size_t i = 0; i < nthreads; i++) {
+			workers[i] = (struct worker) {
+				.msg = msg,
+				.records = records,
+				.errors = errors,
+				.first = nrecords * i / nthreads,
+				.end = nrecords * (i + 1) / nthreads,
+			};
+			pthread_create(&workers[i].thread, NULL,
+					parse_records, &workers[i]);
+		}
+		for (size_t i = 0; i < nthreads; i++) {
+			pthread_join(workers[i].thread, NULL);
+		}
+		for (size_t i = 0; i < nrecords; i++) {
+			if (errors[i] != CBOR_SUCCESS) {
+				fprintf(stderr, "record %zu failed: %d\n",
+						i, errors[i]);
+				exit(1);
+			}
+		}
+		count += nrecords;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	snprintf(name, sizeof(name), "sequence parse, %zu thread(s)",
+			nthreads);
+	bench_report(name, "records", count, elapsed);
+}
+
+void bench_sequence(void)
+{
+	size_t len = make_sequence(msg, sizeof(msg));
+	size_t nrecords = 0;
+	uint64_t count = 0;
+	uint64_t start = bench_now_ns();
+	uint64_t elapsed;
+
+	do {
+		if (cbor_split_sequence(msg, len, records, NR_RECORDS,
+					&nrecords) != CBOR_SUCCESS) {
+			fprintf(stderr, "split failed\n");
+			exit(1);
+		}
+		count += nrecords;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report("cbor_split_sequence", "records", count, elapsed);
+
+	for (size_t n = 1; n <= MAX_THREADS; n *= 2) {
+		bench_threads(nrecords, n);
+	}
+}
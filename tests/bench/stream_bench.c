@@ -0,0 +1,278 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Kyunghwan Kwon <k@mononn.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "cbor/cbor.h"
+#include "cbor/helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NR_RECORDS				8000
+#define NR_INTEGERS				64000
+
+static uint8_t msg[NR_RECORDS * 64];
+static uint8_t ints[NR_INTEGERS * 5 + 16];
+static cbor_stream_record_t records[256];
+
+CBOR_PATH_INLINE_DECL(temp, NULL, CBOR_ANY_SEG(), CBOR_STR_SEG("temp"));
+
+/* An array of telemetry records with multi-byte headers:
+ * {"ts": 1700000000 + n, "seq": n, "temp": 21.5 + n/10, "dev": "sensor-0001"} */
+static size_t make_payload(void)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, msg, sizeof(msg));
+	cbor_encode_array(&writer, NR_RECORDS);
+
+	for (int i = 0; i < NR_RECORDS; i++) {
+		cbor_encode_map(&writer, 4);
+		cbor_encode_text_string(&writer, "ts", 2);
+		cbor_encode_unsigned_integer(&writer, 1700000000u + (uint64_t)i);
+		cbor_encode_text_string(&writer, "seq", 3);
+		cbor_encode_unsigned_integer(&writer, (uint64_t)i);
+		cbor_encode_text_string(&writer, "temp", 4);
+		cbor_encode_double(&writer, 21.5 + i / 10.0);
+		cbor_encode_text_string(&writer, "dev", 3);
+		cbor_encode_text_string(&writer, "sensor-0001", 11);
+	}
+
+	return cbor_writer_len(&writer);
+}
+
+/* An array of counters, most of them taking 2 or 3 bytes */
+static size_t make_integers(void)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, ints, sizeof(ints));
+	cbor_encode_array(&writer, NR_INTEGERS);
+
+	for (int i = 0; i < NR_INTEGERS; i++) {
+		cbor_encode_unsigned_integer(&writer,
+				(uint64_t)((i * 7919) % 70000));
+	}
+
+	return cbor_writer_len(&writer);
+}
+
+static cbor_stream_action_t count_event(const cbor_stream_event_t *event,
+		const cbor_stream_data_t *data, void *arg)
+{
+	(void)event;
+	(void)data;
+	(*(uint64_t *)arg)++;
+	return CBOR_STREAM_CONTINUE;
+}
+
+static void run_chunked(const char *name, size_t len, size_t chunk)
+{
+	uint64_t nevents = 0;
+	uint64_t start = bench_now_ns();
+	uint64_t elapsed;
+
+	do {
+		cbor_stream_decoder_t decoder;
+
+		cbor_stream_init(&decoder, count_event, &nevents);
+		for (size_t off = 0; off < len; off += chunk) {
+			size_t n = (len - off < chunk)? len - off : chunk;
+
+			if (cbor_stream_feed(&decoder, &msg[off], n)
+					!= CBOR_SUCCESS) {
+				fprintf(stderr, "stream failed\n");
+				exit(1);
+			}
+		}
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report(name, "events", nevents, elapsed);
+}
+
+static void run_pulled(const char *name, size_t len, size_t chunk)
+{
+	uint64_t nevents = 0;
+	uint64_t start = bench_now_ns();
+	uint64_t elapsed;
+
+	do {
+		cbor_stream_decoder_t decoder;
+		const cbor_stream_event_t *event;
+		const cbor_stream_data_t *data;
+		cbor_error_t err;
+
+		cbor_stream_init_pull(&decoder);
+		for (size_t off = 0; off < len; off += chunk) {
+			size_t n = (len - off < chunk)? len - off : chunk;
+
+			cbor_stream_feed(&decoder, &msg[off], n);
+			while ((err = cbor_stream_next(&decoder, &event, &data))
+					== CBOR_SUCCESS) {
+				nevents++;
+			}
+			if (err != CBOR_NEED_MORE) {
+				fprintf(stderr, "stream failed\n");
+				exit(1);
+			}
+		}
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report(name, "events", nevents, elapsed);
+}
+
+static cbor_stream_action_t sum_uint(const cbor_stream_event_t *event,
+		const cbor_stream_data_t *data, void *arg)
+{
+	if (event->type == CBOR_STREAM_EVENT_UINT) {
+		*(uint64_t *)arg += data->uint;
+	}
+	return CBOR_STREAM_CONTINUE;
+}
+
+static bool sum_uint_batch(const cbor_stream_record_t *batch, size_t n,
+		void *arg)
+{
+	uint64_t sum = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		if (batch[i].event.type == CBOR_STREAM_EVENT_UINT) {
+			sum += batch[i].data.uint;
+		}
+	}
+
+	*(uint64_t *)arg += sum;
+	return true;
+}
+
+/* Integers summed from a callback per event, or per batch of @p nr_records */
+static void run_integers(const char *name, size_t len, size_t nr_records)
+{
+	uint64_t sum = 0;
+	uint64_t nevents = 0;
+	uint64_t start = bench_now_ns();
+	uint64_t elapsed;
+
+	do {
+		cbor_stream_decoder_t decoder;
+
+		if (nr_records == 0) {
+			cbor_stream_init(&decoder, sum_uint, &sum);
+		} else {
+			cbor_stream_init_batch(&decoder, records, nr_records,
+					sum_uint_batch, &sum);
+		}
+		for (size_t off = 0; off < len; off += 4096) {
+			size_t n = (len - off < 4096)? len - off : 4096;
+
+			if (cbor_stream_feed(&decoder, &ints[off], n)
+					!= CBOR_SUCCESS) {
+				fprintf(stderr, "stream failed\n");
+				exit(1);
+			}
+		}
+		nevents += NR_INTEGERS + 2;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	if (sum == 0) {
+		fprintf(stderr, "nothing summed\n");
+		exit(1);
+	}
+
+	bench_report(name, "events", nevents, elapsed);
+}
+
+struct temp_sum {
+	double sum;
+	bool next_is_temp;
+};
+
+/* Without paths, the callback has to look at every key to find "temp" */
+static cbor_stream_action_t sum_temp_by_key(const cbor_stream_event_t *event,
+		const cbor_stream_data_t *data, void *arg)
+{
+	struct temp_sum *t = (struct temp_sum *)arg;
+
+	if (event->depth != 2) {
+		return CBOR_STREAM_CONTINUE;
+	}
+
+	if (event->is_map_key) {
+		t->next_is_temp = event->type == CBOR_STREAM_EVENT_TEXT &&
+			data->str.len == 4 &&
+			memcmp(data->str.ptr, "temp", 4) == 0;
+	} else if (t->next_is_temp && event->type == CBOR_STREAM_EVENT_FLOAT) {
+		t->sum += data->flt;
+	}
+
+	return CBOR_STREAM_CONTINUE;
+}
+
+static cbor_stream_action_t sum_temp(const cbor_stream_event_t *event,
+		const cbor_stream_data_t *data, void *arg)
+{
+	(void)event;
+	((struct temp_sum *)arg)->sum += data->flt;
+	return CBOR_STREAM_CONTINUE;
+}
+
+/* Records per second summing up "temp", with the path filter or without */
+static void run_extract(const char *name, size_t len,
+		cbor_stream_callback_t callback, const struct cbor_parser *paths)
+{
+	struct temp_sum t = { 0, false };
+	uint64_t nrecords = 0;
+	uint64_t start = bench_now_ns();
+	uint64_t elapsed;
+
+	do {
+		cbor_stream_decoder_t decoder;
+
+		cbor_stream_init(&decoder, callback, &t);
+		cbor_stream_set_paths(&decoder, paths, paths? 1 : 0);
+		for (size_t off = 0; off < len; off += 4096) {
+			size_t n = (len - off < 4096)? len - off : 4096;
+
+			if (cbor_stream_feed(&decoder, &msg[off], n)
+					!= CBOR_SUCCESS) {
+				fprintf(stderr, "stream failed\n");
+				exit(1);
+			}
+		}
+		nrecords += NR_RECORDS;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	if (t.sum <= 0) {
+		fprintf(stderr, "nothing extracted\n");
+		exit(1);
+	}
+
+	bench_report(name, "records", nrecords, elapsed);
+}
+
+void bench_stream(void)
+{
+	size_t len = make_payload();
+
+	run_chunked("cbor_stream_feed, 4 KiB chunks", len, 4096);
+	run_chunked("cbor_stream_feed, 64 KiB chunks", len, 65536);
+	run_pulled("cbor_stream_next, 4 KiB chunks", len, 4096);
+	run_pulled("cbor_stream_next, 64 KiB chunks", len, 65536);
+
+	run_extract("\"temp\" by keys in callback", len,
+			sum_temp_by_key, NULL);
+	run_extract("\"temp\" by path [*][\"temp\"]", len, sum_temp, &temp);
+
+	len = make_integers();
+	run_integers("integers, a callback per event", len, 0);
+	run_integers("integers, batches of 16", len, 16);
+	run_integers("integers, batches of 256", len, 256);
+}
@@ -0,0 +1,103 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Kyunghwan Kwon <k@mononn.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "cbor/cbor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NR_STRINGS				256
+
+static const char *texts[] = {
+	"temperature sensor in the north-east corner of building 7",
+	"Grüße aus München, schöne Größe",
+	"水は高い所から低い所へ流れる",
+	"ok",
+};
+
+static size_t make_payload(uint8_t *buf, size_t bufsize)
+{
+	cbor_writer_t writer;
+
+	cbor_writer_init(&writer, buf, bufsize);
+	cbor_encode_array(&writer, NR_STRINGS);
+
+	for (int i = 0; i < NR_STRINGS; i++) {
+		const char *s = texts[i % (int)(sizeof(texts) / sizeof(*texts))];
+		cbor_encode_text_string(&writer, s, strlen(s));
+	}
+
+	return cbor_writer_len(&writer);
+}
+
+static cbor_stream_action_t ignore_event(const cbor_stream_event_t *event,
+		const cbor_stream_data_t *data, void *arg)
+{
+	(void)event;
+	(void)data;
+	(void)arg;
+	return CBOR_STREAM_CONTINUE;
+}
+
+static void run_parse(const uint8_t *msg, size_t len, bool validate)
+{
+	static cbor_item_t items[NR_STRINGS + 1];
+	uint64_t bytes = 0;
+	uint64_t start = bench_now_ns();
+	uint64_t elapsed;
+
+	do {
+		cbor_reader_t reader;
+
+		cbor_reader_init(&reader, items, NR_STRINGS + 1);
+		cbor_reader_set_utf8_validation(&reader, validate);
+		if (cbor_parse(&reader, msg, len, NULL) != CBOR_SUCCESS) {
+			fprintf(stderr, "parse failed\n");
+			exit(1);
+		}
+		bytes += len;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report(validate? "cbor_parse text, utf-8 checked" :
+			"cbor_parse text, unchecked", "B", bytes, elapsed);
+}
+
+static void run_stream(const uint8_t *msg, size_t len, bool validate)
+{
+	uint64_t bytes = 0;
+	uint64_t start = bench_now_ns();
+	uint64_t elapsed;
+
+	do {
+		cbor_stream_decoder_t decoder;
+
+		cbor_stream_init(&decoder, ignore_event, NULL);
+		cbor_stream_set_utf8_validation(&decoder, validate);
+		if (cbor_stream_feed(&decoder, msg, len) != CBOR_SUCCESS) {
+			fprintf(stderr, "stream failed\n");
+			exit(1);
+		}
+		bytes += len;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_NS);
+
+	bench_report(validate? "cbor_stream_feed text, checked" :
+			"cbor_stream_feed text, unchecked", "B", bytes, elapsed);
+}
+
+void bench_utf8(void)
+{
+	static uint8_t msg[NR_STRINGS * 64];
+	size_t len = make_payload(msg, sizeof(msg));
+
+	run_parse(msg, len, false);
+	run_parse(msg, len, true);
+	run_stream(msg, len, false);
+	run_stream(msg, len, true);
+}
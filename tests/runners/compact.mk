@@ -0,0 +1,26 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = compact
+
+SRC_FILES = \
+	../src/helper.c \
+	../src/decoder.c \
+	../src/ieee754.c \
+	../src/parser.c \
+	../src/utf8.c \
+	../src/common.c \
+
+TEST_SRC_FILES = \
+	src/compact_item_test.cpp \
+	src/decoder_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	../include \
+	$(CPPUTEST_HOME)/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = \
+	-DCBOR_COMPACT_ITEM
+
+include MakefileRunner.mk
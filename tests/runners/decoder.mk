@@ -4,12 +4,17 @@ COMPONENT_NAME = decoder
 
 SRC_FILES = \
 	../src/decoder.c \
+	../src/ieee754.c \
 	../src/parser.c \
+	../src/utf8.c \
 	../src/common.c \
 
 TEST_SRC_FILES = \
 	src/decoder_test.cpp \
 	src/parser_count_test.cpp \
+	src/parser_frame_test.cpp \
+	src/parser_resume_test.cpp \
+	src/parser_sequence_test.cpp \
 	src/tool_item_count_test.cpp \
 	src/test_all.cpp \
 
@@ -9,6 +9,11 @@ SRC_FILES = \
 
 TEST_SRC_FILES = \
 	src/encoder_test.cpp \
+	src/encoder_deferred_test.cpp \
+	src/encoder_grow_test.cpp \
+	src/encoder_iovec_test.cpp \
+	src/encoder_sink_test.cpp \
+	src/encoder_sorted_test.cpp \
 	src/test_all.cpp \
 
 INCLUDE_DIRS = \
@@ -16,6 +21,13 @@ INCLUDE_DIRS = \
 	$(CPPUTEST_HOME)/include \
 
 MOCKS_SRC_DIRS =
-CPPUTEST_CPPFLAGS =
+CPPUTEST_CPPFLAGS = \
+	-DCBOR_WRITER_SINK \
+	-DCBOR_WRITER_GROW \
+	-DCBOR_WRITER_DRY_RUN \
+	-DCBOR_WRITER_DEFERRED \
+	-DCBOR_WRITER_IOVEC \
+	-DCBOR_WRITER_SORTED \
+	-DCBOR_WRITER_STRINGREF \
 
 include MakefileRunner.mk
@@ -10,6 +10,7 @@ SRC_FILES = \
 	../src/ieee754.c \
 	../src/decoder.c \
 	../src/parser.c \
+	../src/utf8.c \
 	../src/helper.c \
 	../src/stringify.c \
 	../src/common.c \
@@ -6,7 +6,9 @@ SRC_FILES = \
 	../src/helper.c \
 	../src/stringify.c \
 	../src/decoder.c \
+	../src/ieee754.c \
 	../src/parser.c \
+	../src/utf8.c \
 	../src/common.c \
 
 TEST_SRC_FILES = \
@@ -4,6 +4,7 @@ COMPONENT_NAME = stream
 
 SRC_FILES = \
 	../src/stream.c \
+	../src/utf8.c \
 	../src/common.c \
 	../src/ieee754.c \
 
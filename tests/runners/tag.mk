@@ -7,12 +7,14 @@ SRC_FILES = \
 	../src/encoder.c \
 	../src/ieee754.c \
 	../src/parser.c \
+	../src/utf8.c \
 	../src/decoder.c \
 	../src/helper.c \
 	../src/stringify.c \
 
 TEST_SRC_FILES = \
 	src/tag_test.cpp \
+	src/stringref_test.cpp \
 	src/test_all.cpp \
 
 INCLUDE_DIRS = \
@@ -20,6 +22,9 @@ INCLUDE_DIRS = \
 	$(CPPUTEST_HOME)/include \
 
 MOCKS_SRC_DIRS =
-CPPUTEST_CPPFLAGS =
+CPPUTEST_CPPFLAGS = \
+	-DCBOR_WRITER_DRY_RUN \
+	-DCBOR_WRITER_DEFERRED \
+	-DCBOR_WRITER_STRINGREF \
 
 include MakefileRunner.mk
@@ -0,0 +1,19 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = utf8
+
+SRC_FILES = \
+	../src/utf8.c \
+
+TEST_SRC_FILES = \
+	src/utf8_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	../include \
+	$(CPPUTEST_HOME)/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS =
+
+include MakefileRunner.mk
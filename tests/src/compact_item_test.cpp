@@ -0,0 +1,134 @@
+#include "CppUTest/TestHarness.h"
+
+#include "cbor/parser.h"
+#include "cbor/decoder.h"
+#include "cbor/helper.h"
+#include <string.h>
+
+static void count_item(const cbor_reader_t *reader, const cbor_item_t *item,
+		const cbor_item_t *parent, void *arg)
+{
+	(void)reader;
+	(void)item;
+	(void)parent;
+	(*static_cast<size_t *>(arg))++;
+}
+
+static void on_value(const cbor_reader_t *reader,
+		const struct cbor_parser *parser,
+		const cbor_item_t *item, void *arg)
+{
+	(void)parser;
+	int v = 0;
+	cbor_decode(reader, item, &v, sizeof(v));
+	*static_cast<int *>(arg) = v;
+}
+
+TEST_GROUP(CompactItem) {
+	cbor_reader_t reader;
+	cbor_item_t items[16];
+	cbor_parser_frame_t frames[4];
+
+	void setup(void) {
+		cbor_reader_init(&reader, items, sizeof(items) / sizeof(*items));
+	}
+};
+
+TEST(CompactItem, ShouldBeEightBytes)
+{
+	LONGS_EQUAL(8, sizeof(cbor_item_t));
+}
+
+TEST(CompactItem, ShouldReportIndefiniteSize_WhenIndefiniteArrayGiven)
+{
+	const uint8_t msg[] = { 0x9f, 0x01, 0x02, 0xff };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_BREAK, cbor_parse(&reader, msg, sizeof(msg), &n));
+	LONGS_EQUAL(4, n);
+	CHECK(cbor_item_is_indefinite(&items[0]));
+	LONGS_EQUAL((size_t)CBOR_INDEFINITE_VALUE, cbor_get_item_size(&items[0]));
+	LONGS_EQUAL(CBOR_ITEM_ARRAY, cbor_get_item_type(&items[0]));
+	CHECK(!cbor_item_is_break(&items[2]));
+	CHECK(cbor_item_is_break(&items[3]));
+}
+
+TEST(CompactItem, ShouldKeepOffsetAndSize_WhenStringGiven)
+{
+	const uint8_t msg[] = { 0x82, 0x63, 'a', 'b', 'c', 0x18, 0x64 };
+	char buf[4] = { 0, };
+	uint8_t val = 0;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, msg, sizeof(msg), NULL));
+	LONGS_EQUAL(2, items[1].offset);
+	LONGS_EQUAL(3, cbor_get_item_size(&items[1]));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, &items[1],
+				buf, sizeof(buf)));
+	STRCMP_EQUAL("abc", buf);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, &items[2],
+				&val, sizeof(val)));
+	LONGS_EQUAL(100, val);
+}
+
+TEST(CompactItem, ShouldReturnInvalid_WhenContainerSizeDoesNotFit)
+{
+	const uint8_t array32[] = { 0x9a, 0xff, 0xff, 0xff, 0xff };
+	const uint8_t map64[] = { 0xbb, 0, 0, 0, 1, 0, 0, 0, 0 };
+
+	LONGS_EQUAL(CBOR_INVALID,
+			cbor_parse(&reader, array32, sizeof(array32), NULL));
+	LONGS_EQUAL(CBOR_INVALID,
+			cbor_parse(&reader, map64, sizeof(map64), NULL));
+}
+
+TEST(CompactItem, ShouldReturnInvalid_WhenTagNumberDoesNotFit)
+{
+	const uint8_t msg[] = { 0xda, 0xff, 0xff, 0xff, 0xff, 0x00 };
+	const uint8_t ok[] = { 0xda, 0xff, 0xff, 0xff, 0xfe, 0x00 };
+
+	LONGS_EQUAL(CBOR_INVALID, cbor_parse(&reader, msg, sizeof(msg), NULL));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, ok, sizeof(ok), NULL));
+	LONGS_EQUAL(0xfffffffe, cbor_get_tag_number(&items[0]));
+}
+
+TEST(CompactItem, ShouldReturnInvalid_WhenMessageIsNotAddressable)
+{
+	const uint8_t msg[] = { 0x00 };
+	size_t n = 1;
+
+	LONGS_EQUAL(CBOR_INVALID, cbor_parse(&reader, msg,
+				CBOR_ITEM_MAX_OFFSET + 1, &n));
+	LONGS_EQUAL(0, n);
+
+	cbor_reader_set_frames(&reader, frames, 4);
+	LONGS_EQUAL(CBOR_INVALID, cbor_parse_resume(&reader, msg,
+				CBOR_ITEM_MAX_OFFSET + 1, NULL));
+}
+
+TEST(CompactItem, ShouldIterateChildren_WhenIndefiniteMapGiven)
+{
+	/* {_ "a": 1, "b": [_ 2, 3]} */
+	const uint8_t msg[] = {
+		0xbf, 0x61, 'a', 0x01, 0x61, 'b', 0x9f, 0x02, 0x03, 0xff, 0xff
+	};
+	size_t count = 0;
+
+	LONGS_EQUAL(CBOR_BREAK, cbor_parse(&reader, msg, sizeof(msg), NULL));
+	cbor_iterate(&reader, &items[0], count_item, &count);
+	LONGS_EQUAL(5, count);
+}
+
+TEST(CompactItem, ShouldDispatch_WhenPathMatchesInsideIndefiniteContainer)
+{
+	const uint8_t msg[] = {
+		0xbf, 0x61, 'a', 0x01, 0x61, 'b', 0x9f, 0x02, 0x03, 0xff, 0xff
+	};
+	const struct cbor_parser parsers[] = {
+		CBOR_PATH_INLINE(on_value, CBOR_STR_SEG("b"), CBOR_IDX_SEG(1)),
+	};
+	int v = 0;
+
+	CHECK(cbor_unmarshal(&reader, parsers,
+			sizeof(parsers) / sizeof(*parsers), msg, sizeof(msg), &v));
+	LONGS_EQUAL(3, v);
+}
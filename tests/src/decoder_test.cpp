@@ -67,6 +67,70 @@ TEST_GROUP(Decoder)
 	}
 };
 
+/* What RFC 8949 §3 says an initial byte means, worked out from its major
+ * type and additional information without the table. */
+static uint8_t decode_following_bytes(uint8_t ai)
+{
+	if (ai < 24) {
+		return 0;
+	} else if (ai <= 27) {
+		return (uint8_t)(1u << (ai - 24));
+	} else if (ai == 31) {
+		return 0xff; /* indefinite length or BREAK */
+	}
+
+	return 0xfe; /* reserved */
+}
+
+static uint8_t decode_kind(uint8_t major_type, uint8_t ai)
+{
+	if (ai >= 28 && ai <= 30) {
+		return CBOR_ITEM_UNKNOWN;
+	}
+
+	switch (major_type) {
+	case 0: /* fall through */
+	case 1:
+		return CBOR_ITEM_INTEGER;
+	case 2: /* fall through */
+	case 3:
+		return CBOR_ITEM_STRING;
+	case 4:
+		return CBOR_ITEM_ARRAY;
+	case 5:
+		return CBOR_ITEM_MAP;
+	case 6:
+		return CBOR_ITEM_TAG;
+	default: /* simple values, floats, and BREAK parsed as a float */
+		return ai <= 24? CBOR_ITEM_SIMPLE_VALUE : CBOR_ITEM_FLOAT;
+	}
+}
+
+TEST(Decoder, ShouldDescribeEveryInitialByte_WhenTableLookedUp)
+{
+	for (unsigned int b = 0; b < 256; b++) {
+		const cbor_initial_byte_t *hdr = &cbor_initial_bytes[b];
+		uint8_t major_type = (uint8_t)(b >> 5);
+		uint8_t ai = (uint8_t)(b & 0x1f);
+
+		LONGS_EQUAL(decode_following_bytes(ai), hdr->following_bytes);
+		LONGS_EQUAL(decode_kind(major_type, ai), hdr->kind);
+	}
+
+	for (uint8_t ai = 0; ai < 32; ai++) {
+		LONGS_EQUAL(decode_following_bytes(ai),
+				cbor_get_following_bytes(ai));
+	}
+
+	LONGS_EQUAL(2, cbor_initial_bytes[0xf9].following_bytes); /* half */
+	LONGS_EQUAL(CBOR_ITEM_FLOAT, cbor_initial_bytes[0xfb].kind);
+	LONGS_EQUAL(CBOR_ITEM_SIMPLE_VALUE, cbor_initial_bytes[0xf8].kind);
+	LONGS_EQUAL((uint8_t)CBOR_INDEFINITE_VALUE,
+			cbor_initial_bytes[0x9f].following_bytes);
+	LONGS_EQUAL((uint8_t)CBOR_RESERVED_VALUE,
+			cbor_initial_bytes[0x1c].following_bytes);
+}
+
 // most of test cases are brought from
 // https://www.rfc-editor.org/rfc/rfc8949.html#name-examples-of-encoded-cbor-da
 TEST(Decoder, ShouldDecodeUnsignedInteger_WhenEncodedGiven)
@@ -333,7 +397,8 @@ TEST(Decoder, ShouldDecodeArray_WhenSingleLevelWithDiffentTypeValueGiven)
 	mock().expectOneCall("f_string").withParameter("size", 3);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeArray_WhenMultiLevelArrayGiven)
@@ -352,7 +417,8 @@ TEST(Decoder, ShouldDecodeArray_WhenMultiLevelArrayGiven)
 	mock().expectNCalls(2, "f_integer").withParameter("size", 0);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeArray_WhenOneByteLengthGiven)
@@ -372,7 +438,8 @@ TEST(Decoder, ShouldDecodeArray_WhenOneByteLengthGiven)
 	mock().expectNCalls(2, "f_integer").withParameter("size", 1);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 
@@ -388,7 +455,8 @@ TEST(Decoder, ShouldDecodeMap_WhenSingleLevelArrayGiven)
 	mock().expectNCalls(4, "f_integer").withParameter("size", 0);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeMap_WhenEmptyMapGiven)
@@ -417,7 +485,8 @@ TEST(Decoder, ShouldDecodeMap_WhenEncodedLenGiven)
 	mock().expectNCalls(10, "f_string").withParameter("size", 1);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeMap_WhenArrayValueGiven)
@@ -437,7 +506,8 @@ TEST(Decoder, ShouldDecodeMap_WhenArrayValueGiven)
 	mock().expectNCalls(2, "f_integer").withParameter("size", 0);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 
@@ -464,7 +534,8 @@ TEST(Decoder, ShouldDecodeByteString_WhenIndefiniteByteGiven)
 	mock().expectOneCall("f_float").withParameter("size", 0xff);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeTextString_WhenIndefiniteTextStringGiven)
@@ -483,7 +554,8 @@ TEST(Decoder, ShouldDecodeTextString_WhenIndefiniteTextStringGiven)
 	mock().expectOneCall("f_float").withParameter("size", 0xff);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 
@@ -502,7 +574,8 @@ TEST(Decoder, ShouldDecodeByteString_WhenIndefiniteByteGiven2)
 	mock().expectOneCall("f_float").withParameter("size", 0xff);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeTextString_WhenIndefiniteStringGiven)
@@ -521,7 +594,8 @@ TEST(Decoder, ShouldDecodeTextString_WhenIndefiniteStringGiven)
 	mock().expectOneCall("f_float").withParameter("size", 0xff);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeEmptyLengthArray_WhenZeroLengthIndefiniteArrarGiven)
@@ -536,7 +610,8 @@ TEST(Decoder, ShouldDecodeEmptyLengthArray_WhenZeroLengthIndefiniteArrarGiven)
 	mock().expectOneCall("f_float").withParameter("size", 0xff);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeArray_WhenMultiLevelIndefiniteArrarGiven)
@@ -559,7 +634,8 @@ TEST(Decoder, ShouldDecodeArray_WhenMultiLevelIndefiniteArrarGiven)
 	mock().expectOneCall("f_float").withParameter("size", 0xff);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeArray_WhenMultiLevelIndefiniteArrarGiven2)
@@ -580,7 +656,8 @@ TEST(Decoder, ShouldDecodeArray_WhenMultiLevelIndefiniteArrarGiven2)
 	mock().expectOneCall("f_float").withParameter("size", 0xff);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeArray_WhenMultiLevelIndefiniteArrarGiven3)
@@ -601,7 +678,8 @@ TEST(Decoder, ShouldDecodeArray_WhenMultiLevelIndefiniteArrarGiven3)
 	mock().expectOneCall("f_float").withParameter("size", 0xff);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeArray_WhenMultiLevelIndefiniteArrarGiven4)
@@ -622,7 +700,8 @@ TEST(Decoder, ShouldDecodeArray_WhenMultiLevelIndefiniteArrarGiven4)
 	mock().expectNCalls(2, "f_integer").withParameter("size", 0);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeArray_WhenInfiniteLengthGiven)
@@ -643,7 +722,8 @@ TEST(Decoder, ShouldDecodeArray_WhenInfiniteLengthGiven)
 	mock().expectOneCall("f_float").withParameter("size", 0xff);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeMap_WhenMultiInfiniteLengthGiven)
@@ -666,7 +746,8 @@ TEST(Decoder, ShouldDecodeMap_WhenMultiInfiniteLengthGiven)
 	mock().expectOneCall("f_float").withParameter("size", 0xff);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 TEST(Decoder, ShouldDecodeArray_WhenInfiniteMapIncluded)
@@ -686,7 +767,8 @@ TEST(Decoder, ShouldDecodeArray_WhenInfiniteMapIncluded)
 	mock().expectOneCall("f_float").withParameter("size", 0xff);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 }
 
@@ -702,7 +784,8 @@ TEST(Decoder, ShouldDecodeFloat_WhenSinglePrecisionGiven)
 	mock().expectOneCall("f_float").withParameter("size", 4);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 
 	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, items, &v, sizeof(v)));
@@ -720,7 +803,8 @@ TEST(Decoder, ShouldDecodeFloat_WhenSinglePrecisionGiven2)
 	mock().expectOneCall("f_float").withParameter("size", 4);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 
 	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, items, &v, sizeof(v)));
@@ -738,7 +822,8 @@ TEST(Decoder, ShouldDecodeFloat_WhenSinglePrecisionInfinityGiven)
 	mock().expectOneCall("f_float").withParameter("size", 4);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 
 	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, items, &v, sizeof(v)));
@@ -756,7 +841,8 @@ TEST(Decoder, ShouldDecodeFloat_WhenSinglePrecisionNegativeInfinityGiven)
 	mock().expectOneCall("f_float").withParameter("size", 4);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 
 	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, items, &v, sizeof(v)));
@@ -774,7 +860,8 @@ TEST(Decoder, ShouldDecodeFloat_WhenSinglePrecisionNanGiven)
 	mock().expectOneCall("f_float").withParameter("size", 4);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 
 	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, items, &v, sizeof(v)));
@@ -793,7 +880,8 @@ TEST(Decoder, ShouldDecodeFalse)
 	mock().expectOneCall("f_simple").withParameter("size", 0);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 
 	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, items, &v, sizeof(v)));
@@ -811,7 +899,8 @@ TEST(Decoder, ShouldDecodeTrue)
 	mock().expectOneCall("f_simple").withParameter("size", 0);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 
 	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, items, &v, sizeof(v)));
@@ -829,7 +918,8 @@ TEST(Decoder, ShouldDecodeNull)
 	mock().expectOneCall("f_simple").withParameter("size", 0);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 
 	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, items, &v, sizeof(v)));
@@ -847,7 +937,8 @@ TEST(Decoder, ShouldDecodeSimpleValue)
 	mock().expectOneCall("f_simple").withParameter("size", 0);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 
 	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, items, &v, sizeof(v)));
@@ -865,7 +956,8 @@ TEST(Decoder, ShouldDecodeSimpleValue_WhenFollowingByteGiven)
 	mock().expectOneCall("f_simple").withParameter("size", 1);
 
 	for (size_t i = 0; i < n; i++) {
-		check_item_type[items[i].type](items[i].size);
+		check_item_type[cbor_get_item_type(&items[i])](
+				cbor_get_item_size(&items[i]));
 	}
 
 	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, items, &v, sizeof(v)));
@@ -961,3 +1053,249 @@ TEST(Decoder, ShouldParseIncremental) {
 	}
 }
 #endif
+
+TEST(Decoder, ShouldReturnInvalid_WhenIllFormedUtf8TextGiven)
+{
+	/* ["ok", "a\xed\xa0\x80"] */
+	uint8_t m[] = { 0x82, 0x62, 'o', 'k', 0x64, 'a', 0xed, 0xa0, 0x80 };
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, m, sizeof(m), NULL));
+
+	cbor_reader_set_utf8_validation(&reader, true);
+	LONGS_EQUAL(CBOR_INVALID, cbor_parse(&reader, m, sizeof(m), NULL));
+	LONGS_EQUAL(7, reader.msgidx);
+}
+
+TEST(Decoder, ShouldValidateEachChunk_WhenIndefiniteTextGiven)
+{
+	/* (_ "\xc3\xbc", "x") and (_ "\xc3", "\xbc") */
+	uint8_t ok[] = { 0x7f, 0x62, 0xc3, 0xbc, 0x61, 'x', 0xff };
+	uint8_t split[] = { 0x7f, 0x61, 0xc3, 0x61, 0xbc, 0xff };
+	uint8_t bytes[] = { 0x41, 0xc3 };
+
+	cbor_reader_set_utf8_validation(&reader, true);
+	LONGS_EQUAL(CBOR_BREAK, cbor_parse(&reader, ok, sizeof(ok), NULL));
+	LONGS_EQUAL(CBOR_INVALID,
+		    cbor_parse(&reader, split, sizeof(split), NULL));
+	LONGS_EQUAL(3, reader.msgidx);
+	LONGS_EQUAL(CBOR_SUCCESS,
+		    cbor_parse(&reader, bytes, sizeof(bytes), NULL));
+}
+
+TEST(Decoder, ShouldDecodeNativeIntegers_WhenTypedAccessorsUsed)
+{
+	/* [0, 23, 24, 500, 0x12345678, 0x1122334455667788, -1, -501,
+	 *  -0x8000000000000000, 0xffffffffffffffff, -0xffffffffffffffff-1] */
+	uint8_t m[] = { 0x8b, 0x00, 0x17, 0x18, 0x18, 0x19, 0x01, 0xf4,
+		0x1a, 0x12, 0x34, 0x56, 0x78,
+		0x1b, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88,
+		0x20, 0x39, 0x01, 0xf4,
+		0x3b, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0x1b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0x3b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	const int64_t expected[] = { 0, 23, 24, 500, 0x12345678,
+		0x1122334455667788, -1, -501, INT64_MIN };
+	uint64_t u = 0;
+	int64_t i = 0;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, m, sizeof(m), NULL));
+
+	for (int k = 0; k < 9; k++) {
+		LONGS_EQUAL(CBOR_SUCCESS,
+			    cbor_decode_i64(&reader, &items[k + 1], &i));
+		CHECK(expected[k] == i);
+	}
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode_u64(&reader, &items[6], &u));
+	CHECK(0x1122334455667788ull == u);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode_u64(&reader, &items[10], &u));
+	CHECK(UINT64_MAX == u);
+
+	i = 7;
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_decode_u64(&reader, &items[7], &u));
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_decode_i64(&reader, &items[10], &i));
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_decode_i64(&reader, &items[11], &i));
+	LONGS_EQUAL(7, i);
+	LONGS_EQUAL(CBOR_INVALID, cbor_decode_i64(&reader, &items[0], &i));
+}
+
+TEST(Decoder, ShouldDecodeFloatsAsDouble_WhenTypedAccessorUsed)
+{
+	/* [1.5 (half), -0.1f (single), 1.1 (double), 5.960464477539063e-8, 1] */
+	uint8_t m[] = { 0x85, 0xf9, 0x3e, 0x00,
+		0xfa, 0xbd, 0xcc, 0xcc, 0xcd,
+		0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a,
+		0xf9, 0x00, 0x01, 0x01 };
+	double d = 0;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, m, sizeof(m), NULL));
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode_double(&reader, &items[1], &d));
+	DOUBLES_EQUAL(1.5, d, 0);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode_double(&reader, &items[2], &d));
+	DOUBLES_EQUAL((double)-0.1f, d, 0);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode_double(&reader, &items[3], &d));
+	DOUBLES_EQUAL(1.1, d, 0);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode_double(&reader, &items[4], &d));
+	DOUBLES_EQUAL(5.960464477539063e-8, d, 0);
+	LONGS_EQUAL(CBOR_INVALID, cbor_decode_double(&reader, &items[5], &d));
+}
+
+TEST(Decoder, ShouldDecodeFloat_WhenNoPrecisionLost)
+{
+	/* [1.5 (half), -0.1f (single), 0.25 (double), 1.1 (double), 1e300] */
+	uint8_t m[] = { 0x85, 0xf9, 0x3e, 0x00,
+		0xfa, 0xbd, 0xcc, 0xcc, 0xcd,
+		0xfb, 0x3f, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a,
+		0xfb, 0x7e, 0x37, 0xe4, 0x3c, 0x88, 0x00, 0x75, 0x9c };
+	float f = 0;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, m, sizeof(m), NULL));
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode_float(&reader, &items[1], &f));
+	DOUBLES_EQUAL(1.5, f, 0);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode_float(&reader, &items[2], &f));
+	CHECK(-0.1f == f);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode_float(&reader, &items[3], &f));
+	DOUBLES_EQUAL(0.25, f, 0);
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_decode_float(&reader, &items[4], &f));
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_decode_float(&reader, &items[5], &f));
+	DOUBLES_EQUAL(0.25, f, 0);
+}
+
+TEST(Decoder, ShouldDecodeBoolAndNull_WhenTypedAccessorsUsed)
+{
+	/* [false, true, null, 0] */
+	uint8_t m[] = { 0x84, 0xf4, 0xf5, 0xf6, 0x00 };
+	bool b = true;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, m, sizeof(m), NULL));
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode_bool(&reader, &items[1], &b));
+	CHECK(!b);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode_bool(&reader, &items[2], &b));
+	CHECK(b);
+	LONGS_EQUAL(CBOR_INVALID, cbor_decode_bool(&reader, &items[3], &b));
+	LONGS_EQUAL(CBOR_INVALID, cbor_decode_bool(&reader, &items[4], &b));
+	CHECK(cbor_decode_is_null(&reader, &items[3]));
+	CHECK(!cbor_decode_is_null(&reader, &items[4]));
+}
+
+TEST(Decoder, ShouldDecodeArrayInBulk_WhenElementsShareWidth)
+{
+	/* [1000, 1001, 1002, 70000, 7, 24] */
+	uint8_t m[] = { 0x86, 0x19, 0x03, 0xe8, 0x19, 0x03, 0xe9,
+		0x19, 0x03, 0xea, 0x1a, 0x00, 0x01, 0x11, 0x70, 0x07,
+		0x18, 0x18 };
+	const uint32_t expected[] = { 1000, 1001, 1002, 70000, 7, 24 };
+	uint32_t out[8] = { 0, };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, m, sizeof(m), NULL));
+	LONGS_EQUAL(CBOR_SUCCESS,
+		    cbor_decode_array_u32(&reader, &items[0], out, 8, &n));
+	LONGS_EQUAL(6, n);
+	MEMCMP_EQUAL(expected, out, sizeof(expected));
+
+	LONGS_EQUAL(CBOR_OVERRUN,
+		    cbor_decode_array_u32(&reader, &items[0], out, 5, &n));
+	LONGS_EQUAL(CBOR_INVALID,
+		    cbor_decode_array_u32(&reader, &items[1], out, 8, &n));
+}
+
+TEST(Decoder, ShouldDecodeArrayInBulk_WhenSmallAndMixedSignValuesGiven)
+{
+	/* [3, 7, 1, 1000, 1001, 23, 0] */
+	uint8_t u[] = { 0x87, 0x03, 0x07, 0x01, 0x19, 0x03, 0xe8,
+		0x19, 0x03, 0xe9, 0x17, 0x00 };
+	/* [3, -7, 1, 0x10000000000, -2, 70000, -70000, -5] */
+	uint8_t i[] = { 0x88, 0x03, 0x26, 0x01,
+		0x1b, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x21, 0x1a, 0x00, 0x01, 0x11, 0x70,
+		0x3a, 0x00, 0x01, 0x11, 0x6f, 0x24 };
+	const uint32_t u_expected[] = { 3, 7, 1, 1000, 1001, 23, 0 };
+	const int64_t i_expected[] = {
+		3, -7, 1, 0x10000000000, -2, 70000, -70000, -5 };
+	uint32_t u_out[8] = { 0, };
+	int64_t i_out[8] = { 0, };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, u, sizeof(u), NULL));
+	LONGS_EQUAL(CBOR_SUCCESS,
+		    cbor_decode_array_u32(&reader, &items[0], u_out, 8, &n));
+	LONGS_EQUAL(7, n);
+	MEMCMP_EQUAL(u_expected, u_out, sizeof(u_expected));
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, i, sizeof(i), NULL));
+	LONGS_EQUAL(CBOR_SUCCESS,
+		    cbor_decode_array_i64(&reader, &items[0], i_out, 8, &n));
+	LONGS_EQUAL(8, n);
+	MEMCMP_EQUAL(i_expected, i_out, sizeof(i_expected));
+}
+
+TEST(Decoder, ShouldDecodeIndefiniteArray_WhenIntegersGiven)
+{
+	/* [_ -1, -2, -3, 4, -0x100000000] */
+	uint8_t m[] = { 0x9f, 0x20, 0x21, 0x22, 0x04,
+		0x3b, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff };
+	const int64_t expected[] = { -1, -2, -3, 4, -0x100000000 };
+	int64_t out[5] = { 0, };
+	uint32_t u[5] = { 0, };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_BREAK, cbor_parse(&reader, m, sizeof(m), NULL));
+	LONGS_EQUAL(CBOR_SUCCESS,
+		    cbor_decode_array_i64(&reader, &items[0], out, 5, &n));
+	LONGS_EQUAL(5, n);
+	MEMCMP_EQUAL(expected, out, sizeof(expected));
+
+	LONGS_EQUAL(CBOR_OVERRUN,
+		    cbor_decode_array_u32(&reader, &items[0], u, 5, &n));
+	LONGS_EQUAL(0, n);
+}
+
+TEST(Decoder, ShouldStopAtOffendingElement_WhenArrayIsNotNumeric)
+{
+	/* [1, 2, "a", 3] and [1, [2]] */
+	uint8_t m[] = { 0x84, 0x01, 0x02, 0x61, 'a', 0x03 };
+	uint8_t nested[] = { 0x82, 0x01, 0x81, 0x02 };
+	int64_t out[4] = { 0, };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, m, sizeof(m), NULL));
+	LONGS_EQUAL(CBOR_INVALID,
+		    cbor_decode_array_i64(&reader, &items[0], out, 4, &n));
+	LONGS_EQUAL(2, n);
+	LONGS_EQUAL(2, out[1]);
+
+	LONGS_EQUAL(CBOR_SUCCESS,
+		    cbor_parse(&reader, nested, sizeof(nested), NULL));
+	LONGS_EQUAL(CBOR_INVALID,
+		    cbor_decode_array_i64(&reader, &items[0], out, 4, &n));
+	LONGS_EQUAL(1, n);
+}
+
+TEST(Decoder, ShouldDecodeFloatArrays_WhenMixedPrecisionGiven)
+{
+	/* [1.5 (half), 2.5 (half), -0.1f (single), 1.1 (double)] */
+	uint8_t m[] = { 0x84, 0xf9, 0x3e, 0x00, 0xf9, 0x41, 0x00,
+		0xfa, 0xbd, 0xcc, 0xcc, 0xcd,
+		0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a };
+	double d[4] = { 0, };
+	float f[4] = { 0, };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, m, sizeof(m), NULL));
+	LONGS_EQUAL(CBOR_SUCCESS,
+		    cbor_decode_array_f64(&reader, &items[0], d, 4, &n));
+	LONGS_EQUAL(4, n);
+	DOUBLES_EQUAL(1.5, d[0], 0);
+	DOUBLES_EQUAL(2.5, d[1], 0);
+	DOUBLES_EQUAL((double)-0.1f, d[2], 0);
+	DOUBLES_EQUAL(1.1, d[3], 0);
+
+	LONGS_EQUAL(CBOR_OVERRUN,
+		    cbor_decode_array_f32(&reader, &items[0], f, 4, &n));
+	LONGS_EQUAL(3, n);
+	CHECK(-0.1f == f[2]);
+}
@@ -0,0 +1,191 @@
+#include "CppUTest/TestHarness.h"
+
+#include <string.h>
+
+#include "cbor/encoder.h"
+
+static bool collect(void const *data, size_t datasize, void *arg)
+{
+	size_t *total = static_cast<size_t *>(arg);
+	(void)data;
+	*total += datasize;
+	return true;
+}
+
+TEST_GROUP(EncoderDeferred) {
+	cbor_writer_t writer;
+	cbor_writer_frame_t frames[4];
+	uint8_t buf[256];
+
+	void setup(void) {
+		memset(buf, 0, sizeof(buf));
+		cbor_writer_init(&writer, buf, sizeof(buf));
+		cbor_writer_set_frames(&writer, frames, 4);
+	}
+};
+
+TEST(EncoderDeferred, ShouldWriteHeaderInPlace_WhenFewItemsGiven)
+{
+	const uint8_t expected[] = { 0x83, 0x01, 0x02, 0x03 };
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_begin(&writer));
+	for (uint64_t i = 1; i <= 3; i++) {
+		LONGS_EQUAL(CBOR_SUCCESS,
+				cbor_encode_unsigned_integer(&writer, i));
+	}
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_end(&writer));
+
+	LONGS_EQUAL(sizeof(expected), cbor_writer_len(&writer));
+	MEMCMP_EQUAL(expected, buf, sizeof(expected));
+	LONGS_EQUAL(0, writer.depth);
+}
+
+TEST(EncoderDeferred, ShouldMoveBody_WhenHeaderTakesMoreThanOneByte)
+{
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_begin(&writer));
+	for (int i = 0; i < 30; i++) {
+		LONGS_EQUAL(CBOR_SUCCESS,
+				cbor_encode_unsigned_integer(&writer, 7));
+	}
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_end(&writer));
+
+	LONGS_EQUAL(32, cbor_writer_len(&writer));
+	LONGS_EQUAL(0x98, buf[0]);
+	LONGS_EQUAL(30, buf[1]);
+	for (int i = 0; i < 30; i++) {
+		LONGS_EQUAL(7, buf[2 + i]);
+	}
+}
+
+TEST(EncoderDeferred, ShouldCountPairs_WhenNestedMapGiven)
+{
+	/* {"a": [1, [], {_ }], "b": 0("x")} */
+	const uint8_t expected[] = {
+		0xa2, 0x61, 'a', 0x83, 0x01, 0x80, 0xbf, 0xff,
+		0x61, 'b', 0xc0, 0x61, 'x',
+	};
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_map_begin(&writer));
+	cbor_encode_text_string(&writer, "a", 1);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_begin(&writer));
+	cbor_encode_unsigned_integer(&writer, 1);
+	cbor_encode_array(&writer, 0);
+	cbor_encode_map_indefinite(&writer);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_break(&writer));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_end(&writer));
+	cbor_encode_text_string(&writer, "b", 1);
+	cbor_encode_tag(&writer, 0);
+	cbor_encode_text_string(&writer, "x", 1);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_map_end(&writer));
+
+	LONGS_EQUAL(sizeof(expected), cbor_writer_len(&writer));
+	MEMCMP_EQUAL(expected, buf, sizeof(expected));
+}
+
+TEST(EncoderDeferred, ShouldCountDefiniteContainerAsOneItem)
+{
+	/* [[1, 2], {3: 4}, 1.5] */
+	const uint8_t expected[] = {
+		0x83, 0x82, 0x01, 0x02, 0xa1, 0x03, 0x04, 0xf9, 0x3e, 0x00,
+	};
+
+	cbor_encode_array_begin(&writer);
+	cbor_encode_array(&writer, 2);
+	cbor_encode_unsigned_integer(&writer, 1);
+	cbor_encode_unsigned_integer(&writer, 2);
+	cbor_encode_map(&writer, 1);
+	cbor_encode_unsigned_integer(&writer, 3);
+	cbor_encode_unsigned_integer(&writer, 4);
+	cbor_encode_float(&writer, 1.5f);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_end(&writer));
+
+	LONGS_EQUAL(sizeof(expected), cbor_writer_len(&writer));
+	MEMCMP_EQUAL(expected, buf, sizeof(expected));
+}
+
+TEST(EncoderDeferred, ShouldReturnInvalid_WhenEndDoesNotMatch)
+{
+	cbor_writer_t untracked;
+
+	cbor_writer_init(&untracked, buf, sizeof(buf));
+	LONGS_EQUAL(CBOR_INVALID, cbor_encode_array_begin(&untracked));
+
+	LONGS_EQUAL(CBOR_INVALID, cbor_encode_array_end(&writer));
+	LONGS_EQUAL(CBOR_INVALID, cbor_encode_break(&writer));
+
+	cbor_encode_map_begin(&writer);
+	LONGS_EQUAL(CBOR_INVALID, cbor_encode_array_end(&writer));
+	LONGS_EQUAL(CBOR_INVALID, cbor_encode_break(&writer));
+	cbor_encode_unsigned_integer(&writer, 1);
+	LONGS_EQUAL(CBOR_INVALID, cbor_encode_map_end(&writer));
+	cbor_encode_unsigned_integer(&writer, 2);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_map_end(&writer));
+	LONGS_EQUAL(3, cbor_writer_len(&writer));
+}
+
+TEST(EncoderDeferred, ShouldReturnExcessive_WhenNestedTooDeep)
+{
+	const uint64_t values[] = { 1 };
+
+	for (int i = 0; i < 4; i++) {
+		LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_begin(&writer));
+	}
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_encode_array_begin(&writer));
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_encode_array(&writer, 1));
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_encode_array_indefinite(&writer));
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_encode_array_u64(&writer, values, 1));
+	LONGS_EQUAL(4, cbor_writer_len(&writer));
+
+	for (int i = 0; i < 4; i++) {
+		LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_end(&writer));
+	}
+	LONGS_EQUAL(0x81, buf[0]);
+	LONGS_EQUAL(0x80, buf[3]);
+}
+
+TEST(EncoderDeferred, ShouldMeasureSize_WhenDryRun)
+{
+	cbor_writer_t measure;
+
+	cbor_writer_init_dry_run(&measure);
+	cbor_writer_set_frames(&measure, frames, 4);
+
+	cbor_encode_array_begin(&measure);
+	for (int i = 0; i < 300; i++) {
+		cbor_encode_unsigned_integer(&measure, 1);
+	}
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_end(&measure));
+
+	LONGS_EQUAL(303, cbor_writer_len(&measure));
+}
+
+TEST(EncoderDeferred, ShouldHoldBuffer_WhileDeferredContainerOpen)
+{
+	uint8_t small[8];
+	size_t total = 0;
+
+	cbor_writer_init(&writer, small, sizeof(small));
+	cbor_writer_set_frames(&writer, frames, 4);
+	cbor_writer_set_sink(&writer, collect, &total);
+
+	cbor_encode_array(&writer, 7);
+	for (int i = 0; i < 7; i++) {
+		cbor_encode_unsigned_integer(&writer, 1);
+	}
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_begin(&writer));
+	LONGS_EQUAL(8, total);
+
+	for (int i = 0; i < 7; i++) {
+		LONGS_EQUAL(CBOR_SUCCESS,
+				cbor_encode_unsigned_integer(&writer, 1));
+	}
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_encode_unsigned_integer(&writer, 1));
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_encode_text_string(&writer,
+				"0123456789", 10));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_end(&writer));
+	LONGS_EQUAL(8, total);
+	LONGS_EQUAL(0x87, small[0]);
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_writer_flush(&writer));
+	LONGS_EQUAL(16, total);
+}
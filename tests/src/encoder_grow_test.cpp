@@ -0,0 +1,120 @@
+#include "CppUTest/TestHarness.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cbor/encoder.h"
+
+struct arena {
+	uint8_t mem[512];
+	size_t used;
+	int calls;
+};
+
+/* a bump allocator, handing out a new block on every call */
+static void *grow_in_arena(void *buf, size_t used, size_t newsize, void *arg)
+{
+	struct arena *arena = static_cast<struct arena *>(arg);
+	uint8_t *p = &arena->mem[arena->used];
+
+	arena->calls++;
+
+	if (newsize > sizeof(arena->mem) - arena->used) {
+		return NULL;
+	}
+
+	memcpy(p, buf, used);
+	arena->used += newsize;
+
+	return p;
+}
+
+static void *grow_with_realloc(void *buf, size_t used, size_t newsize,
+		void *arg)
+{
+	(void)used;
+	(*static_cast<int *>(arg))++;
+	return realloc(buf, newsize);
+}
+
+static bool collect(void const *data, size_t datasize, void *arg)
+{
+	size_t *total = static_cast<size_t *>(arg);
+	(void)data;
+	*total += datasize;
+	return true;
+}
+
+static void encode_sample(cbor_writer_t *writer)
+{
+	cbor_encode_array(writer, 20);
+	for (int i = 0; i < 20; i++) {
+		cbor_encode_text_string(writer, "value", 5);
+	}
+}
+
+TEST_GROUP(EncoderGrow) {
+	cbor_writer_t writer;
+	uint8_t expected[256];
+	size_t expected_len;
+
+	void setup(void) {
+		cbor_writer_t fixed;
+
+		cbor_writer_init(&fixed, expected, sizeof(expected));
+		encode_sample(&fixed);
+		expected_len = cbor_writer_len(&fixed);
+	}
+};
+
+TEST(EncoderGrow, ShouldGrowGeometrically_WhenReallocGiven)
+{
+	int calls = 0;
+
+	cbor_writer_init(&writer, malloc(4), 4);
+	cbor_writer_set_grow(&writer, grow_with_realloc, &calls);
+
+	encode_sample(&writer);
+
+	LONGS_EQUAL(expected_len, cbor_writer_len(&writer));
+	MEMCMP_EQUAL(expected, cbor_writer_get_encoded(&writer), expected_len);
+	LONGS_EQUAL(128, writer.bufsize);
+	LONGS_EQUAL(5, calls);
+
+	free(writer.buf);
+}
+
+TEST(EncoderGrow, ShouldReturnOverrun_WhenAllocatorFails)
+{
+	struct arena arena = { { 0, }, 0, 0 };
+	uint8_t buf[4];
+
+	cbor_writer_init(&writer, buf, sizeof(buf));
+	cbor_writer_set_grow(&writer, grow_in_arena, &arena);
+
+	encode_sample(&writer);
+	LONGS_EQUAL(expected_len, cbor_writer_len(&writer));
+	MEMCMP_EQUAL(expected, cbor_writer_get_encoded(&writer), expected_len);
+
+	arena.used = sizeof(arena.mem);
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_encode_byte_string(&writer,
+				arena.mem, sizeof(arena.mem)));
+	LONGS_EQUAL(expected_len, cbor_writer_len(&writer));
+	MEMCMP_EQUAL(expected, cbor_writer_get_encoded(&writer), expected_len);
+}
+
+TEST(EncoderGrow, ShouldFallBackToSink_WhenAllocatorFails)
+{
+	struct arena arena = { { 0, }, sizeof(arena.mem), 0 };
+	uint8_t buf[16];
+	size_t total = 0;
+
+	cbor_writer_init(&writer, buf, sizeof(buf));
+	cbor_writer_set_grow(&writer, grow_in_arena, &arena);
+	cbor_writer_set_sink(&writer, collect, &total);
+
+	encode_sample(&writer);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_writer_flush(&writer));
+	LONGS_EQUAL(expected_len, total);
+	CHECK(arena.calls > 0);
+}
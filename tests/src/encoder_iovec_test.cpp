@@ -0,0 +1,115 @@
+#include "CppUTest/TestHarness.h"
+
+#include <string.h>
+
+#include "cbor/encoder.h"
+
+static size_t gather(cbor_iovec_t const *iov, size_t niov,
+		uint8_t *out, size_t outsize)
+{
+	size_t len = 0;
+
+	for (size_t i = 0; i < niov; i++) {
+		CHECK(len + iov[i].len <= outsize);
+		memcpy(&out[len], iov[i].base, iov[i].len);
+		len += iov[i].len;
+	}
+
+	return len;
+}
+
+static void encode_sample(cbor_writer_t *writer, uint8_t const *blob,
+		size_t blobsize)
+{
+	cbor_encode_array(writer, 4);
+	cbor_encode_byte_string(writer, blob, blobsize);
+	cbor_encode_text_string(writer, "tiny", 4);
+	cbor_encode_byte_string(writer, blob, blobsize);
+	cbor_encode_unsigned_integer(writer, 1000);
+}
+
+TEST_GROUP(EncoderIovec) {
+	cbor_writer_t writer;
+	cbor_iovec_t iov[8];
+	uint8_t buf[64];
+	uint8_t blob[300];
+	uint8_t expected[1024];
+	size_t expected_len;
+
+	void setup(void) {
+		cbor_writer_t copied;
+
+		for (size_t i = 0; i < sizeof(blob); i++) {
+			blob[i] = (uint8_t)i;
+		}
+
+		cbor_writer_init(&copied, expected, sizeof(expected));
+		encode_sample(&copied, blob, sizeof(blob));
+		expected_len = cbor_writer_len(&copied);
+
+		cbor_writer_init(&writer, buf, sizeof(buf));
+	}
+};
+
+TEST(EncoderIovec, ShouldReferToPayloads_WhenLargerThanThreshold)
+{
+	uint8_t out[1024];
+
+	cbor_writer_set_iovec(&writer, iov, 8, 16);
+	encode_sample(&writer, blob, sizeof(blob));
+
+	LONGS_EQUAL(5, cbor_writer_finish_iovec(&writer));
+	POINTERS_EQUAL(blob, iov[1].base);
+	LONGS_EQUAL(sizeof(blob), iov[1].len);
+	POINTERS_EQUAL(blob, iov[3].base);
+	/* only the headers and the small items are copied */
+	LONGS_EQUAL(1 + 3 + 5 + 3 + 3, cbor_writer_len(&writer));
+
+	LONGS_EQUAL(expected_len, gather(iov, 5, out, sizeof(out)));
+	MEMCMP_EQUAL(expected, out, expected_len);
+}
+
+TEST(EncoderIovec, ShouldCopy_WhenPayloadBelowThreshold)
+{
+	uint8_t out[1024];
+	uint8_t large[1024];
+
+	cbor_writer_init(&writer, large, sizeof(large));
+	cbor_writer_set_iovec(&writer, iov, 8, sizeof(blob) + 1);
+	encode_sample(&writer, blob, sizeof(blob));
+
+	LONGS_EQUAL(1, cbor_writer_finish_iovec(&writer));
+	POINTERS_EQUAL(large, iov[0].base);
+	LONGS_EQUAL(expected_len, gather(iov, 1, out, sizeof(out)));
+	MEMCMP_EQUAL(expected, out, expected_len);
+}
+
+TEST(EncoderIovec, ShouldCopy_WhenSpansRunOut)
+{
+	uint8_t out[1024];
+	uint8_t large[1024];
+
+	cbor_writer_init(&writer, large, sizeof(large));
+	cbor_writer_set_iovec(&writer, iov, 4, 16);
+	encode_sample(&writer, blob, sizeof(blob));
+
+	LONGS_EQUAL(3, cbor_writer_finish_iovec(&writer));
+	POINTERS_EQUAL(blob, iov[1].base);
+	LONGS_EQUAL(expected_len, gather(iov, 3, out, sizeof(out)));
+	MEMCMP_EQUAL(expected, out, expected_len);
+}
+
+TEST(EncoderIovec, ShouldReturnOverrun_WhenHeaderDoesNotFit)
+{
+	uint8_t small[2];
+
+	cbor_writer_init(&writer, small, sizeof(small));
+	cbor_writer_set_iovec(&writer, iov, 8, 16);
+
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_encode_byte_string(&writer,
+				blob, sizeof(blob)));
+	LONGS_EQUAL(0, cbor_writer_finish_iovec(&writer));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_byte_string(&writer, blob, 16));
+	LONGS_EQUAL(2, cbor_writer_finish_iovec(&writer));
+	LONGS_EQUAL(1, cbor_writer_len(&writer));
+}
@@ -0,0 +1,127 @@
+#include "CppUTest/TestHarness.h"
+
+#include <string.h>
+
+#include "cbor/encoder.h"
+
+struct sink_log {
+	uint8_t out[256];
+	size_t len;
+	int calls;
+	void const *last;
+	int fail_at;
+};
+
+static bool collect(void const *data, size_t datasize, void *arg)
+{
+	struct sink_log *log = static_cast<struct sink_log *>(arg);
+
+	if (++log->calls == log->fail_at) {
+		return false;
+	}
+
+	memcpy(&log->out[log->len], data, datasize);
+	log->len += datasize;
+	log->last = data;
+
+	return true;
+}
+
+static void encode_sample(cbor_writer_t *writer)
+{
+	cbor_encode_map(writer, 3);
+	cbor_encode_text_string(writer, "id", 2);
+	cbor_encode_unsigned_integer(writer, 0x12345678);
+	cbor_encode_text_string(writer, "temperature", 11);
+	cbor_encode_double(writer, 1.1);
+	cbor_encode_text_string(writer, "list", 4);
+	cbor_encode_array_indefinite(writer);
+	for (int i = 0; i < 10; i++) {
+		cbor_encode_negative_integer(writer, -1000 - i);
+	}
+	cbor_encode_float(writer, 1.5f);
+	cbor_encode_break(writer);
+}
+
+TEST_GROUP(EncoderSink) {
+	cbor_writer_t writer;
+	uint8_t buf[16];
+	struct sink_log log;
+
+	void setup(void) {
+		memset(&log, 0, sizeof(log));
+		cbor_writer_init(&writer, buf, sizeof(buf));
+		cbor_writer_set_sink(&writer, collect, &log);
+	}
+};
+
+TEST(EncoderSink, ShouldProduceSameBytes_WhenBufferIsSmallerThanMessage)
+{
+	uint8_t expected[256];
+	cbor_writer_t fixed;
+
+	cbor_writer_init(&fixed, expected, sizeof(expected));
+	encode_sample(&fixed);
+
+	encode_sample(&writer);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_writer_flush(&writer));
+
+	LONGS_EQUAL(cbor_writer_len(&fixed), log.len);
+	LONGS_EQUAL(log.len, writer.flushed);
+	LONGS_EQUAL(0, cbor_writer_len(&writer));
+	MEMCMP_EQUAL(expected, log.out, log.len);
+	CHECK(log.calls > 1);
+}
+
+TEST(EncoderSink, ShouldPassLargeStringStraightToSink)
+{
+	uint8_t data[40];
+	const uint8_t header[] = { 0x01, 0x58, 0x28 };
+
+	memset(data, 0x5a, sizeof(data));
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_unsigned_integer(&writer, 1));
+	LONGS_EQUAL(CBOR_SUCCESS,
+		    cbor_encode_byte_string(&writer, data, sizeof(data)));
+
+	LONGS_EQUAL(2, log.calls);
+	POINTERS_EQUAL(data, log.last);
+	LONGS_EQUAL(sizeof(header) + sizeof(data), log.len);
+	MEMCMP_EQUAL(header, log.out, sizeof(header));
+	MEMCMP_EQUAL(data, &log.out[sizeof(header)], sizeof(data));
+}
+
+TEST(EncoderSink, ShouldEncodeLongNullTerminatedText)
+{
+	const char *text = "a text longer than the writer buffer";
+
+	LONGS_EQUAL(CBOR_SUCCESS,
+		    cbor_encode_null_terminated_text_string(&writer, text));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_writer_flush(&writer));
+	LONGS_EQUAL(strlen(text) + 2, log.len);
+	MEMCMP_EQUAL(text, &log.out[2], strlen(text));
+}
+
+TEST(EncoderSink, ShouldReturnAborted_WhenSinkReturnsFalse)
+{
+	log.fail_at = 1;
+
+	for (int i = 0; i < 5; i++) {
+		LONGS_EQUAL(CBOR_SUCCESS,
+			    cbor_encode_unsigned_integer(&writer, 1000));
+	}
+	LONGS_EQUAL(CBOR_ABORTED, cbor_encode_unsigned_integer(&writer, 1000));
+	LONGS_EQUAL(15, cbor_writer_len(&writer));
+	LONGS_EQUAL(0, writer.flushed);
+}
+
+TEST(EncoderSink, ShouldReturnInvalid_WhenFlushedWithoutSink)
+{
+	cbor_writer_init(&writer, buf, sizeof(buf));
+
+	LONGS_EQUAL(CBOR_INVALID, cbor_writer_flush(&writer));
+	for (int i = 0; i < 5; i++) {
+		cbor_encode_unsigned_integer(&writer, 1000);
+	}
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_encode_unsigned_integer(&writer, 1000));
+}
@@ -0,0 +1,147 @@
+#include "CppUTest/TestHarness.h"
+
+#include <string.h>
+
+#include "cbor/encoder.h"
+
+TEST_GROUP(EncoderSorted) {
+	cbor_writer_t writer;
+	cbor_writer_frame_t frames[4];
+	size_t scratch[256];
+	uint8_t buf[256];
+
+	void setup(void) {
+		cbor_writer_init(&writer, buf, sizeof(buf));
+		cbor_writer_set_frames(&writer, frames, 4);
+		cbor_writer_set_scratch(&writer, scratch, sizeof(scratch));
+	}
+};
+
+TEST(EncoderSorted, ShouldSortEntriesByEncodedKey)
+{
+	/* RFC 8949 §4.2.1: 10, 100, -1, "z", "aa", [100], [-1], false */
+	const uint8_t expected[] = {
+		0xa8, 0x0a, 0x00, 0x18, 0x64, 0x01, 0x20, 0x02,
+		0x61, 'z', 0x03, 0x62, 'a', 'a', 0x04,
+		0x81, 0x18, 0x64, 0x05, 0x81, 0x20, 0x06, 0xf4, 0x07,
+	};
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_sorted_map_begin(&writer));
+	cbor_encode_bool(&writer, false);
+	cbor_encode_unsigned_integer(&writer, 7);
+	cbor_encode_array(&writer, 1);
+	cbor_encode_negative_integer(&writer, -1);
+	cbor_encode_unsigned_integer(&writer, 6);
+	cbor_encode_text_string(&writer, "aa", 2);
+	cbor_encode_unsigned_integer(&writer, 4);
+	cbor_encode_unsigned_integer(&writer, 100);
+	cbor_encode_unsigned_integer(&writer, 1);
+	cbor_encode_array(&writer, 1);
+	cbor_encode_unsigned_integer(&writer, 100);
+	cbor_encode_unsigned_integer(&writer, 5);
+	cbor_encode_text_string(&writer, "z", 1);
+	cbor_encode_unsigned_integer(&writer, 3);
+	cbor_encode_negative_integer(&writer, -1);
+	cbor_encode_unsigned_integer(&writer, 2);
+	cbor_encode_unsigned_integer(&writer, 10);
+	cbor_encode_unsigned_integer(&writer, 0);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_map_end(&writer));
+
+	LONGS_EQUAL(sizeof(expected), cbor_writer_len(&writer));
+	MEMCMP_EQUAL(expected, buf, sizeof(expected));
+	LONGS_EQUAL(0, writer.scratch_used);
+}
+
+TEST(EncoderSorted, ShouldSortNestedMaps)
+{
+	/* {"a": {1: 2, 3: 4}, "b": [{5: 6}]} with maps given unsorted */
+	const uint8_t expected[] = {
+		0xa2, 0x61, 'a', 0xa2, 0x01, 0x02, 0x03, 0x04,
+		0x61, 'b', 0x81, 0xa1, 0x05, 0x06,
+	};
+
+	cbor_encode_sorted_map_begin(&writer);
+	cbor_encode_text_string(&writer, "b", 1);
+	cbor_encode_array(&writer, 1);
+	cbor_encode_sorted_map_begin(&writer);
+	cbor_encode_unsigned_integer(&writer, 5);
+	cbor_encode_unsigned_integer(&writer, 6);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_map_end(&writer));
+	cbor_encode_text_string(&writer, "a", 1);
+	cbor_encode_sorted_map_begin(&writer);
+	cbor_encode_unsigned_integer(&writer, 3);
+	cbor_encode_unsigned_integer(&writer, 4);
+	cbor_encode_unsigned_integer(&writer, 1);
+	cbor_encode_unsigned_integer(&writer, 2);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_map_end(&writer));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_map_end(&writer));
+
+	LONGS_EQUAL(sizeof(expected), cbor_writer_len(&writer));
+	MEMCMP_EQUAL(expected, buf, sizeof(expected));
+}
+
+TEST(EncoderSorted, ShouldMoveBody_WhenMoreThan23Entries)
+{
+	cbor_encode_sorted_map_begin(&writer);
+	for (uint64_t i = 30; i > 0; i--) {
+		cbor_encode_unsigned_integer(&writer, i - 1);
+		cbor_encode_bool(&writer, true);
+	}
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_map_end(&writer));
+
+	LONGS_EQUAL(0xb8, buf[0]);
+	LONGS_EQUAL(30, buf[1]);
+	for (int i = 0; i < 24; i++) {
+		LONGS_EQUAL(i, buf[2 + i * 2]);
+	}
+	LONGS_EQUAL(0x18, buf[2 + 24 * 2]);
+	LONGS_EQUAL(24, buf[2 + 24 * 2 + 1]);
+}
+
+TEST(EncoderSorted, ShouldReturnInvalid_WhenKeyDuplicated)
+{
+	cbor_encode_sorted_map_begin(&writer);
+	cbor_encode_text_string(&writer, "k", 1);
+	cbor_encode_unsigned_integer(&writer, 1);
+	cbor_encode_text_string(&writer, "k", 1);
+	cbor_encode_unsigned_integer(&writer, 2);
+
+	LONGS_EQUAL(CBOR_INVALID, cbor_encode_map_end(&writer));
+}
+
+TEST(EncoderSorted, ShouldReturnExcessive_WhenScratchNotEnough)
+{
+	size_t small[4];
+
+	cbor_writer_set_scratch(&writer, small, sizeof(small));
+	cbor_encode_sorted_map_begin(&writer);
+	cbor_encode_unsigned_integer(&writer, 2);
+	cbor_encode_unsigned_integer(&writer, 0);
+	cbor_encode_unsigned_integer(&writer, 1);
+	cbor_encode_unsigned_integer(&writer, 0);
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_encode_map_end(&writer));
+}
+
+TEST(EncoderSorted, ShouldReturnInvalid_WhenNoScratchGiven)
+{
+	cbor_writer_set_scratch(&writer, NULL, 0);
+	LONGS_EQUAL(CBOR_INVALID, cbor_encode_sorted_map_begin(&writer));
+}
+
+TEST(EncoderSorted, ShouldMeasureSize_WhenDryRun)
+{
+	cbor_writer_t measure;
+
+	cbor_writer_init_dry_run(&measure);
+	cbor_writer_set_frames(&measure, frames, 4);
+	cbor_writer_set_scratch(&measure, scratch, sizeof(scratch));
+
+	cbor_encode_sorted_map_begin(&measure);
+	cbor_encode_text_string(&measure, "b", 1);
+	cbor_encode_unsigned_integer(&measure, 1000);
+	cbor_encode_text_string(&measure, "a", 1);
+	cbor_encode_null(&measure);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_map_end(&measure));
+
+	LONGS_EQUAL(1 + 2 + 3 + 2 + 1, cbor_writer_len(&measure));
+}
@@ -462,6 +462,33 @@ TEST(Encoder, WhenHalfPrecisionFloatGiven) {
 	LONGS_EQUAL(3, writer.bufidx);
 	MEMCMP_EQUAL(expected, writer.buf, sizeof(expected));
 }
+TEST(Encoder, WhenHalfSubnormalDoubleGiven) {
+	const uint8_t expected[] = { 0xf9,0x00,0x10 };
+	cbor_encode_double(&writer, 9.5367431640625e-07); /* 2^-20 */
+	LONGS_EQUAL(3, writer.bufidx);
+	MEMCMP_EQUAL(expected, writer.buf, sizeof(expected));
+}
+TEST(Encoder, ShouldKeepSingle_WhenHalfSubnormalLosesPrecision) {
+	const uint8_t expected[] = { 0xfa,0x38,0x00,0x20,0x00 };
+	cbor_encode_double(&writer, 3.0547380447387695e-05); /* 1025*2^-25 */
+	LONGS_EQUAL(5, writer.bufidx);
+	MEMCMP_EQUAL(expected, writer.buf, sizeof(expected));
+}
+TEST(Encoder, ShouldKeepDouble_WhenDoubleSubnormalGiven) {
+	const uint8_t expected[] = { 0xfb,0,0,0,0,0,0,0,0x01 };
+	cbor_encode_double(&writer, 4.9406564584124654e-324);
+	LONGS_EQUAL(9, writer.bufidx);
+	MEMCMP_EQUAL(expected, writer.buf, sizeof(expected));
+}
+TEST(Encoder, ShouldKeepNaNPayload_WhenHalfHasNoRoomForIt) {
+	const uint8_t expected[] = { 0xfa,0x7f,0x80,0x00,0x01 };
+	const uint32_t bits = 0x7f800001;
+	float nan;
+	memcpy(&nan, &bits, sizeof(nan));
+	cbor_encode_float(&writer, nan);
+	LONGS_EQUAL(5, writer.bufidx);
+	MEMCMP_EQUAL(expected, writer.buf, sizeof(expected));
+}
 
 TEST(Encoder, WhenSinglePrecisionFloatGiven) {
 	const uint8_t expected[] = { 0xfa,0x47,0xc3,0x50,0x00 };
@@ -570,3 +597,181 @@ TEST(Encoder, ShouldReturnOverrun_WhenDoubleDoesNotFit) {
 	LONGS_EQUAL(0, small_writer.bufidx);
 	MEMCMP_EQUAL(before, small_buffer, sizeof(before));
 }
+
+static void encode_mixed(cbor_writer_t *writer)
+{
+	static const uint8_t blob[300] = { 0, };
+
+	cbor_encode_map(writer, 4);
+	cbor_encode_null_terminated_text_string(writer, "half");
+	cbor_encode_double(writer, 1.5);
+	cbor_encode_null_terminated_text_string(writer, "single");
+	cbor_encode_double(writer, 1.1f);
+	cbor_encode_text_string(writer, "double", 6);
+	cbor_encode_double(writer, 1.1);
+	cbor_encode_tag(writer, 24);
+	cbor_encode_byte_string(writer, blob, sizeof(blob));
+	cbor_encode_array_indefinite(writer);
+	cbor_encode_negative_integer(writer, -100000);
+	cbor_encode_unsigned_integer(writer, 0x100000000ull);
+	cbor_encode_float(writer, -0.0f);
+	cbor_encode_break(writer);
+}
+
+TEST(Encoder, ShouldMeasureExactSize_WhenDryRun) {
+	cbor_writer_t measure;
+
+	cbor_writer_init_dry_run(&measure);
+	encode_mixed(&measure);
+	encode_mixed(&writer);
+
+	LONGS_EQUAL(cbor_writer_len(&writer), cbor_writer_len(&measure));
+	LONGS_EQUAL(361, cbor_writer_len(&measure));
+}
+
+TEST(Encoder, ShouldWriteNothing_WhenDryRun) {
+	cbor_writer_t measure;
+
+	cbor_writer_init_dry_run(&measure);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_unsigned_integer(&measure, 1000));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_double(&measure, 3.14));
+	LONGS_EQUAL(12, cbor_writer_len(&measure));
+	LONGS_EQUAL(0, *cbor_writer_get_encoded(&measure));
+}
+
+static const uint64_t bulk_u64[] = {
+	0, 23, 24, 255, 256, 65535, 65536, 0xffffffffull, 0x100000000ull,
+	UINT64_MAX,
+};
+static const int64_t bulk_i64[] = {
+	0, -1, -24, -25, -256, -257, 65535, -65537, INT64_MIN, INT64_MAX,
+};
+static const double bulk_f64[] = {
+	0.0, -0.0, 1.5, 65504.0, 1.1, 1.1f, 1e300, 5.960464477539063e-8,
+	INFINITY, -INFINITY, NAN, 1e-300,
+};
+
+TEST(Encoder, ShouldMatchPerElementEncoding_WhenBulkArrayGiven) {
+	cbor_writer_t bulk;
+	uint8_t buf[1024];
+	float f32[sizeof(bulk_f64) / sizeof(*bulk_f64)];
+	const size_t nf = sizeof(f32) / sizeof(*f32);
+
+	for (size_t i = 0; i < nf; i++) {
+		f32[i] = (float)bulk_f64[i];
+	}
+
+	cbor_encode_array(&writer, 10);
+	for (size_t i = 0; i < 10; i++) {
+		cbor_encode_unsigned_integer(&writer, bulk_u64[i]);
+	}
+	cbor_encode_array(&writer, 10);
+	for (size_t i = 0; i < 10; i++) {
+		if (bulk_i64[i] < 0) {
+			cbor_encode_negative_integer(&writer, bulk_i64[i]);
+		} else {
+			cbor_encode_unsigned_integer(&writer,
+					(uint64_t)bulk_i64[i]);
+		}
+	}
+	cbor_encode_array(&writer, nf);
+	for (size_t i = 0; i < nf; i++) {
+		cbor_encode_float(&writer, f32[i]);
+	}
+	cbor_encode_array(&writer, nf);
+	for (size_t i = 0; i < nf; i++) {
+		cbor_encode_double(&writer, bulk_f64[i]);
+	}
+
+	cbor_writer_init(&bulk, buf, sizeof(buf));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_u64(&bulk, bulk_u64, 10));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_i64(&bulk, bulk_i64, 10));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_f32(&bulk, f32, nf));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_f64(&bulk, bulk_f64, nf));
+
+	LONGS_EQUAL(cbor_writer_len(&writer), cbor_writer_len(&bulk));
+	MEMCMP_EQUAL(writer_buffer, buf, cbor_writer_len(&writer));
+
+	cbor_writer_init_dry_run(&bulk);
+	cbor_encode_array_u64(&bulk, bulk_u64, 10);
+	cbor_encode_array_i64(&bulk, bulk_i64, 10);
+	cbor_encode_array_f32(&bulk, f32, nf);
+	cbor_encode_array_f64(&bulk, bulk_f64, nf);
+	LONGS_EQUAL(cbor_writer_len(&writer), cbor_writer_len(&bulk));
+}
+
+TEST(Encoder, ShouldLeaveNothing_WhenBulkArrayDoesNotFit) {
+	uint8_t buf[40];
+	cbor_writer_t bulk;
+
+	cbor_writer_init(&bulk, buf, sizeof(buf));
+	cbor_encode_unsigned_integer(&bulk, 1);
+
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_encode_array_u64(&bulk, bulk_u64, 10));
+	LONGS_EQUAL(1, cbor_writer_len(&bulk));
+
+	/* header 1 + 1 + 1 + 2 + 2 + 3 + 3 + 5 + 5 + 9 */
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_u64(&bulk, bulk_u64, 9));
+	LONGS_EQUAL(33, cbor_writer_len(&bulk));
+	/* header 1 + 1 + 1 + 2 + 2, filling it up */
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_u64(&bulk, bulk_u64, 4));
+	LONGS_EQUAL(40, cbor_writer_len(&bulk));
+}
+
+TEST(Encoder, ShouldMatchOutOfLine_WhenInlineFastPathUsed) {
+	const uint64_t values[] = {
+		0, 23, 24, 255, 256, 65535, 65536, 0xffffffffull,
+		0x100000000ull, UINT64_MAX,
+	};
+	cbor_writer_t fast;
+	uint8_t buf[1024];
+
+	cbor_writer_init(&fast, buf, sizeof(buf));
+
+	for (size_t i = 0; i < sizeof(values) / sizeof(*values); i++) {
+		int64_t negative = -1 - (int64_t)(values[i] >> 1);
+
+		cbor_encode_unsigned_integer(&writer, values[i]);
+		cbor_encode_negative_integer(&writer, negative);
+		LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_unsigned_integer_inline(
+					&fast, values[i]));
+		LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_negative_integer_inline(
+					&fast, negative));
+	}
+	cbor_encode_bool(&writer, true);
+	cbor_encode_bool(&writer, false);
+	cbor_encode_null(&writer);
+	cbor_encode_bool_inline(&fast, true);
+	cbor_encode_bool_inline(&fast, false);
+	cbor_encode_null_inline(&fast);
+
+	LONGS_EQUAL(cbor_writer_len(&writer), cbor_writer_len(&fast));
+	MEMCMP_EQUAL(writer_buffer, buf, cbor_writer_len(&writer));
+}
+
+TEST(Encoder, ShouldTakeSlowPath_WhenInlineFastPathCannotStore) {
+	cbor_writer_frame_t frames[2];
+	cbor_writer_t measure;
+	uint8_t small[3];
+
+	cbor_writer_init(&writer, small, sizeof(small));
+	LONGS_EQUAL(CBOR_SUCCESS,
+			cbor_encode_unsigned_integer_inline(&writer, 1000));
+	LONGS_EQUAL(CBOR_OVERRUN,
+			cbor_encode_unsigned_integer_inline(&writer, 1));
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_encode_null_inline(&writer));
+	LONGS_EQUAL(3, cbor_writer_len(&writer));
+
+	cbor_writer_init(&writer, writer_buffer, sizeof(writer_buffer));
+	cbor_writer_set_frames(&writer, frames, 2);
+	cbor_encode_array_begin(&writer);
+	cbor_encode_bool_inline(&writer, true);
+	cbor_encode_negative_integer_inline(&writer, -1);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_array_end(&writer));
+	LONGS_EQUAL(0x82, writer_buffer[0]);
+
+	cbor_writer_init_dry_run(&measure);
+	cbor_encode_unsigned_integer_inline(&measure, 1000);
+	cbor_encode_null_inline(&measure);
+	LONGS_EQUAL(4, cbor_writer_len(&measure));
+}
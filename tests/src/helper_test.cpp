@@ -1057,3 +1057,51 @@ TEST(Helper, cbor_dispatch_ShouldDispatchEachArrayElement_WhenWildcardUsed)
 					 parsers, sizeof(parsers) / sizeof(*parsers),
 					 msg, sizeof(msg), nullptr));
 }
+
+TEST(Helper, next_sibling_ShouldStepOverSubtrees)
+{
+	/* [1, [2, [3]], {_ "a": 4}, 1(5), 6] */
+	static const uint8_t msg[] = {
+		0x85, 0x01, 0x82, 0x02, 0x81, 0x03,
+		0xBF, 0x61, 0x61, 0x04, 0xFF, 0xC1, 0x05, 0x06
+	};
+	size_t siblings[sizeof(items) / sizeof(items[0])];
+
+	for (int with_index = 0; with_index < 2; with_index++) {
+		cbor_reader_set_sibling_index(&reader,
+				with_index? siblings : nullptr);
+		LONGS_EQUAL(CBOR_SUCCESS,
+			    cbor_parse(&reader, msg, sizeof(msg), nullptr));
+
+		POINTERS_EQUAL(&items[2], cbor_next_sibling(&reader, &items[1]));
+		POINTERS_EQUAL(&items[6], cbor_next_sibling(&reader, &items[2]));
+		POINTERS_EQUAL(&items[10], cbor_next_sibling(&reader, &items[6]));
+		POINTERS_EQUAL(&items[9], cbor_next_sibling(&reader, &items[8]));
+		POINTERS_EQUAL(&items[12], cbor_next_sibling(&reader, &items[10]));
+		POINTERS_EQUAL(nullptr, cbor_next_sibling(&reader, &items[0]));
+		POINTERS_EQUAL(nullptr, cbor_next_sibling(&reader, &items[12]));
+	}
+}
+
+TEST(Helper, ShouldDispatch_WhenSubtreesSkippedBySiblingIndex)
+{
+	/* {"x": [[1, 2], {"a": 3}], "a": {"b": 4}, "b": 5} */
+	static const uint8_t msg[] = {
+		0xA3,
+		0x61, 0x78, 0x82, 0x82, 0x01, 0x02, 0xA1, 0x61, 0x61, 0x03,
+		0x61, 0x61, 0xA1, 0x61, 0x62, 0x04,
+		0x61, 0x62, 0x05
+	};
+	size_t siblings[sizeof(items) / sizeof(items[0])];
+	const struct cbor_parser parsers[] = {
+		CBOR_PATH_INLINE(on_sub_item, CBOR_STR_SEG("a"), CBOR_STR_SEG("b")),
+		CBOR_PATH_INLINE(on_sub_item, CBOR_STR_SEG("b")),
+	};
+
+	cbor_reader_set_sibling_index(&reader, siblings);
+	mock().expectNCalls(2, "b");
+
+	LONGS_EQUAL(true, cbor_unmarshal(&reader,
+					 parsers, sizeof(parsers) / sizeof(*parsers),
+					 msg, sizeof(msg), nullptr));
+}
@@ -10,6 +10,7 @@
 
 #include "cbor/ieee754.h"
 #include <math.h>
+#include <string.h>
 
 TEST_GROUP(IEEE754) {
 	ieee754_single_t s;
@@ -46,12 +47,6 @@ TEST(IEEE754, ShouldConvertToHalf_WhenHalfPrecisionSingleValueGiven) {
 	s.components.e = 127;
 	s.components.m = 0x7FE000; //111_1111_1110_0000_0000_0000
 	LONGS_EQUAL(1, ieee754_is_shrinkable_to_half(s.value));
-
-	s.components.e = 0;
-	s.components.m = 0x2000;
-	LONGS_EQUAL(1, ieee754_is_shrinkable_to_half(s.value));
-	s.components.m = 0x7FE000;
-	LONGS_EQUAL(1, ieee754_is_shrinkable_to_half(s.value));
 }
 TEST(IEEE754, ShouldKeepSingle_WhenSinglePrecisionGiven) {
 	s.components.sign = 0;
@@ -66,6 +61,12 @@ TEST(IEEE754, ShouldKeepSingle_WhenSinglePrecisionGiven) {
 	s.components.e = 0;
 	s.components.m = 0x800;
 	LONGS_EQUAL(0, ieee754_is_shrinkable_to_half(s.value));
+
+	/* single subnormals are far under the smallest half subnormal */
+	s.components.m = 0x2000;
+	LONGS_EQUAL(0, ieee754_is_shrinkable_to_half(s.value));
+	s.components.m = 0x7FE000;
+	LONGS_EQUAL(0, ieee754_is_shrinkable_to_half(s.value));
 }
 TEST(IEEE754, ShouldConvertToHalf_WhenHalfSubnormalGiven) {
 	s.components.sign = 0;
@@ -98,12 +99,6 @@ TEST(IEEE754, ShouldConvertToSingle_WhenSinglePrecisionDoubleValueGiven) {
 	// 1111_1111_1111_1111_1111_1110_0000_0000_0000_0000_0000_0000_0000
 	d.components.m = 0xFFFFFE0000000ull;
 	LONGS_EQUAL(1, ieee754_is_shrinkable_to_single(d.value));
-
-	d.components.e = 0;
-	d.components.m = 0x20000000ull; // smallest subnormal
-	LONGS_EQUAL(1, ieee754_is_shrinkable_to_single(d.value));
-	d.components.m = 0xFFFFFE0000000ull; // largest subnormal
-	LONGS_EQUAL(1, ieee754_is_shrinkable_to_single(d.value));
 }
 TEST(IEEE754, ShouldKeepDouble_WhenDoublePrecisionGiven) {
 	d.components.sign = 0;
@@ -118,6 +113,17 @@ TEST(IEEE754, ShouldKeepDouble_WhenDoublePrecisionGiven) {
 	d.components.e = 0;
 	d.components.m = 0x10000000ull;
 	LONGS_EQUAL(0, ieee754_is_shrinkable_to_single(d.value));
+
+	/* double subnormals are far under the smallest single subnormal */
+	d.components.m = 0x20000000ull;
+	LONGS_EQUAL(0, ieee754_is_shrinkable_to_single(d.value));
+	d.components.m = 0xFFFFFE0000000ull;
+	LONGS_EQUAL(0, ieee754_is_shrinkable_to_single(d.value));
+
+	/* a single subnormal whose lower bits do not fit */
+	d.components.e = 1023-127-20;
+	d.components.m = 0x2000000000000ull;
+	LONGS_EQUAL(0, ieee754_is_shrinkable_to_single(d.value));
 }
 TEST(IEEE754, ShouldConvertToSingle_WhenSubnormalGiven) {
 	d.components.sign = 0;
@@ -125,3 +131,84 @@ TEST(IEEE754, ShouldConvertToSingle_WhenSubnormalGiven) {
 	d.components.e = 1023-127;
 	LONGS_EQUAL(1, ieee754_is_shrinkable_to_single(d.value));
 }
+
+TEST(IEEE754, ShouldConvertEveryHalfToDouble) {
+	for (uint32_t i = 0; i <= UINT16_MAX; i++) {
+		const uint16_t h = (uint16_t)i;
+		const int e = (h >> 10) & 0x1f;
+		const int m = h & 0x3ff;
+		double expected = (e == 0)? ldexp(m, -24) : ldexp(1024 + m, e - 25);
+		double actual = ieee754_convert_half_to_double(h);
+
+		if (e == 0x1f) {
+			expected = m? NAN : INFINITY;
+		}
+		if (h & 0x8000) {
+			expected = -expected;
+		}
+
+		LONGS_EQUAL(h >> 15, signbit(actual)? 1 : 0);
+		if (isnan(expected)) {
+			CHECK(isnan(actual));
+		} else {
+			DOUBLES_EQUAL(expected, actual, 0);
+		}
+	}
+}
+
+TEST(IEEE754, ShouldShrinkEveryHalfBack_WhenWidened) {
+	for (uint32_t i = 0; i <= UINT16_MAX; i++) {
+		const uint16_t h = (uint16_t)i;
+		const double d = ieee754_convert_half_to_double(h);
+		uint64_t bits = 0;
+
+		LONGS_EQUAL(2, ieee754_shrink_double(d, &bits));
+		LONGS_EQUAL(2, ieee754_shrink_single((float)d, &bits));
+		if (isnan(d)) { /* widening makes signaling NaNs quiet */
+			LONGS_EQUAL(h | 0x200, bits);
+		} else {
+			LONGS_EQUAL(h, bits);
+			LONGS_EQUAL(h, ieee754_convert_single_to_half((float)d));
+		}
+	}
+}
+
+/* Every positive single of the exponents a half may have, the others being
+ * sampled as the whole range takes minutes */
+TEST(IEEE754, ShouldShrinkToHalf_OnlyWhenSingleIsKeptExactly) {
+	uint32_t mismatches = 0;
+
+	for (uint32_t i = 0; i < 2 * 256; i++) {
+		const uint32_t e = i & 0xff;
+		const bool half_range = (e >= 127-25 && e <= 127+16) || e == 0xff;
+		const uint32_t step = (half_range && i < 256)? 1 : 4099;
+
+		for (uint32_t m = 0; m < (1u << 23); m += step) {
+			const uint32_t u = ((i >> 8) << 31) | (e << 23) | m;
+			float f;
+			memcpy(&f, &u, sizeof(f));
+
+			const double expected = (double)f;
+			uint64_t bits = 0;
+			uint64_t dbits = 0;
+			const unsigned int size = ieee754_shrink_single(f, &bits);
+			const unsigned int dsize =
+				ieee754_shrink_double(expected, &dbits);
+
+			if (e == 0xff) { /* NaN or infinity */
+				mismatches += size != (((m & 0x1fff) == 0)?
+						2u : 4u);
+			} else if (size == 2) {
+				const double d = ieee754_convert_half_to_double(
+						(uint16_t)bits);
+				mismatches += memcmp(&d, &expected, sizeof(d)) != 0;
+				mismatches += dsize != 2 || dbits != bits;
+			} else {
+				mismatches += size != 4 || bits != u;
+				mismatches += dsize != 4 || dbits != u;
+			}
+		}
+	}
+
+	LONGS_EQUAL(0, mismatches);
+}
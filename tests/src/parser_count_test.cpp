@@ -1,5 +1,7 @@
 #include "CppUTest/TestHarness.h"
 
+#include <string.h>
+
 #include "cbor/parser.h"
 
 TEST_GROUP(ParserCount){};
@@ -418,3 +420,31 @@ TEST(ParserCount, ShouldReturnIllegal_WhenTopLevelBreakIsStandalone)
 	n = 0;
 	LONGS_EQUAL(CBOR_ILLEGAL, cbor_count_items(msg, sizeof(msg), &n));
 }
+
+TEST(ParserCount, ShouldCountDeepNesting_WhenEnoughFramesGiven)
+{
+	uint8_t msg[CBOR_RECURSION_MAX_LEVEL + 5];
+	cbor_parser_frame_t frames[sizeof(msg)];
+	size_t n = 0;
+
+	memset(msg, 0x81, sizeof(msg) - 1);
+	msg[sizeof(msg) - 1] = 0x01;
+
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_count_items(msg, sizeof(msg), &n));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_count_items_with_frames(msg,
+			sizeof(msg), frames, sizeof(frames) / sizeof(*frames),
+			&n));
+	LONGS_EQUAL(sizeof(msg), n);
+}
+
+TEST(ParserCount, ShouldReturnExcessive_WhenNestingDeeperThanFramesGiven)
+{
+	uint8_t msg[] = { 0x81, 0x81, 0x81, 0x01 };
+	cbor_parser_frame_t frames[2];
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_count_items(msg, sizeof(msg), &n));
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_count_items_with_frames(msg,
+			sizeof(msg), frames, sizeof(frames) / sizeof(*frames),
+			&n));
+}
@@ -0,0 +1,166 @@
+#include "CppUTest/TestHarness.h"
+
+#include "cbor/parser.h"
+#include <string.h>
+
+TEST_GROUP(ParserFrame) {
+	cbor_reader_t reader;
+	cbor_item_t items[64];
+	uint8_t msg[64];
+
+	void setup(void) {
+		cbor_reader_init(&reader, items, sizeof(items) / sizeof(*items));
+	}
+
+	size_t make_nested_arrays(size_t nesting) {
+		for (size_t i = 0; i < nesting; i++) {
+			msg[i] = 0x81; /* array(1) */
+		}
+		msg[nesting] = 0x01;
+		return nesting + 1;
+	}
+};
+
+TEST(ParserFrame, ShouldReturnExcessive_WhenDefaultDepthExceeded)
+{
+	size_t len = make_nested_arrays(CBOR_RECURSION_MAX_LEVEL);
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_parse(&reader, msg, len, NULL));
+}
+
+TEST(ParserFrame, ShouldParse_WhenNestingFitsDefaultDepth)
+{
+	size_t len = make_nested_arrays(CBOR_RECURSION_MAX_LEVEL - 1);
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, msg, len, &n));
+	LONGS_EQUAL(CBOR_RECURSION_MAX_LEVEL, n);
+}
+
+TEST(ParserFrame, ShouldParseDeeperThanDefault_WhenFramesGiven)
+{
+	cbor_parser_frame_t frames[24];
+	size_t len = make_nested_arrays(20);
+	size_t n = 0;
+
+	cbor_reader_set_frames(&reader, frames, 24);
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, msg, len, &n));
+	LONGS_EQUAL(21, n);
+	for (size_t i = 0; i < 20; i++) {
+		LONGS_EQUAL(CBOR_ITEM_ARRAY, items[i].type);
+		LONGS_EQUAL(1, items[i].size);
+		LONGS_EQUAL(i + 1, items[i].offset);
+	}
+	LONGS_EQUAL(CBOR_ITEM_INTEGER, items[20].type);
+}
+
+TEST(ParserFrame, ShouldReturnExcessive_WhenGivenFramesExceeded)
+{
+	cbor_parser_frame_t frames[2];
+	uint8_t nested[] = { 0x81, 0x81, 0x01 };
+	uint8_t flat[] = { 0x82, 0x01, 0x02 };
+
+	cbor_reader_set_frames(&reader, frames, 2);
+
+	LONGS_EQUAL(CBOR_EXCESSIVE,
+			cbor_parse(&reader, nested, sizeof(nested), NULL));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, flat, sizeof(flat), NULL));
+}
+
+TEST(ParserFrame, ShouldCloseIndefiniteContainers_WhenNestedDeeperThanDefault)
+{
+	cbor_parser_frame_t frames[16];
+	uint8_t indef[] = {
+		0x9f, 0x9f, 0x9f, 0x9f, 0x9f, 0x9f, 0x9f, 0x9f, 0x9f, 0x9f,
+		0x01,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0x02,
+	};
+	size_t n = 0;
+
+	cbor_reader_set_frames(&reader, frames, 16);
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, indef, sizeof(indef), &n));
+	LONGS_EQUAL(sizeof(indef), n);
+	LONGS_EQUAL(CBOR_ITEM_INTEGER, items[21].type);
+}
+
+TEST(ParserFrame, ShouldProduceSameItems_WhenFramesGivenOrNot)
+{
+	uint8_t m[] = { 0xa2, 0x61, 0x61, 0x82, 0x01, 0xc1, 0x02,
+		0x61, 0x62, 0x5f, 0x41, 0x00, 0xff };
+	cbor_item_t expected[16];
+	cbor_parser_frame_t frames[CBOR_RECURSION_MAX_LEVEL];
+	size_t n1 = 0;
+	size_t n2 = 0;
+
+	memset(expected, 0, sizeof(expected));
+	memset(items, 0, sizeof(items));
+
+	cbor_error_t err1 = cbor_parse(&reader, m, sizeof(m), &n1);
+	memcpy(expected, items, sizeof(expected));
+	memset(items, 0, sizeof(items));
+
+	cbor_reader_set_frames(&reader, frames, CBOR_RECURSION_MAX_LEVEL);
+	cbor_error_t err2 = cbor_parse(&reader, m, sizeof(m), &n2);
+
+	LONGS_EQUAL(err1, err2);
+	LONGS_EQUAL(n1, n2);
+	MEMCMP_EQUAL(expected, items, sizeof(expected));
+}
+
+TEST(ParserFrame, ShouldFallBackToDefault_WhenReaderReinitialized)
+{
+	cbor_parser_frame_t frames[24];
+	size_t len = make_nested_arrays(20);
+
+	cbor_reader_set_frames(&reader, frames, 24);
+	cbor_reader_init(&reader, items, sizeof(items) / sizeof(*items));
+
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_parse(&reader, msg, len, NULL));
+}
+
+TEST(ParserFrame, ShouldFallBackToDefault_WhenNullFramesGiven)
+{
+	cbor_parser_frame_t frames[1];
+	uint8_t m[] = { 0x81, 0x01 };
+
+	cbor_reader_set_frames(&reader, frames, 1);
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_parse(&reader, m, sizeof(m), NULL));
+
+	cbor_reader_set_frames(&reader, NULL, 1);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, m, sizeof(m), NULL));
+}
+
+TEST(ParserFrame, ShouldRecordNextSiblings_WhenSiblingIndexGiven)
+{
+	/* [1, [_ 2], 1({"a": 3})] */
+	const uint8_t m[] = {
+		0x83, 0x01, 0x9f, 0x02, 0xff, 0xc1, 0xa1, 0x61, 'a', 0x03
+	};
+	const size_t expected[] = { 9, 2, 5, 4, 5, 9, 9, 8, 9 };
+	size_t siblings[64];
+
+	cbor_reader_set_sibling_index(&reader, siblings);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, m, sizeof(m), NULL));
+	LONGS_EQUAL(9, reader.itemidx);
+	MEMCMP_EQUAL(expected, siblings, sizeof(expected));
+}
+
+TEST(ParserFrame, ShouldRecordNextSiblings_WhenParsingResumed)
+{
+	const uint8_t m[] = { 0x82, 0x81, 0x01, 0x02 };
+	cbor_parser_frame_t frames[4];
+	size_t siblings[64];
+
+	cbor_reader_set_frames(&reader, frames, 4);
+	cbor_reader_set_sibling_index(&reader, siblings);
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_parse_resume(&reader, m, 2, NULL));
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_parse_resume(&reader, m, 3, NULL));
+	LONGS_EQUAL(CBOR_SUCCESS,
+			cbor_parse_resume(&reader, m, sizeof(m), NULL));
+	LONGS_EQUAL(4, siblings[0]);
+	LONGS_EQUAL(3, siblings[1]);
+	LONGS_EQUAL(3, siblings[2]);
+	LONGS_EQUAL(4, siblings[3]);
+}
@@ -0,0 +1,178 @@
+#include "CppUTest/TestHarness.h"
+
+#include "cbor/parser.h"
+#include <string.h>
+
+TEST_GROUP(ParserResume) {
+	cbor_reader_t reader;
+	cbor_item_t items[32];
+	cbor_parser_frame_t frames[CBOR_RECURSION_MAX_LEVEL];
+
+	void setup(void) {
+		memset(items, 0, sizeof(items));
+		cbor_reader_init(&reader, items, sizeof(items) / sizeof(*items));
+		cbor_reader_set_frames(&reader, frames,
+				sizeof(frames) / sizeof(*frames));
+	}
+};
+
+TEST(ParserResume, ShouldReturnInvalid_WhenNoFramesGiven)
+{
+	uint8_t msg[] = { 0x01 };
+
+	cbor_reader_init(&reader, items, sizeof(items) / sizeof(*items));
+	LONGS_EQUAL(CBOR_INVALID,
+			cbor_parse_resume(&reader, msg, sizeof(msg), NULL));
+}
+
+TEST(ParserResume, ShouldReturnSuccess_WhenWholeMessageGiven)
+{
+	uint8_t msg[] = { 0xA2, 0x61, 0x61, 0x01, 0x61, 0x62, 0x02 };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_SUCCESS,
+			cbor_parse_resume(&reader, msg, sizeof(msg), &n));
+	LONGS_EQUAL(5, n);
+}
+
+TEST(ParserResume, ShouldReturnNeedMore_WhenContainerIsOpen)
+{
+	uint8_t msg[] = { 0x83, 0x01, 0x02, 0x03 };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_parse_resume(&reader, msg, 3, &n));
+	LONGS_EQUAL(3, n);
+	LONGS_EQUAL(CBOR_SUCCESS,
+			cbor_parse_resume(&reader, msg, sizeof(msg), &n));
+	LONGS_EQUAL(4, n);
+	LONGS_EQUAL(CBOR_ITEM_INTEGER, items[3].type);
+	LONGS_EQUAL(3, items[3].offset);
+}
+
+TEST(ParserResume, ShouldNotStoreItem_WhenHeaderIsSplit)
+{
+	uint8_t msg[] = { 0x81, 0x19, 0x01, 0x00 };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_parse_resume(&reader, msg, 3, &n));
+	LONGS_EQUAL(1, n);
+	LONGS_EQUAL(1, reader.msgidx);
+	LONGS_EQUAL(CBOR_SUCCESS,
+			cbor_parse_resume(&reader, msg, sizeof(msg), &n));
+	LONGS_EQUAL(2, n);
+	LONGS_EQUAL(2, items[1].size);
+}
+
+TEST(ParserResume, ShouldNotStoreItem_WhenStringPayloadIsSplit)
+{
+	uint8_t msg[] = { 0x65, 'h', 'e', 'l', 'l', 'o' };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_parse_resume(&reader, msg, 4, &n));
+	LONGS_EQUAL(0, n);
+	LONGS_EQUAL(CBOR_SUCCESS,
+			cbor_parse_resume(&reader, msg, sizeof(msg), &n));
+	LONGS_EQUAL(1, n);
+	LONGS_EQUAL(CBOR_ITEM_STRING, items[0].type);
+	LONGS_EQUAL(1, items[0].offset);
+	LONGS_EQUAL(5, items[0].size);
+}
+
+TEST(ParserResume, ShouldMatchParse_WhenFedByteByByte)
+{
+	uint8_t msg[] = { 0xbf, 0x61, 0x61, 0x9f, 0x01, 0xc1, 0x1a, 0x49,
+		0x96, 0x02, 0xd2, 0xff, 0x61, 0x62, 0x7f, 0x61, 0x78, 0x60,
+		0xff, 0x63, 0x6b, 0x65, 0x79, 0xfb, 0x3f, 0xf1, 0x99, 0x99,
+		0x99, 0x99, 0x99, 0x9a, 0xff };
+	cbor_item_t expected[32];
+	size_t expected_n = 0;
+	size_t n = 0;
+
+	memset(expected, 0, sizeof(expected));
+	cbor_reader_t plain;
+	cbor_reader_init(&plain, expected, sizeof(expected) / sizeof(*expected));
+	LONGS_EQUAL(CBOR_BREAK,
+			cbor_parse(&plain, msg, sizeof(msg), &expected_n));
+
+	for (size_t i = 1; i < sizeof(msg); i++) {
+		LONGS_EQUAL(CBOR_NEED_MORE,
+				cbor_parse_resume(&reader, msg, i, &n));
+	}
+	LONGS_EQUAL(CBOR_SUCCESS,
+			cbor_parse_resume(&reader, msg, sizeof(msg), &n));
+	LONGS_EQUAL(expected_n, n);
+	MEMCMP_EQUAL(expected, items, sizeof(expected));
+}
+
+TEST(ParserResume, ShouldContinue_WhenBufferMovedBetweenCalls)
+{
+	uint8_t first[] = { 0x82, 0x63, 'a', 'b' };
+	uint8_t whole[] = { 0x82, 0x63, 'a', 'b', 'c', 0x05 };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_NEED_MORE,
+			cbor_parse_resume(&reader, first, sizeof(first), &n));
+	LONGS_EQUAL(CBOR_SUCCESS,
+			cbor_parse_resume(&reader, whole, sizeof(whole), &n));
+	LONGS_EQUAL(3, n);
+	POINTERS_EQUAL(whole, reader.msg);
+}
+
+TEST(ParserResume, ShouldReturnSuccess_WhenEndingOnTopLevelBoundary)
+{
+	uint8_t msg[] = { 0x01, 0x9f, 0x02, 0xff, 0x03 };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse_resume(&reader, msg, 1, &n));
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_parse_resume(&reader, msg, 3, &n));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse_resume(&reader, msg, 4, &n));
+	LONGS_EQUAL(4, n);
+	LONGS_EQUAL(CBOR_SUCCESS,
+			cbor_parse_resume(&reader, msg, sizeof(msg), &n));
+	LONGS_EQUAL(5, n);
+}
+
+TEST(ParserResume, ShouldReturnIllegal_WhenMalformedItemArrives)
+{
+	uint8_t msg[] = { 0x82, 0x01, 0xff };
+
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_parse_resume(&reader, msg, 2, NULL));
+	LONGS_EQUAL(CBOR_ILLEGAL,
+			cbor_parse_resume(&reader, msg, sizeof(msg), NULL));
+}
+
+TEST(ParserResume, ShouldReturnInvalid_WhenMessageShrinks)
+{
+	uint8_t msg[] = { 0x82, 0x01, 0x02 };
+
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_parse_resume(&reader, msg, 2, NULL));
+	LONGS_EQUAL(CBOR_INVALID, cbor_parse_resume(&reader, msg, 1, NULL));
+}
+
+TEST(ParserResume, ShouldReturnOverrun_WhenItemTableIsFull)
+{
+	uint8_t msg[] = { 0x01, 0x02, 0x03 };
+	size_t n = 0;
+
+	cbor_reader_init(&reader, items, 2);
+	cbor_reader_set_frames(&reader, frames,
+			sizeof(frames) / sizeof(*frames));
+
+	LONGS_EQUAL(CBOR_OVERRUN,
+			cbor_parse_resume(&reader, msg, sizeof(msg), &n));
+	LONGS_EQUAL(2, n);
+}
+
+TEST(ParserResume, ShouldStartOver_WhenParseCalledInBetween)
+{
+	uint8_t partial[] = { 0x82, 0x01 };
+	uint8_t other[] = { 0x03 };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_parse_resume(&reader, partial,
+				sizeof(partial), &n));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, other, sizeof(other), &n));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse_resume(&reader, other,
+				sizeof(other), &n));
+	LONGS_EQUAL(1, n);
+}
@@ -0,0 +1,184 @@
+#include "CppUTest/TestHarness.h"
+
+#include <string.h>
+
+#include "cbor/parser.h"
+#include "cbor/decoder.h"
+
+TEST_GROUP(ParserSequence) {
+	cbor_seq_record_t records[4];
+};
+
+TEST(ParserSequence, ShouldFindRecordBoundaries_WhenSequenceGiven)
+{
+	/* 1, [_ 2, 3], {"a": h'00'} */
+	const uint8_t msg[] = {
+		0x01,
+		0x9f, 0x02, 0x03, 0xff,
+		0xa1, 0x61, 'a', 0x41, 0x00,
+	};
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_split_sequence(msg, sizeof(msg),
+				records, 4, &n));
+	LONGS_EQUAL(3, n);
+	LONGS_EQUAL(0, records[0].offset);
+	LONGS_EQUAL(1, records[0].size);
+	LONGS_EQUAL(1, records[0].nitems);
+	LONGS_EQUAL(1, records[1].offset);
+	LONGS_EQUAL(4, records[1].size);
+	LONGS_EQUAL(4, records[1].nitems);
+	LONGS_EQUAL(5, records[2].offset);
+	LONGS_EQUAL(5, records[2].size);
+	LONGS_EQUAL(3, records[2].nitems);
+}
+
+TEST(ParserSequence, ShouldParseEachRecordOnItsOwn_WhenSplit)
+{
+	const uint8_t msg[] = {
+		0x82, 0x18, 0x64, 0x20,
+		0x63, 'a', 'b', 'c',
+	};
+	cbor_reader_t reader;
+	cbor_item_t items[4];
+	size_t n = 0;
+	int v = 0;
+	char buf[4] = { 0, };
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_split_sequence(msg, sizeof(msg),
+				records, 4, &n));
+	LONGS_EQUAL(2, n);
+
+	cbor_reader_init(&reader, items, records[0].nitems);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, &msg[records[0].offset],
+				records[0].size, &n));
+	LONGS_EQUAL(3, n);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, &items[2],
+				&v, sizeof(v)));
+	LONGS_EQUAL(-1, v);
+
+	cbor_reader_init(&reader, items, records[1].nitems);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, &msg[records[1].offset],
+				records[1].size, &n));
+	LONGS_EQUAL(1, n);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, &items[0],
+				buf, sizeof(buf)));
+	STRCMP_EQUAL("abc", buf);
+}
+
+TEST(ParserSequence, ShouldReturnSuccess_WhenEmptySequenceGiven)
+{
+	const uint8_t msg[] = { 0x00 };
+	size_t n = 1234;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_split_sequence(msg, 0, records, 4, &n));
+	LONGS_EQUAL(0, n);
+}
+
+TEST(ParserSequence, ShouldReturnNeedMore_WhenLastRecordIsTruncated)
+{
+	const uint8_t msg[] = { 0x01, 0x02, 0x9f, 0x03 };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_split_sequence(msg, sizeof(msg),
+				records, 4, &n));
+	LONGS_EQUAL(2, n);
+	LONGS_EQUAL(2, records[1].offset + records[1].size);
+
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_split_sequence("\x19\x01", 2,
+				records, 4, &n));
+	LONGS_EQUAL(0, n);
+}
+
+TEST(ParserSequence, ShouldReturnOverrun_WhenRecordTableIsFull)
+{
+	const uint8_t msg[] = { 0x01, 0x02, 0x03 };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_split_sequence(msg, sizeof(msg),
+				records, 2, &n));
+	LONGS_EQUAL(2, n);
+	LONGS_EQUAL(1, records[1].offset);
+	LONGS_EQUAL(CBOR_OVERRUN, cbor_split_sequence(msg, sizeof(msg),
+				records, 0, &n));
+	LONGS_EQUAL(0, n);
+}
+
+TEST(ParserSequence, ShouldStopAtMalformedRecord_WhenSplitting)
+{
+	const uint8_t stray_break[] = { 0x01, 0xff, 0x02 };
+	const uint8_t reserved[] = { 0x01, 0x81, 0x1c, 0x02 };
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_ILLEGAL, cbor_split_sequence(stray_break,
+				sizeof(stray_break), records, 4, &n));
+	LONGS_EQUAL(1, n);
+	LONGS_EQUAL(CBOR_ILLEGAL, cbor_split_sequence(reserved,
+				sizeof(reserved), records, 4, &n));
+	LONGS_EQUAL(1, n);
+}
+
+TEST(ParserSequence, ShouldCountItemsAsParsed_WhenRecordsNest)
+{
+	/* 1({_ "k": [(_ h'01', h''), []]}), [[[[[[[[0]]]]]]]] */
+	const uint8_t msg[] = {
+		0xc1, 0xbf, 0x61, 'k', 0x82, 0x5f, 0x41, 0x01, 0x40, 0xff,
+		0x80, 0xff,
+		0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x00,
+	};
+	const uint8_t early_break[] = { 0x82, 0x01, 0xff };
+	cbor_reader_t reader;
+	cbor_item_t items[16];
+	size_t n = 0;
+
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_split_sequence(msg, sizeof(msg),
+				records, 4, &n));
+	LONGS_EQUAL(1, n);
+	LONGS_EQUAL(12, records[0].size);
+	LONGS_EQUAL(10, records[0].nitems);
+
+	cbor_reader_init(&reader, items, 16);
+	/* indefinite-length items make cbor_parse() return CBOR_BREAK */
+	LONGS_EQUAL(CBOR_BREAK, cbor_parse(&reader, msg, records[0].size,
+				&n));
+	LONGS_EQUAL(records[0].nitems, n);
+
+	LONGS_EQUAL(CBOR_ILLEGAL, cbor_split_sequence(early_break,
+				sizeof(early_break), records, 4, &n));
+	LONGS_EQUAL(0, n);
+}
+
+TEST(ParserSequence, ShouldSplitDeepRecords_WhenEnoughFramesGiven)
+{
+	/* [[[[[[[[[[0]]]]]]]]]], 1 */
+	uint8_t msg[CBOR_RECURSION_MAX_LEVEL + 4];
+	cbor_parser_frame_t frames[CBOR_RECURSION_MAX_LEVEL + 4];
+	cbor_reader_t reader;
+	cbor_item_t items[CBOR_RECURSION_MAX_LEVEL + 4];
+	size_t nested = sizeof(msg) - 2;
+	size_t n = 0;
+
+	memset(msg, 0x81, nested);
+	msg[nested] = 0x00;
+	msg[nested + 1] = 0x01;
+
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_split_sequence(msg, sizeof(msg),
+				records, 4, &n));
+	LONGS_EQUAL(0, n);
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_split_sequence_with_frames(msg,
+				sizeof(msg), frames, nested,
+				records, 4, &n));
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_split_sequence_with_frames(msg,
+				sizeof(msg), frames, nested + 1,
+				records, 4, &n));
+	LONGS_EQUAL(2, n);
+	LONGS_EQUAL(nested + 1, records[0].size);
+	LONGS_EQUAL(nested + 1, records[0].nitems);
+
+	cbor_reader_init(&reader, items, records[0].nitems);
+	cbor_reader_set_frames(&reader, frames, nested + 1);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, msg, records[0].size,
+				&n));
+	LONGS_EQUAL(records[0].nitems, n);
+}
@@ -6,6 +6,7 @@
 
 #include "CppUTest/TestHarness.h"
 #include "cbor/stream.h"
+#include "cbor/helper.h"
 #include <stdint.h>
 #include <string.h>
 
@@ -42,6 +43,7 @@ struct Recorder {
 	int           count;
 	bool          abort_after_first;
 	int           abort_at; /**< abort when count reaches this value */
+	int           skip_at;  /**< skip the item of the event counted here */
 };
 
 struct ZeroLengthGuard {
@@ -50,17 +52,17 @@ struct ZeroLengthGuard {
 	bool   saw_zero_len;
 };
 
-static bool record_cb(const cbor_stream_event_t *event,
+static cbor_stream_action_t record_cb(const cbor_stream_event_t *event,
 		const cbor_stream_data_t *data, void *arg)
 {
 	Recorder *r = (Recorder *)arg;
 
 	if (r->abort_after_first && r->count >= r->abort_at) {
-		return false;
+		return CBOR_STREAM_ABORT;
 	}
 
 	if (r->count >= MAX_EVENTS) {
-		return true;
+		return CBOR_STREAM_CONTINUE;
 	}
 
 	RecordedEvent &ev = r->events[r->count++];
@@ -70,7 +72,7 @@ static bool record_cb(const cbor_stream_event_t *event,
 	ev.is_map_key = event->is_map_key;
 
 	if (!data) {
-		return true;
+		return CBOR_STREAM_CONTINUE;
 	}
 
 	switch (event->type) {
@@ -115,23 +117,24 @@ static bool record_cb(const cbor_stream_event_t *event,
 		break;
 	}
 
-	return true;
+	return (r->count == r->skip_at)? CBOR_STREAM_SKIP : CBOR_STREAM_CONTINUE;
 }
 
-static bool reject_zero_length_text_cb(const cbor_stream_event_t *event,
+static cbor_stream_action_t reject_zero_length_text_cb(
+		const cbor_stream_event_t *event,
 		const cbor_stream_data_t *data, void *arg)
 {
 	ZeroLengthGuard *guard = (ZeroLengthGuard *)arg;
 
 	if (event->type != CBOR_STREAM_EVENT_TEXT || data == NULL) {
-		return true;
+		return CBOR_STREAM_CONTINUE;
 	}
 
 	guard->text_events++;
 	guard->last_len = data->str.len;
 	guard->saw_zero_len = (data->str.len == 0);
 
-	return !guard->saw_zero_len;
+	return guard->saw_zero_len? CBOR_STREAM_ABORT : CBOR_STREAM_CONTINUE;
 }
 
 static void feed_all(cbor_stream_decoder_t *d, const uint8_t *buf, size_t len)
@@ -1149,6 +1152,49 @@ TEST(StreamChunked, ShouldDecodeNestedMap_WhenComplexMessageGiven)
 	LONGS_EQUAL(2, rec.events[3].depth);
 }
 
+TEST(StreamChunked, ShouldGiveSameEvents_WhenHeadersSplitAnywhere)
+{
+	/* every size of following bytes on every major type */
+	const uint8_t msg[] = {
+		0x8f,
+		0x18, 0x64,
+		0x19, 0x01, 0xf4,
+		0x1a, 0x00, 0x0f, 0x42, 0x40,
+		0x1b, 0x00, 0x00, 0x00, 0xe8, 0xd4, 0xa5, 0x10, 0x00,
+		0x38, 0x63,
+		0x39, 0x03, 0xe7,
+		0xd9, 0x01, 0x00, 0x18, 0x18,
+		0xf8, 0x20,
+		0xf9, 0x3c, 0x00,
+		0xfa, 0x47, 0xc3, 0x50, 0x00,
+		0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a,
+		0x98, 0x01, 0x00,
+		0xb9, 0x00, 0x01, 0x01, 0x02,
+		0x59, 0x00, 0x00,
+		0x7a, 0x00, 0x00, 0x00, 0x00,
+	};
+	Recorder whole;
+
+	memset(&whole, 0, sizeof(whole));
+	cbor_stream_init(&decoder, record_cb, &whole);
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	LONGS_EQUAL(1000000, whole.events[3].uint_val);
+	LONGS_EQUAL(-1000, whole.events[6].sint_val);
+
+	for (size_t split = 1; split < sizeof(msg); split++) {
+		memset(&rec, 0, sizeof(rec));
+		cbor_stream_init(&decoder, record_cb, &rec);
+		feed_all(&decoder, msg, split);
+		feed_all(&decoder, &msg[split], sizeof(msg) - split);
+		LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+
+		LONGS_EQUAL(whole.count, rec.count);
+		MEMCMP_EQUAL(whole.events, rec.events,
+				sizeof(whole.events[0]) * (size_t)whole.count);
+	}
+}
+
 /* ---------- TEST_GROUP: is_map_key on END events ---------- */
 
 TEST_GROUP(StreamMapKeyEnd)
@@ -1285,3 +1331,807 @@ TEST(StreamLargePayload, ShouldMakeForwardProgress_WhenTextLengthExceeds32BitRan
 	LONGS_EQUAL(1, guard.last_len);
 	LONGS_EQUAL(CBOR_NEED_MORE, cbor_stream_finish(&decoder));
 }
+
+/* ---------- TEST_GROUP: UTF-8 validation ---------- */
+
+TEST_GROUP(StreamUTF8)
+{
+	cbor_stream_decoder_t decoder;
+	Recorder              rec;
+
+	void setup()
+	{
+		memset(&rec, 0, sizeof(rec));
+		cbor_stream_init(&decoder, record_cb, &rec);
+		cbor_stream_set_utf8_validation(&decoder, true);
+	}
+};
+
+TEST(StreamUTF8, ShouldEmitText_WhenCodePointSplitBetweenFeeds)
+{
+	/* "a€b" */
+	uint8_t msg[] = { 0x65, 'a', 0xe2, 0x82, 0xac, 'b' };
+	feed_byte_by_byte(&decoder, msg, sizeof(msg));
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	LONGS_EQUAL(5, rec.count);
+	LONGS_EQUAL(sizeof(msg), decoder.offset);
+}
+
+TEST(StreamUTF8, ShouldReturnInvalidAtOffendingByte_WhenIllFormedTextGiven)
+{
+	uint8_t msg[] = { 0x82, 0x63, 'a', 'b', 'c', 0x63, 'a', 0xc0, 0xaf };
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_feed(&decoder, msg, 6));
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_feed(&decoder, &msg[6], 3));
+	LONGS_EQUAL(7, decoder.offset);
+	/* ARRAY_START and "abc" only; the bad string is never handed out */
+	LONGS_EQUAL(2, rec.count);
+}
+
+TEST(StreamUTF8, ShouldReturnInvalid_WhenChunkEndsMidCodePoint)
+{
+	/* (_ "\xe2\x82", "\xac") */
+	uint8_t msg[] = { 0x7f, 0x62, 0xe2, 0x82, 0x61, 0xac, 0xff };
+
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_feed(&decoder, msg, sizeof(msg)));
+	LONGS_EQUAL(4, decoder.offset);
+}
+
+TEST(StreamUTF8, ShouldNotCheckBytes_WhenByteStringGiven)
+{
+	uint8_t msg[] = { 0x42, 0xc0, 0xaf };
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(1, rec.count);
+}
+
+TEST(StreamUTF8, ShouldKeepValidation_WhenReset)
+{
+	uint8_t msg[] = { 0x61, 0xff };
+
+	cbor_stream_reset(&decoder);
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_feed(&decoder, msg, sizeof(msg)));
+	LONGS_EQUAL(1, decoder.offset);
+
+	cbor_stream_set_utf8_validation(&decoder, false);
+	cbor_stream_reset(&decoder);
+	feed_all(&decoder, msg, sizeof(msg));
+}
+
+/* ---------- TEST_GROUP: Pull ---------- */
+
+/* Takes every event the chunk gives, recording it the way record_cb does */
+static void pull_all(cbor_stream_decoder_t *d, Recorder *r,
+		const uint8_t *buf, size_t len)
+{
+	const cbor_stream_event_t *event;
+	const cbor_stream_data_t  *data;
+	cbor_error_t               err;
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_feed(d, buf, len));
+
+	while ((err = cbor_stream_next(d, &event, &data)) == CBOR_SUCCESS) {
+		if (record_cb(event, data, r) == CBOR_STREAM_SKIP) {
+			LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_skip(d));
+		}
+	}
+
+	LONGS_EQUAL(CBOR_NEED_MORE, err);
+}
+
+TEST_GROUP(StreamPull)
+{
+	cbor_stream_decoder_t decoder;
+	Recorder              rec;
+
+	void setup()
+	{
+		memset(&rec, 0, sizeof(rec));
+		cbor_stream_init_pull(&decoder);
+	}
+};
+
+TEST(StreamPull, ShouldPullSameEvents_AsCallbackGets)
+{
+	/* [{"a": [[], {}], 1: 24(h'0102')}, (_ "ab", "c"), [_ -1, 1.5], [[[0]]]] */
+	const uint8_t msg[] = {
+		0x84,
+		0xa2, 0x61, 'a', 0x82, 0x80, 0xa0,
+		0x01, 0xd8, 0x18, 0x42, 0x01, 0x02,
+		0x7f, 0x62, 'a', 'b', 0x61, 'c', 0xff,
+		0x9f, 0x20, 0xf9, 0x3e, 0x00, 0xff,
+		0x81, 0x81, 0x81, 0x00,
+	};
+	cbor_stream_decoder_t push;
+	Recorder expected;
+
+	memset(&expected, 0, sizeof(expected));
+	cbor_stream_init(&push, record_cb, &expected);
+	feed_all(&push, msg, sizeof(msg));
+
+	pull_all(&decoder, &rec, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	LONGS_EQUAL(sizeof(msg), decoder.offset);
+	LONGS_EQUAL(expected.count, rec.count);
+	MEMCMP_EQUAL(expected.events, rec.events,
+			sizeof(rec.events[0]) * (size_t)rec.count);
+
+	memset(&expected, 0, sizeof(expected));
+	memset(&rec, 0, sizeof(rec));
+	cbor_stream_reset(&push);
+	cbor_stream_reset(&decoder);
+	feed_byte_by_byte(&push, msg, sizeof(msg));
+	for (size_t i = 0; i < sizeof(msg); i++) {
+		pull_all(&decoder, &rec, &msg[i], 1);
+	}
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	LONGS_EQUAL(expected.count, rec.count);
+	MEMCMP_EQUAL(expected.events, rec.events,
+			sizeof(rec.events[0]) * (size_t)rec.count);
+}
+
+TEST(StreamPull, ShouldPullSameScalars_AsCallbackGets)
+{
+	/* [true, false, null, undefined, simple(16), simple(32), 1000000,
+	 *  -500, 100000.0, 1.1, 1(2(0)), "", h'', "\u00e9"] */
+	const uint8_t msg[] = {
+		0x8e,
+		0xf5, 0xf4, 0xf6, 0xf7, 0xf0, 0xf8, 0x20,
+		0x1a, 0x00, 0x0f, 0x42, 0x40,
+		0x39, 0x01, 0xf3,
+		0xfa, 0x47, 0xc3, 0x50, 0x00,
+		0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a,
+		0xc1, 0xc2, 0x00,
+		0x60, 0x40, 0x62, 0xc3, 0xa9,
+	};
+	cbor_stream_decoder_t push;
+	Recorder expected;
+
+	memset(&expected, 0, sizeof(expected));
+	cbor_stream_init(&push, record_cb, &expected);
+	cbor_stream_set_utf8_validation(&push, true);
+	feed_all(&push, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&push));
+
+	cbor_stream_set_utf8_validation(&decoder, true);
+	pull_all(&decoder, &rec, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	LONGS_EQUAL(18, rec.count);
+	LONGS_EQUAL(expected.count, rec.count);
+	MEMCMP_EQUAL(expected.events, rec.events,
+			sizeof(rec.events[0]) * (size_t)rec.count);
+}
+
+TEST(StreamPull, ShouldCloseOneContainerPerCall_WhenNestedArraysEnd)
+{
+	const uint8_t msg[] = { 0x81, 0x81, 0x00 };
+	const cbor_stream_event_t *event;
+	const cbor_stream_data_t  *data;
+
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_next(&decoder, &event, &data));
+	LONGS_EQUAL(CBOR_STREAM_EVENT_ARRAY_START, event->type);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_next(&decoder, &event, &data));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_next(&decoder, &event, &data));
+	LONGS_EQUAL(CBOR_STREAM_EVENT_UINT, event->type);
+	LONGS_EQUAL(2, event->depth);
+
+	/* every byte is taken, but the ENDs are still to come */
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_stream_finish(&decoder));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_next(&decoder, &event, &data));
+	LONGS_EQUAL(CBOR_STREAM_EVENT_ARRAY_END, event->type);
+	LONGS_EQUAL(1, event->depth);
+	POINTERS_EQUAL(NULL, data);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_next(&decoder, &event, &data));
+	LONGS_EQUAL(CBOR_STREAM_EVENT_ARRAY_END, event->type);
+	LONGS_EQUAL(0, event->depth);
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_stream_next(&decoder, &event, &data));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+}
+
+TEST(StreamPull, ShouldPointIntoChunk_WhenStringPulled)
+{
+	const uint8_t msg[] = { 0x63, 'a', 'b', 'c' };
+	const cbor_stream_event_t *event;
+	const cbor_stream_data_t  *data;
+
+	feed_all(&decoder, msg, 2);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_next(&decoder, &event, &data));
+	POINTERS_EQUAL(&msg[1], data->str.ptr);
+	LONGS_EQUAL(1, data->str.len);
+	CHECK_TRUE(data->str.first);
+	CHECK_FALSE(data->str.last);
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_stream_next(&decoder, &event, &data));
+
+	feed_all(&decoder, &msg[2], 2);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_next(&decoder, &event, &data));
+	POINTERS_EQUAL(&msg[2], data->str.ptr);
+	LONGS_EQUAL(2, data->str.len);
+	CHECK_TRUE(data->str.last);
+}
+
+TEST(StreamPull, ShouldReturnInvalid_WhenFedBeforeChunkTaken)
+{
+	const uint8_t msg[] = { 0x01, 0x02 };
+	const cbor_stream_event_t *event;
+	const cbor_stream_data_t  *data;
+
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_next(&decoder, &event, &data));
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_feed(&decoder, msg, sizeof(msg)));
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_stream_finish(&decoder));
+
+	/* not sticky: the rest of the first chunk is still there */
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_next(&decoder, &event, &data));
+	LONGS_EQUAL(2, data->uint);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+}
+
+TEST(StreamPull, ShouldReturnStickyError_WhenIllegalByteGiven)
+{
+	const uint8_t msg[] = { 0x82, 0x01, 0x1c };
+	const cbor_stream_event_t *event;
+	const cbor_stream_data_t  *data;
+
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_next(&decoder, &event, &data));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_next(&decoder, &event, &data));
+	LONGS_EQUAL(CBOR_ILLEGAL, cbor_stream_next(&decoder, &event, &data));
+	LONGS_EQUAL(3, decoder.offset);
+	LONGS_EQUAL(CBOR_ILLEGAL, cbor_stream_next(&decoder, &event, &data));
+	LONGS_EQUAL(CBOR_ILLEGAL, cbor_stream_finish(&decoder));
+
+	cbor_stream_reset(&decoder);
+	CHECK_TRUE(decoder.pull);
+	LONGS_EQUAL(CBOR_NEED_MORE, cbor_stream_next(&decoder, &event, &data));
+}
+
+TEST(StreamPull, ShouldReturnInvalid_WhenDecoderHasCallback)
+{
+	const cbor_stream_event_t *event;
+	const cbor_stream_data_t  *data;
+
+	cbor_stream_init(&decoder, record_cb, &rec);
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_next(&decoder, &event, &data));
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_next(NULL, &event, &data));
+}
+
+/* ---------- TEST_GROUP: Paths ---------- */
+
+static const struct cbor_parser paths[] = {
+	CBOR_PATH_INLINE(NULL, CBOR_STR_SEG("temp")),
+	CBOR_PATH_INLINE(NULL, CBOR_STR_SEG("dev"), CBOR_STR_SEG("fw")),
+	CBOR_PATH_INLINE(NULL, CBOR_INT_SEG(-2), CBOR_IDX_SEG(1)),
+	CBOR_PATH_INLINE(NULL, CBOR_INT_SEG(7), CBOR_ANY_SEG()),
+};
+
+/* {"temperature": 1, "temp": 21, "noise": [[1, 2], {"temp": 3}],
+ *  "dev": {"name": "x", "fw": [1, 2]}, -2: [10, 24(11), 12],
+ *  7: {"a": 5, 6: true}} */
+static const uint8_t path_msg[] = {
+	0xa6,
+	0x6b, 't', 'e', 'm', 'p', 'e', 'r', 'a', 't', 'u', 'r', 'e', 0x01,
+	0x64, 't', 'e', 'm', 'p', 0x15,
+	0x65, 'n', 'o', 'i', 's', 'e',
+		0x82, 0x82, 0x01, 0x02, 0xa1, 0x64, 't', 'e', 'm', 'p', 0x03,
+	0x63, 'd', 'e', 'v',
+		0xa2, 0x64, 'n', 'a', 'm', 'e', 0x61, 'x',
+		0x62, 'f', 'w', 0x82, 0x01, 0x02,
+	0x21, 0x83, 0x0a, 0xd8, 0x18, 0x0b, 0x0c,
+	0x07, 0xa2, 0x61, 'a', 0x05, 0x06, 0xf5,
+};
+
+TEST_GROUP(StreamPath)
+{
+	cbor_stream_decoder_t decoder;
+	Recorder              rec;
+
+	void setup()
+	{
+		memset(&rec, 0, sizeof(rec));
+		cbor_stream_init(&decoder, record_cb, &rec);
+		LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_set_paths(&decoder,
+					paths, sizeof(paths) / sizeof(*paths)));
+	}
+
+	void check_path_events(void)
+	{
+		LONGS_EQUAL(9, rec.count);
+		LONGS_EQUAL(CBOR_STREAM_EVENT_UINT, rec.events[0].type);
+		LONGS_EQUAL(21, rec.events[0].uint_val);
+		LONGS_EQUAL(1, rec.events[0].depth);
+		CHECK_FALSE(rec.events[0].is_map_key);
+		LONGS_EQUAL(CBOR_STREAM_EVENT_ARRAY_START, rec.events[1].type);
+		LONGS_EQUAL(2, rec.events[1].depth);
+		LONGS_EQUAL(1, rec.events[2].uint_val);
+		LONGS_EQUAL(2, rec.events[3].uint_val);
+		LONGS_EQUAL(CBOR_STREAM_EVENT_ARRAY_END, rec.events[4].type);
+		LONGS_EQUAL(CBOR_STREAM_EVENT_TAG, rec.events[5].type);
+		LONGS_EQUAL(24, rec.events[5].uint_val);
+		LONGS_EQUAL(11, rec.events[6].uint_val);
+		LONGS_EQUAL(5, rec.events[7].uint_val);
+		LONGS_EQUAL(CBOR_STREAM_EVENT_BOOL, rec.events[8].type);
+	}
+};
+
+static cbor_stream_action_t check_parser_cb(const cbor_stream_event_t *event,
+		const cbor_stream_data_t *data, void *arg)
+{
+	(void)data;
+	const struct cbor_parser **expected = (const struct cbor_parser **)arg;
+
+	POINTERS_EQUAL(*expected, event->parser);
+	if (event->type == CBOR_STREAM_EVENT_ARRAY_END) {
+		*expected = &paths[2];
+	}
+	return CBOR_STREAM_CONTINUE;
+}
+
+TEST(StreamPath, ShouldDeliverOnlyItemsUnderPaths)
+{
+	feed_all(&decoder, path_msg, sizeof(path_msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	check_path_events();
+}
+
+TEST(StreamPath, ShouldMatchKeys_WhenSplitBetweenFeeds)
+{
+	feed_byte_by_byte(&decoder, path_msg, sizeof(path_msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	check_path_events();
+}
+
+TEST(StreamPath, ShouldTellWhichPathMatched)
+{
+	/* {"dev": {"fw": [2]}, -2: [0, 1]} */
+	const uint8_t msg[] = {
+		0xa2, 0x63, 'd', 'e', 'v', 0xa1, 0x62, 'f', 'w', 0x81, 0x02,
+		0x21, 0x82, 0x00, 0x01,
+	};
+	const struct cbor_parser *expected = &paths[1];
+
+	cbor_stream_init(&decoder, check_parser_cb, &expected);
+	cbor_stream_set_paths(&decoder, paths, sizeof(paths) / sizeof(*paths));
+	feed_all(&decoder, msg, sizeof(msg));
+	POINTERS_EQUAL(&paths[2], expected);
+}
+
+TEST(StreamPath, ShouldMatchKey_WhenIndefiniteStringKeyGiven)
+{
+	/* {(_ "te", "mp"): 1, (_ "te", "mpo"): 2} */
+	const uint8_t msg[] = {
+		0xa2,
+		0x7f, 0x62, 't', 'e', 0x62, 'm', 'p', 0xff, 0x01,
+		0x7f, 0x62, 't', 'e', 0x63, 'm', 'p', 'o', 0xff, 0x02,
+	};
+
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(1, rec.count);
+	LONGS_EQUAL(1, rec.events[0].uint_val);
+}
+
+TEST(StreamPath, ShouldDeliverEverything_WhenRootPathGiven)
+{
+	const struct cbor_parser root[] = { { NULL, 0, NULL } };
+	const uint8_t msg[] = { 0x82, 0x01, 0xa1, 0x61, 'a', 0x02, 0x03 };
+
+	cbor_stream_set_paths(&decoder, root, 1);
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(8, rec.count);
+	POINTERS_EQUAL(&root[0], decoder.record.event.parser);
+}
+
+TEST(StreamPath, ShouldSkipEverything_WhenNothingMatches)
+{
+	const uint8_t msg[] = {
+		0xa2, 0x61, 'a', 0x9f, 0x01, 0x5f, 0x41, 0x00, 0xff, 0xff,
+		0xa1, 0x01, 0x02, 0x03,
+	};
+
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	LONGS_EQUAL(0, rec.count);
+	LONGS_EQUAL(sizeof(msg), decoder.offset);
+}
+
+TEST(StreamPath, ShouldPullOnlyItemsUnderPaths)
+{
+	cbor_stream_init_pull(&decoder);
+	cbor_stream_set_paths(&decoder, paths, sizeof(paths) / sizeof(*paths));
+	pull_all(&decoder, &rec, path_msg, sizeof(path_msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	check_path_events();
+}
+
+TEST(StreamPath, ShouldKeepPaths_WhenReset)
+{
+	cbor_stream_reset(&decoder);
+	feed_all(&decoder, path_msg, sizeof(path_msg));
+	check_path_events();
+}
+
+TEST(StreamPath, ShouldReturnError_WhenPathsCannotBeSet)
+{
+	struct cbor_parser many[CBOR_STREAM_MAX_PATHS + 1];
+
+	memset(many, 0, sizeof(many));
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_set_paths(NULL, paths, 1));
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_set_paths(&decoder, NULL, 1));
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_stream_set_paths(&decoder,
+				many, CBOR_STREAM_MAX_PATHS + 1));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_set_paths(&decoder,
+				many, CBOR_STREAM_MAX_PATHS));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_set_paths(&decoder, NULL, 0));
+}
+
+/* ---------- TEST_GROUP: Skipping items from the callback ---------- */
+
+TEST_GROUP(StreamSkip)
+{
+	cbor_stream_decoder_t decoder;
+	Recorder              rec;
+
+	void setup()
+	{
+		memset(&rec, 0, sizeof(rec));
+		cbor_stream_init(&decoder, record_cb, &rec);
+	}
+
+	void check_types(const cbor_stream_event_type_t *types, int n)
+	{
+		LONGS_EQUAL(n, rec.count);
+		for (int i = 0; i < n; i++) {
+			LONGS_EQUAL(types[i], rec.events[i].type);
+		}
+	}
+};
+
+TEST(StreamSkip, ShouldSkipContainer_WhenStartSkipped)
+{
+	/* [{"a": [1, 2]}, 3] */
+	const uint8_t msg[] = {
+		0x82, 0xa1, 0x61, 'a', 0x82, 0x01, 0x02, 0x03,
+	};
+	const cbor_stream_event_type_t types[] = {
+		CBOR_STREAM_EVENT_ARRAY_START, CBOR_STREAM_EVENT_MAP_START,
+		CBOR_STREAM_EVENT_UINT, CBOR_STREAM_EVENT_ARRAY_END,
+	};
+
+	rec.skip_at = 2;
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	check_types(types, 4);
+	LONGS_EQUAL(3, rec.events[2].uint_val);
+	LONGS_EQUAL(sizeof(msg), decoder.offset);
+
+	memset(&rec, 0, sizeof(rec));
+	rec.skip_at = 2;
+	cbor_stream_reset(&decoder);
+	feed_byte_by_byte(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	check_types(types, 4);
+}
+
+TEST(StreamSkip, ShouldSkipContainer_WhenIndefiniteOrEmpty)
+{
+	/* [_ [_ 1, "x"], [], 2] */
+	const uint8_t msg[] = {
+		0x9f, 0x9f, 0x01, 0x61, 'x', 0xff, 0x80, 0x02, 0xff,
+	};
+	const cbor_stream_event_type_t types[] = {
+		CBOR_STREAM_EVENT_ARRAY_START, CBOR_STREAM_EVENT_ARRAY_START,
+		CBOR_STREAM_EVENT_ARRAY_START, CBOR_STREAM_EVENT_ARRAY_END,
+		CBOR_STREAM_EVENT_UINT, CBOR_STREAM_EVENT_ARRAY_END,
+	};
+
+	rec.skip_at = 2;
+	feed_all(&decoder, msg, sizeof(msg));
+	check_types(types, 6);
+
+	memset(&rec, 0, sizeof(rec));
+	rec.skip_at = 6;
+	cbor_stream_reset(&decoder);
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	LONGS_EQUAL(8, rec.count);
+	LONGS_EQUAL(CBOR_STREAM_EVENT_UINT, rec.events[6].type);
+}
+
+TEST(StreamSkip, ShouldCloseParent_WhenSkippedContainerEndsIt)
+{
+	/* [[1, [2]]] */
+	const uint8_t msg[] = { 0x81, 0x82, 0x01, 0x81, 0x02 };
+
+	rec.skip_at = 2;
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	LONGS_EQUAL(3, rec.count);
+	LONGS_EQUAL(CBOR_STREAM_EVENT_ARRAY_END, rec.events[2].type);
+	LONGS_EQUAL(0, rec.events[2].depth);
+
+	memset(&rec, 0, sizeof(rec));
+	rec.skip_at = 2;
+	rec.abort_after_first = true;
+	rec.abort_at = 2;
+	cbor_stream_reset(&decoder);
+	LONGS_EQUAL(CBOR_ABORTED, cbor_stream_feed(&decoder, msg, sizeof(msg)));
+	LONGS_EQUAL(sizeof(msg), decoder.offset);
+}
+
+TEST(StreamSkip, ShouldSkipRestOfString_WhenChunkSkipped)
+{
+	/* ["hello", (_ "ab", "cd"), 1] */
+	const uint8_t msg[] = {
+		0x83, 0x65, 'h', 'e', 'l', 'l', 'o',
+		0x7f, 0x62, 'a', 'b', 0x62, 'c', 'd', 0xff, 0x01,
+	};
+
+	rec.skip_at = 2;
+	feed_all(&decoder, msg, 4);
+	feed_all(&decoder, &msg[4], sizeof(msg) - 4);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	LONGS_EQUAL(7, rec.count);
+	LONGS_EQUAL(2, rec.events[1].str_len);
+	CHECK_FALSE(rec.events[1].str_last);
+	CHECK_TRUE(rec.events[2].str_first);
+	MEMCMP_EQUAL("ab", rec.events[2].str_buf, 2);
+
+	memset(&rec, 0, sizeof(rec));
+	rec.skip_at = 7; /* "a", of one-byte chunks */
+	cbor_stream_reset(&decoder);
+	feed_byte_by_byte(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(9, rec.count);
+	LONGS_EQUAL(CBOR_STREAM_EVENT_UINT, rec.events[7].type);
+	LONGS_EQUAL(CBOR_STREAM_EVENT_ARRAY_END, rec.events[8].type);
+}
+
+TEST(StreamSkip, ShouldNotCheckUtf8_WhenStringSkipped)
+{
+	/* [(_ "ok", "\xff"), "\xc3"] */
+	const uint8_t msg[] = {
+		0x82, 0x7f, 0x62, 'o', 'k', 0x61, 0xff, 0xff, 0x61, 0xc3,
+	};
+
+	cbor_stream_set_utf8_validation(&decoder, true);
+	rec.skip_at = 2;
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_feed(&decoder, msg, sizeof(msg)));
+	LONGS_EQUAL(sizeof(msg), decoder.offset);
+	LONGS_EQUAL(2, rec.count);
+}
+
+TEST(StreamSkip, ShouldSkipTaggedItem_WhenTagSkipped)
+{
+	/* [24([1, 2]), 1("x"), 3] */
+	const uint8_t msg[] = {
+		0x83, 0xd8, 0x18, 0x82, 0x01, 0x02, 0xc1, 0x61, 'x', 0x03,
+	};
+	const cbor_stream_event_type_t types[] = {
+		CBOR_STREAM_EVENT_ARRAY_START, CBOR_STREAM_EVENT_TAG,
+		CBOR_STREAM_EVENT_TAG, CBOR_STREAM_EVENT_TEXT,
+		CBOR_STREAM_EVENT_UINT, CBOR_STREAM_EVENT_ARRAY_END,
+	};
+
+	rec.skip_at = 2;
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	check_types(types, 6);
+}
+
+TEST(StreamSkip, ShouldSkipItems_WhenPulled)
+{
+	/* [[1, [2]], [], 3] [[]] */
+	const uint8_t msg[] = {
+		0x83, 0x82, 0x01, 0x81, 0x02, 0x80, 0x03, 0x81, 0x80,
+	};
+	const cbor_stream_event_type_t types[] = {
+		CBOR_STREAM_EVENT_ARRAY_START, CBOR_STREAM_EVENT_ARRAY_START,
+		CBOR_STREAM_EVENT_ARRAY_START, CBOR_STREAM_EVENT_UINT,
+		CBOR_STREAM_EVENT_ARRAY_END, CBOR_STREAM_EVENT_ARRAY_START,
+		CBOR_STREAM_EVENT_ARRAY_START, CBOR_STREAM_EVENT_ARRAY_END,
+	};
+	const cbor_stream_event_t *event;
+	const cbor_stream_data_t  *data;
+
+	cbor_stream_init_pull(&decoder);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_feed(&decoder, msg, sizeof(msg)));
+
+	while (cbor_stream_next(&decoder, &event, &data) == CBOR_SUCCESS) {
+		record_cb(event, data, &rec);
+		if (event->type == CBOR_STREAM_EVENT_ARRAY_START &&
+				event->depth == 1) {
+			LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_skip(&decoder));
+		}
+	}
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	check_types(types, 8);
+	LONGS_EQUAL(0, rec.events[7].depth);
+}
+
+TEST(StreamSkip, ShouldSkipSameItems_WhenPulledOrPushed)
+{
+	/* [{"a": [1, 2]}, 3] */
+	const uint8_t msg[] = {
+		0x82, 0xa1, 0x61, 'a', 0x82, 0x01, 0x02, 0x03,
+	};
+	Recorder pulled;
+
+	rec.skip_at = 3;
+	feed_all(&decoder, msg, sizeof(msg));
+
+	memset(&pulled, 0, sizeof(pulled));
+	pulled.skip_at = 3;
+	cbor_stream_init_pull(&decoder);
+	pull_all(&decoder, &pulled, msg, sizeof(msg));
+
+	LONGS_EQUAL(rec.count, pulled.count);
+	MEMCMP_EQUAL(rec.events, pulled.events,
+			sizeof(rec.events[0]) * (size_t)rec.count);
+}
+
+TEST(StreamSkip, ShouldReturnInvalid_WhenSkipGivenCallbackDecoder)
+{
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_skip(NULL));
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_skip(&decoder));
+}
+
+/* ---------- TEST_GROUP: Batched events ---------- */
+
+struct Batches {
+	Recorder rec;
+	int      calls;
+	size_t   sizes[32];
+	bool     abort;
+};
+
+static bool batch_cb(const cbor_stream_record_t *records, size_t n, void *arg)
+{
+	Batches *b = (Batches *)arg;
+
+	CHECK(n > 0);
+	if (b->calls < 32) {
+		b->sizes[b->calls] = n;
+	}
+	b->calls++;
+
+	for (size_t i = 0; i < n; i++) {
+		const cbor_stream_event_t *event = &records[i].event;
+		bool end = event->type == CBOR_STREAM_EVENT_ARRAY_END ||
+			event->type == CBOR_STREAM_EVENT_MAP_END;
+
+		record_cb(event, end? NULL : &records[i].data, &b->rec);
+	}
+
+	return !b->abort;
+}
+
+TEST_GROUP(StreamBatch)
+{
+	cbor_stream_decoder_t decoder;
+	cbor_stream_record_t  records[4];
+	Batches               batches;
+
+	void setup()
+	{
+		memset(&batches, 0, sizeof(batches));
+		cbor_stream_init_batch(&decoder, records, 4, batch_cb, &batches);
+	}
+};
+
+TEST(StreamBatch, ShouldHandOverSameEvents_AsCallbackGets)
+{
+	/* [{"a": [[], {}], 1: 24(h'0102')}, (_ "ab", "c"), [_ -1, 1.5], [[[0]]]] */
+	const uint8_t msg[] = {
+		0x84,
+		0xa2, 0x61, 'a', 0x82, 0x80, 0xa0,
+		0x01, 0xd8, 0x18, 0x42, 0x01, 0x02,
+		0x7f, 0x62, 'a', 'b', 0x61, 'c', 0xff,
+		0x9f, 0x20, 0xf9, 0x3e, 0x00, 0xff,
+		0x81, 0x81, 0x81, 0x00,
+	};
+	cbor_stream_decoder_t push;
+	Recorder expected;
+
+	memset(&expected, 0, sizeof(expected));
+	cbor_stream_init(&push, record_cb, &expected);
+	feed_all(&push, msg, sizeof(msg));
+
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	LONGS_EQUAL(expected.count, batches.rec.count);
+	MEMCMP_EQUAL(expected.events, batches.rec.events,
+			sizeof(expected.events[0]) * (size_t)expected.count);
+
+	LONGS_EQUAL((expected.count + 3) / 4, batches.calls);
+	for (int i = 0; i < batches.calls - 1; i++) {
+		LONGS_EQUAL(4, batches.sizes[i]);
+	}
+}
+
+TEST(StreamBatch, ShouldHandOverIntegers_WhenSplitAnywhere)
+{
+	/* {1: -500, 2: [_ 1000000, 3], -1: 24(0)} */
+	const uint8_t msg[] = {
+		0xa3, 0x01, 0x39, 0x01, 0xf3,
+		0x02, 0x9f, 0x1a, 0x00, 0x0f, 0x42, 0x40, 0x03, 0xff,
+		0x20, 0xd8, 0x18, 0x00,
+	};
+	cbor_stream_decoder_t push;
+	Recorder expected;
+
+	memset(&expected, 0, sizeof(expected));
+	cbor_stream_init(&push, record_cb, &expected);
+	feed_all(&push, msg, sizeof(msg));
+
+	for (size_t split = 0; split <= sizeof(msg); split++) {
+		memset(&batches, 0, sizeof(batches));
+		cbor_stream_reset(&decoder);
+		feed_all(&decoder, msg, split);
+		feed_all(&decoder, &msg[split], sizeof(msg) - split);
+		LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+		LONGS_EQUAL(expected.count, batches.rec.count);
+		MEMCMP_EQUAL(expected.events, batches.rec.events,
+				sizeof(expected.events[0]) *
+				(size_t)expected.count);
+	}
+}
+
+TEST(StreamBatch, ShouldHandOverBatch_WhenFeedEnds)
+{
+	/* [1, 2, "ab"] */
+	const uint8_t msg[] = { 0x83, 0x01, 0x02, 0x62, 'a', 'b' };
+
+	feed_all(&decoder, msg, 5);
+	LONGS_EQUAL(1, batches.calls);
+	LONGS_EQUAL(4, batches.sizes[0]);
+	LONGS_EQUAL(1, batches.rec.events[3].str_len);
+
+	feed_all(&decoder, &msg[5], 1);
+	LONGS_EQUAL(2, batches.calls);
+	LONGS_EQUAL(2, batches.sizes[1]);
+	LONGS_EQUAL('b', batches.rec.events[4].str_buf[0]);
+	LONGS_EQUAL(CBOR_STREAM_EVENT_ARRAY_END, batches.rec.events[5].type);
+
+	feed_all(&decoder, msg, 0);
+	LONGS_EQUAL(2, batches.calls);
+}
+
+TEST(StreamBatch, ShouldHandOverEvents_WhenErrorFollows)
+{
+	const uint8_t msg[] = { 0x82, 0x01, 0xfc };
+
+	LONGS_EQUAL(CBOR_ILLEGAL, cbor_stream_feed(&decoder, msg, sizeof(msg)));
+	LONGS_EQUAL(1, batches.calls);
+	LONGS_EQUAL(2, batches.rec.count);
+	LONGS_EQUAL(1, batches.rec.events[1].uint_val);
+}
+
+TEST(StreamBatch, ShouldReturnAborted_WhenBatchCallbackReturnsFalse)
+{
+	const uint8_t msg[] = { 0x85, 0x01, 0x02, 0x03, 0x04, 0x05 };
+
+	batches.abort = true;
+	LONGS_EQUAL(CBOR_ABORTED, cbor_stream_feed(&decoder, msg, sizeof(msg)));
+	LONGS_EQUAL(1, batches.calls);
+	LONGS_EQUAL(4, decoder.offset);
+	LONGS_EQUAL(CBOR_ABORTED, cbor_stream_feed(&decoder, msg, 1));
+
+	cbor_stream_reset(&decoder);
+	batches.abort = false;
+	feed_all(&decoder, msg, sizeof(msg));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_stream_finish(&decoder));
+	LONGS_EQUAL(3, batches.calls);
+}
+
+TEST(StreamBatch, ShouldReturnInvalid_WhenRecordsNotGiven)
+{
+	const uint8_t msg[] = { 0x01 };
+
+	cbor_stream_init_batch(&decoder, NULL, 4, batch_cb, &batches);
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_feed(&decoder, msg, 1));
+	cbor_stream_init_batch(&decoder, records, 0, batch_cb, &batches);
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_feed(&decoder, msg, 1));
+	cbor_stream_init_batch(&decoder, records, 4, NULL, &batches);
+	LONGS_EQUAL(CBOR_INVALID, cbor_stream_feed(&decoder, msg, 1));
+	LONGS_EQUAL(0, batches.calls);
+}
@@ -0,0 +1,359 @@
+#include "CppUTest/TestHarness.h"
+
+#include <string.h>
+
+#include "cbor/cbor.h"
+
+/* The example of the stringref extension, tags 25 and 256 */
+static const char *const example[] = {
+	"1", "222", "333", "4", "555", "666", "777", "888", "999",
+	"aaa", "bbb", "ccc", "ddd", "eee", "fff", "ggg", "hhh", "iii",
+	"jjj", "kkk", "lll", "mmm", "nnn", "ooo", "ppp", "qqq", "rrr",
+	"333", "ssss", "qqq", "rrr", "ssss",
+};
+#define NR_EXAMPLE	(sizeof(example) / sizeof(*example))
+
+TEST_GROUP(Stringref) {
+	cbor_writer_t writer;
+	cbor_stringref_t strings[64];
+	uint8_t buf[512];
+
+	cbor_reader_t reader;
+	cbor_item_t items[128];
+	size_t refs[32];
+
+	void setup(void) {
+		cbor_writer_init(&writer, buf, sizeof(buf));
+		cbor_writer_set_stringrefs(&writer, strings, 64);
+		cbor_reader_init(&reader, items, sizeof(items) / sizeof(*items));
+		cbor_reader_set_stringrefs(&reader, refs, 32);
+	}
+
+	void encode_example(void) {
+		LONGS_EQUAL(CBOR_SUCCESS,
+				cbor_encode_stringref_namespace(&writer));
+		cbor_encode_array(&writer, NR_EXAMPLE);
+		for (size_t i = 0; i < NR_EXAMPLE; i++) {
+			cbor_encode_null_terminated_text_string(&writer,
+					example[i]);
+		}
+	}
+};
+
+TEST(Stringref, ShouldReferToNumberedStrings_WhenRepeated)
+{
+	const uint8_t tail[] = {
+		0x63, 'r', 'r', 'r',
+		0xd8, 0x19, 0x01, /* "333" */
+		0x64, 's', 's', 's', 's',
+		0xd8, 0x19, 0x17, /* "qqq" */
+		0x63, 'r', 'r', 'r', /* not numbered, as the 25th string */
+		0xd8, 0x19, 0x18, 0x18, /* "ssss" */
+	};
+
+	encode_example();
+
+	LONGS_EQUAL(0xd9, buf[0]);
+	LONGS_EQUAL(0x01, buf[1]);
+	LONGS_EQUAL(0x00, buf[2]);
+	LONGS_EQUAL(0x98, buf[3]);
+	LONGS_EQUAL(32, buf[4]);
+	MEMCMP_EQUAL(tail, &buf[cbor_writer_len(&writer) - sizeof(tail)],
+			sizeof(tail));
+}
+
+TEST(Stringref, ShouldResolveReferences_WhenParsed)
+{
+	size_t n = 0;
+	size_t strings_seen = 0;
+
+	encode_example();
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, buf,
+				cbor_writer_len(&writer), &n));
+
+	for (size_t i = 2; i < n; i++) {
+		char str[8] = { 0, };
+
+		if (items[i].type == CBOR_ITEM_TAG) {
+			LONGS_EQUAL(25, cbor_get_tag_number(&items[i]));
+			continue;
+		}
+
+		LONGS_EQUAL(CBOR_ITEM_STRING, items[i].type);
+		LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, &items[i],
+					str, sizeof(str)));
+		STRCMP_EQUAL(example[strings_seen], str);
+		strings_seen++;
+	}
+
+	LONGS_EQUAL(NR_EXAMPLE, strings_seen);
+	POINTERS_EQUAL(cbor_decode_pointer(&reader, &items[4]),
+			cbor_decode_pointer(&reader, &items[30]));
+}
+
+TEST(Stringref, ShouldShrinkMessage_WhenKeysRepeated)
+{
+	cbor_writer_t plain;
+	uint8_t plainbuf[512];
+
+	cbor_writer_init(&plain, plainbuf, sizeof(plainbuf));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_stringref_namespace(&writer));
+
+	cbor_encode_array(&writer, 10);
+	cbor_encode_array(&plain, 10);
+	for (int i = 0; i < 10; i++) {
+		cbor_writer_t *w[] = { &writer, &plain };
+		for (int j = 0; j < 2; j++) {
+			cbor_encode_map(w[j], 2);
+			cbor_encode_text_string(w[j], "temperature", 11);
+			cbor_encode_unsigned_integer(w[j], (uint64_t)i);
+			cbor_encode_text_string(w[j], "humidity", 8);
+			cbor_encode_unsigned_integer(w[j], 50);
+		}
+	}
+
+	CHECK(cbor_writer_len(&writer) * 2 < cbor_writer_len(&plain));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, buf,
+				cbor_writer_len(&writer), NULL));
+}
+
+TEST(Stringref, ShouldNotShareChunks_WhenIndefiniteStringGiven)
+{
+	const uint8_t expected[] = {
+		0xd9, 0x01, 0x00, 0x83,
+		0x63, 'a', 'b', 'c',
+		0x7f, 0x63, 'a', 'b', 'c', 0xff,
+		0xd8, 0x19, 0x00,
+	};
+
+	cbor_encode_stringref_namespace(&writer);
+	cbor_encode_array(&writer, 3);
+	cbor_encode_text_string(&writer, "abc", 3);
+	cbor_encode_text_string_indefinite(&writer);
+	cbor_encode_text_string(&writer, "abc", 3);
+	cbor_encode_break(&writer);
+	cbor_encode_text_string(&writer, "abc", 3);
+
+	LONGS_EQUAL(sizeof(expected), cbor_writer_len(&writer));
+	MEMCMP_EQUAL(expected, buf, sizeof(expected));
+}
+
+TEST(Stringref, ShouldKeepByteAndTextStringsApart)
+{
+	const uint8_t expected[] = {
+		0xd9, 0x01, 0x00, 0x83,
+		0x43, 'a', 'b', 'c',
+		0x63, 'a', 'b', 'c',
+		0xd8, 0x19, 0x01,
+	};
+
+	cbor_encode_stringref_namespace(&writer);
+	cbor_encode_array(&writer, 3);
+	cbor_encode_byte_string(&writer, (uint8_t const *)"abc", 3);
+	cbor_encode_text_string(&writer, "abc", 3);
+	cbor_encode_text_string(&writer, "abc", 3);
+
+	LONGS_EQUAL(sizeof(expected), cbor_writer_len(&writer));
+	MEMCMP_EQUAL(expected, buf, sizeof(expected));
+}
+
+TEST(Stringref, ShouldReturnInvalid_WhenNamespaceCannotBeKept)
+{
+	cbor_writer_t measure;
+	cbor_writer_frame_t frames[2];
+
+	cbor_writer_init_dry_run(&measure);
+	cbor_writer_set_stringrefs(&measure, strings, 64);
+	LONGS_EQUAL(CBOR_INVALID, cbor_encode_stringref_namespace(&measure));
+
+	cbor_writer_set_stringrefs(&writer, NULL, 0);
+	LONGS_EQUAL(CBOR_INVALID, cbor_encode_stringref_namespace(&writer));
+
+	cbor_writer_set_stringrefs(&writer, strings, 64);
+	cbor_writer_set_frames(&writer, frames, 2);
+	cbor_encode_stringref_namespace(&writer);
+	LONGS_EQUAL(CBOR_INVALID, cbor_encode_array_begin(&writer));
+}
+
+TEST(Stringref, ShouldResolveNestedNamespaces)
+{
+	/* 256([ "aaa", 256(["bbb", 25(0)]), 25(0) ]) */
+	const uint8_t msg[] = {
+		0xd9, 0x01, 0x00, 0x83,
+		0x63, 'a', 'a', 'a',
+		0xd9, 0x01, 0x00, 0x82, 0x63, 'b', 'b', 'b', 0xd8, 0x19, 0x00,
+		0xd8, 0x19, 0x00,
+	};
+	char str[4] = { 0, };
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, msg, sizeof(msg), NULL));
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, &items[7],
+				str, sizeof(str)));
+	STRCMP_EQUAL("bbb", str);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, &items[9],
+				str, sizeof(str)));
+	STRCMP_EQUAL("aaa", str);
+}
+
+TEST(Stringref, ShouldReturnError_WhenReferenceCannotBeResolved)
+{
+	const uint8_t unnumbered[] = {
+		0xd9, 0x01, 0x00, 0x82, 0x62, 'a', 'a', 0xd8, 0x19, 0x00,
+	};
+	const uint8_t not_integer[] = {
+		0xd9, 0x01, 0x00, 0x82, 0x63, 'a', 'a', 'a', 0xd8, 0x19, 0x20,
+	};
+	const uint8_t outside[] = { 0xd8, 0x19, 0x00 };
+	size_t small[1];
+
+	LONGS_EQUAL(CBOR_INVALID, cbor_parse(&reader, unnumbered,
+				sizeof(unnumbered), NULL));
+	LONGS_EQUAL(CBOR_INVALID, cbor_parse(&reader, not_integer,
+				sizeof(not_integer), NULL));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, outside,
+				sizeof(outside), NULL));
+	LONGS_EQUAL(CBOR_ITEM_INTEGER, items[1].type);
+
+	encode_example();
+	cbor_reader_set_stringrefs(&reader, small, 1);
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_parse(&reader, buf,
+				cbor_writer_len(&writer), NULL));
+}
+
+TEST(Stringref, ShouldResolveDeepNesting_WhenReaderHasFrames)
+{
+	/* 256(["aaa", [[[[[[[[[[[25(0)]]]]]]]]]]]) */
+	const uint8_t head[] = { 0xd9, 0x01, 0x00, 0x82, 0x63, 'a', 'a', 'a', };
+	const uint8_t ref[] = { 0xd8, 0x19, 0x00, };
+	const size_t nested = CBOR_RECURSION_MAX_LEVEL + 3;
+	cbor_parser_frame_t frames[32];
+	uint8_t msg[64];
+	size_t len = 0;
+	size_t n = 0;
+	char str[4] = { 0, };
+
+	memcpy(&msg[len], head, sizeof(head));
+	len += sizeof(head);
+	memset(&msg[len], 0x81, nested);
+	len += nested;
+	memcpy(&msg[len], ref, sizeof(ref));
+	len += sizeof(ref);
+
+	cbor_reader_set_frames(&reader, frames, 32);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, msg, len, &n));
+	LONGS_EQUAL(3 + nested + 2, n);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, &items[n - 1],
+				str, sizeof(str)));
+	STRCMP_EQUAL("aaa", str);
+}
+
+TEST(Stringref, ShouldResolveReferences_WhenIndefiniteItemsGiven)
+{
+	/* 256([_ "abc", (_ "abc"), 25(0), {_ 25(0): 25(0)}]) */
+	const uint8_t msg[] = {
+		0xd9, 0x01, 0x00, 0x9f,
+		0x63, 'a', 'b', 'c',
+		0x7f, 0x63, 'a', 'b', 'c', 0xff,
+		0xd8, 0x19, 0x00,
+		0xbf, 0xd8, 0x19, 0x00, 0xd8, 0x19, 0x00, 0xff,
+		0xff,
+	};
+	/* 256(["abc", (_ "abc"), 25(1)]): chunks are not numbered */
+	const uint8_t chunk[] = {
+		0xd9, 0x01, 0x00, 0x83,
+		0x63, 'a', 'b', 'c',
+		0x7f, 0x63, 'a', 'b', 'c', 0xff,
+		0xd8, 0x19, 0x01,
+	};
+	const size_t refs_at[] = { 7, 10, 12, };
+	char str[4] = { 0, };
+
+	/* a message ending in a BREAK parses as CBOR_BREAK */
+	LONGS_EQUAL(CBOR_BREAK, cbor_parse(&reader, msg, sizeof(msg), NULL));
+	for (size_t i = 0; i < sizeof(refs_at) / sizeof(*refs_at); i++) {
+		LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader,
+					&items[refs_at[i]], str, sizeof(str)));
+		STRCMP_EQUAL("abc", str);
+	}
+
+	LONGS_EQUAL(CBOR_INVALID, cbor_parse(&reader, chunk, sizeof(chunk),
+				NULL));
+}
+
+TEST(Stringref, ShouldResolveEachItemOnce_WhenParseResumed)
+{
+	/* 256(["abc", 25(0)]) 1 256([25(0)]) */
+	const uint8_t msg[] = {
+		0xd9, 0x01, 0x00, 0x82, 0x63, 'a', 'b', 'c', 0xd8, 0x19, 0x00,
+		0x01,
+		0xd9, 0x01, 0x00, 0x81, 0xd8, 0x19, 0x00,
+	};
+	cbor_parser_frame_t frames[4];
+	size_t n = 0;
+	char str[4] = { 0, };
+
+	cbor_reader_set_frames(&reader, frames, 4);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse_resume(&reader, msg, 11, &n));
+	LONGS_EQUAL(5, n);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse_resume(&reader, msg, 12, &n));
+	LONGS_EQUAL(6, n);
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, &items[4],
+				str, sizeof(str)));
+	STRCMP_EQUAL("abc", str);
+
+	/* a reference in a later item refers to its own namespace only */
+	LONGS_EQUAL(CBOR_INVALID, cbor_parse_resume(&reader, msg,
+				sizeof(msg), &n));
+}
+
+TEST(Stringref, ShouldEndNamespace_WhenWrappedItemIsDone)
+{
+	/* 256("abc") "abc" 256([_ {"abc": [_ "abc"]}, "abc"]) "abc" */
+	const uint8_t expected[] = {
+		0xd9, 0x01, 0x00, 0x63, 'a', 'b', 'c',
+		0x63, 'a', 'b', 'c',
+		0xd9, 0x01, 0x00, 0x9f,
+		0xa1, 0x63, 'a', 'b', 'c', 0x9f, 0xd8, 0x19, 0x00, 0xff,
+		0xd8, 0x19, 0x00, 0xff,
+		0x63, 'a', 'b', 'c',
+	};
+	size_t n = 0;
+	char str[4] = { 0, };
+
+	cbor_encode_stringref_namespace(&writer);
+	cbor_encode_text_string(&writer, "abc", 3);
+	cbor_encode_text_string(&writer, "abc", 3);
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_encode_stringref_namespace(&writer));
+	LONGS_EQUAL(CBOR_INVALID, cbor_encode_stringref_namespace(&writer));
+	cbor_encode_array_indefinite(&writer);
+	cbor_encode_map(&writer, 1);
+	cbor_encode_text_string(&writer, "abc", 3);
+	cbor_encode_array_indefinite(&writer);
+	cbor_encode_text_string(&writer, "abc", 3);
+	cbor_encode_break(&writer);
+	cbor_encode_text_string(&writer, "abc", 3);
+	cbor_encode_break(&writer);
+	cbor_encode_text_string(&writer, "abc", 3);
+
+	LONGS_EQUAL(sizeof(expected), cbor_writer_len(&writer));
+	MEMCMP_EQUAL(expected, buf, sizeof(expected));
+
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_parse(&reader, buf,
+				cbor_writer_len(&writer), &n));
+	LONGS_EQUAL(CBOR_SUCCESS, cbor_decode(&reader, &items[n - 1],
+				str, sizeof(str)));
+	STRCMP_EQUAL("abc", str);
+}
+
+TEST(Stringref, ShouldReturnExcessive_WhenIndefiniteItemsNestTooDeep)
+{
+	cbor_encode_stringref_namespace(&writer);
+	for (int i = 0; i < CBOR_RECURSION_MAX_LEVEL; i++) {
+		LONGS_EQUAL(CBOR_SUCCESS,
+				cbor_encode_array_indefinite(&writer));
+	}
+	LONGS_EQUAL(CBOR_EXCESSIVE, cbor_encode_map_indefinite(&writer));
+}
@@ -0,0 +1,66 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Kyunghwan Kwon <k@mononn.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "cbor/utf8.h"
+#include <string.h>
+
+static size_t validate(const char *s, size_t len, uint8_t *state)
+{
+	*state = CBOR_UTF8_ACCEPT;
+	return cbor_utf8_validate(state, (const uint8_t *)s, len);
+}
+
+TEST_GROUP(UTF8) {
+	uint8_t state;
+};
+
+TEST(UTF8, ShouldAccept_WhenAsciiGiven)
+{
+	const char s[] = "The quick brown fox jumps over the lazy dog";
+	LONGS_EQUAL(sizeof(s) - 1, validate(s, sizeof(s) - 1, &state));
+	LONGS_EQUAL(CBOR_UTF8_ACCEPT, state);
+}
+
+TEST(UTF8, ShouldAccept_WhenMultiByteSequencesGiven)
+{
+	/* U+00FC, U+6C34, U+10348, U+10FFFF, U+D7FF, U+E000 */
+	const char s[] = "\xc3\xbc\xe6\xb0\xb4\xf0\x90\x8d\x88"
+		"\xf4\x8f\xbf\xbf\xed\x9f\xbf\xee\x80\x80";
+	LONGS_EQUAL(sizeof(s) - 1, validate(s, sizeof(s) - 1, &state));
+	LONGS_EQUAL(CBOR_UTF8_ACCEPT, state);
+}
+
+TEST(UTF8, ShouldStopAtOffendingByte_WhenIllFormedGiven)
+{
+	LONGS_EQUAL(1, validate("a\x80", 2, &state)); /* lone continuation */
+	LONGS_EQUAL(0, validate("\xc0\xaf", 2, &state)); /* overlong */
+	LONGS_EQUAL(1, validate("\xe0\x80\xaf", 3, &state)); /* overlong */
+	LONGS_EQUAL(1, validate("\xed\xa0\x80", 3, &state)); /* surrogate */
+	LONGS_EQUAL(1, validate("\xf4\x90\x80\x80", 4, &state)); /* > U+10FFFF */
+	LONGS_EQUAL(0, validate("\xf5\x80\x80\x80", 4, &state));
+	LONGS_EQUAL(2, validate("\xe6\xb0" "a", 3, &state)); /* cut short */
+}
+
+TEST(UTF8, ShouldFindOffendingByte_WhenPrecededByLongAsciiRun)
+{
+	char s[40];
+	memset(s, 'x', sizeof(s));
+	s[37] = '\xff';
+	LONGS_EQUAL(37, validate(s, sizeof(s), &state));
+}
+
+TEST(UTF8, ShouldCarryCodePoint_WhenSplitBetweenCalls)
+{
+	const uint8_t s[] = { 'a', 0xf0, 0x90, 0x8d, 0x88, 'b' };
+
+	state = CBOR_UTF8_ACCEPT;
+	LONGS_EQUAL(3, cbor_utf8_validate(&state, s, 3));
+	CHECK(state != CBOR_UTF8_ACCEPT);
+	LONGS_EQUAL(1, cbor_utf8_validate(&state, &s[3], 1));
+	LONGS_EQUAL(2, cbor_utf8_validate(&state, &s[4], 2));
+	LONGS_EQUAL(CBOR_UTF8_ACCEPT, state);
+}